@@ -24,17 +24,30 @@ public class ScreenshotManager : MonoBehaviour
     }
 #endif
 
-    public static IEnumerator SaveForPaint(string fileName, string albumName = "MyScreenshots", bool callback = false)
+    // a new numbered file name for an export, extension with the dot
+    public static string NextFileName(string fileName, string extension)
     {
-        bool photoSaved = false;
-
         string date = System.DateTime.Now.ToString("dd-MM-yy");
 
         ScreenshotManager.ScreenShotNumber++;
 
-        string screenshotFilename = fileName + "_" + ScreenshotManager.ScreenShotNumber + "_" + date + ".jpg";
+        return fileName + "_" + ScreenshotManager.ScreenShotNumber + "_" + date + extension;
+    }
+
+    // where an export is written before Publish, Android shares it from the cache and keeps its copy in the gallery
+    public static string FilePath(string screenshotFilename)
+    {
+#if UNITY_ANDROID && !UNITY_EDITOR
+        return Path.Combine(Application.temporaryCachePath, screenshotFilename);
+#else
+        return Application.persistentDataPath + "/" + screenshotFilename;
+#endif
+    }
 
-        Rect rect = new Rect(0, 0, Screen.width * 0.8f, Screen.height * 0.8f);
+    // hands a written export (PageExport) to the gallery and the share sheet, on WebGL bytes are downloaded instead
+    public static IEnumerator Publish(string path, string screenshotFilename, string albumName = "MyScreenshots", byte[] bytes = null, bool callback = false)
+    {
+        bool photoSaved = false;
 
         Debug.Log("Save screenshot " + screenshotFilename);
 
@@ -47,57 +60,17 @@ public class ScreenshotManager : MonoBehaviour
 			{
 				Debug.Log("iOS platform detected");
 				
-				string iosPath = Application.persistentDataPath + "/" + screenshotFilename;
-		
-				//Application.CaptureScreenshot(screenshotFilename);
-                
-                //////////////
-                yield return new WaitForEndOfFrame();
-
-                Texture2D texture = new Texture2D((int)rect.width, (int)rect.height, TextureFormat.RGB24, false);
-                texture.ReadPixels(rect, 0, 0);
-
-                texture.Apply();
-
-                yield return 0;
-
-                byte[] bytes = texture.EncodeToJPG();
-                File.WriteAllBytes(iosPath, bytes);
-
-                Destroy(texture);
-                //////////////
-				
 				while(!photoSaved) 
 				{
-					photoSaved = saveToGallery( iosPath );
+					photoSaved = saveToGallery( path );
 					
 					yield return new WaitForSeconds(.5f);
 				}
 			
-				UnityEngine.iOS.Device.SetNoBackupFlag( iosPath );
+				UnityEngine.iOS.Device.SetNoBackupFlag( path );
 			
-                new NativeShare().AddFile(iosPath).SetSubject(albumName).SetText(share).Share();
+                new NativeShare().AddFile(path).SetSubject(albumName).SetText(share).Share();
 			} 
-            else
-            {
-                //Application.CaptureScreenshot(screenshotFilename);
-
-                //////////////
-                yield return new WaitForEndOfFrame();
-
-                Texture2D texture = new Texture2D((int)rect.width, (int)rect.height, TextureFormat.RGB24, false);
-                texture.ReadPixels(rect, 0, 0);
-
-                texture.Apply();
-
-                yield return 0;
-
-                byte[] bytes = texture.EncodeToJPG();
-                File.WriteAllBytes(Application.persistentDataPath + "/" + screenshotFilename, bytes);
-
-                Destroy(texture);
-                //////////////
-            }
 			
 #elif UNITY_ANDROID
 
@@ -105,71 +78,46 @@ public class ScreenshotManager : MonoBehaviour
         {
             Debug.Log("Android platform detected");
 
-            yield return new WaitForEndOfFrame();
-
-            Texture2D texture = new Texture2D((int)rect.width, (int)rect.height, TextureFormat.RGB24, false);
-            texture.ReadPixels(rect, 0, 0);
-            texture.Apply();
-
-            yield return 0;
-
-            byte[] bytes = texture.EncodeToJPG();
-
-            string path = Path.Combine(Application.temporaryCachePath, screenshotFilename);
-            File.WriteAllBytes(path, bytes);
-
-            NativeGallery.SaveImageToGallery(bytes, albumName, screenshotFilename);
-
-            Destroy(texture);
+            TraceLog.Begin("Screenshot Save To Gallery");
+            NativeGallery.SaveImageToGallery(path, albumName, screenshotFilename);
+            TraceLog.End("Screenshot Save To Gallery");
 
             new NativeShare().AddFile(path).SetSubject(albumName).SetText(share).Share();
         }
-        else
-        {
-            //////////////
-            yield return new WaitForEndOfFrame();
-
-            Texture2D texture = new Texture2D((int)rect.width, (int)rect.height, TextureFormat.RGB24, false);
-            texture.ReadPixels(rect, 0, 0);
-
-            texture.Apply();
-
-            yield return 0;
-
-            byte[] bytes = texture.EncodeToJPG();
-            File.WriteAllBytes(Application.persistentDataPath + "/" + screenshotFilename, bytes);
-
-            Destroy(texture);
-            //////////////
-        }
 
 #elif UNITY_WEBGL
 
-        yield return new WaitForEndOfFrame();
-
-        Texture2D texture = new Texture2D((int)rect.width, (int)rect.height, TextureFormat.RGB24, false);
-        texture.ReadPixels(rect, 0, 0);
+        DownloadScreenshot(bytes, screenshotFilename);
 
-        texture.Apply();
+#endif
+        TraceLog.Instant("Screenshot Saved");
 
-        yield return 0;
+        if (callback)
+            ScreenshotFinishedSaving();
 
-        byte[] bytes = texture.EncodeToJPG();
+        yield break;
+    }
 
-        DownloadScreenshot(bytes, screenshotFilename);
+    // hands a written file that is no picture (PageArchive) to the share sheet only, on WebGL bytes are downloaded instead
+    public static IEnumerator Share(string path, string fileName, string subject, byte[] bytes = null)
+    {
+        Debug.Log("Share " + fileName);
 
-        Destroy(texture);
+#if UNITY_IPHONE || UNITY_ANDROID
 
-#else
-        while (!photoSaved)
+        if (Application.isMobilePlatform)
         {
-            yield return new WaitForSeconds(.5f);
-
-            photoSaved = true;
+            new NativeShare().AddFile(path).SetSubject(subject).Share();
         }
+
+#elif UNITY_WEBGL
+
+        DownloadScreenshot(bytes, fileName);
+
 #endif
-        if (callback)
-            ScreenshotFinishedSaving();
+        TraceLog.Instant("Shared");
+
+        yield break;
     }
 
     public static int ScreenShotNumber
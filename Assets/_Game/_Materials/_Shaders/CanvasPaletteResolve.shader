@@ -0,0 +1,48 @@
+Shader "Hidden/UnityCoder/CanvasPaletteResolve"
+{
+    // indexed canvas tile (R8, one palette index per pixel) to RGBA, used to write indexed tiles into the page texture
+    Properties
+    {
+        _MainTex("Index Tile (R8)", 2D) = "black" {}
+        _PaletteTex("Palette (256x1)", 2D) = "white" {}
+    }
+
+    SubShader
+    {
+        Cull Off ZWrite Off ZTest Always Blend Off
+
+        Pass
+        {
+            CGPROGRAM
+            #pragma vertex vert
+            #pragma fragment frag
+
+            #include "UnityCG.cginc"
+
+            sampler2D _MainTex;
+            sampler2D _PaletteTex;
+
+            struct v2f
+            {
+                float4 pos : SV_POSITION;
+                float2 uv : TEXCOORD0;
+            };
+
+            v2f vert(appdata_img v)
+            {
+                v2f o;
+                o.pos = UnityObjectToClipPos(v.vertex);
+                o.uv = v.texcoord;
+                return o;
+            }
+
+            fixed4 frag(v2f i) : SV_Target
+            {
+                // point sampled on both sides, the index picks the center of its palette texel
+                float index = tex2D(_MainTex, i.uv).r * 255.0;
+                return tex2D(_PaletteTex, float2((index + 0.5) / 256.0, 0.5));
+            }
+            ENDCG
+        }
+    }
+}
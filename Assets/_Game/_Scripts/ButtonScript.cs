@@ -14,6 +14,12 @@ public class ButtonScript : MonoBehaviour, IPointerDownHandler, IPointerUpHandle
 
     private float currentScale = 1f, moveTime = 1f;
     private Vector3 startPosition, endPosition;
+    private int tweens = 0; // StartMyMoveAction coroutines running on this button
+
+    private static int movingCount = 0;
+
+    // StartMyMoveAction coroutines running on any button, IdleRendering keeps full rate for them
+    public static int Moving { get { return movingCount; } }
 
     private void Awake()
     {
@@ -42,9 +48,20 @@ public class ButtonScript : MonoBehaviour, IPointerDownHandler, IPointerUpHandle
         onMyOwnEvent.Invoke();
     }
 
+    private void OnDisable()
+    {
+        // coroutines stop with the object
+        movingCount -= tweens;
+        tweens = 0;
+    }
+
     private IEnumerator TranslateToEndPos()
     {
+        tweens++;
+        movingCount++;
         yield return TranslationToEndPos(transform, transform.localPosition, endPosition, moveTime);
+        tweens--;
+        movingCount--;
     }
 
     private IEnumerator TranslationToEndPos(Transform thisTransform, Vector3 startPos, Vector3 endPos, float value)
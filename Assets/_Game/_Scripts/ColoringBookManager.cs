@@ -3,16 +3,23 @@ using UnityEngine.UI;
 using UnityEngine.SceneManagement;
 using System.Collections.Generic;
 using System.Collections;
-
-#if UNITY_WEBGL
 using System.IO;
+using Unity.Profiling;
+
+#if ENABLE_INPUT_SYSTEM
+using UnityEngine.InputSystem;
+using UnityEngine.InputSystem.LowLevel;
+using EnhancedTouch = UnityEngine.InputSystem.EnhancedTouch;
 #endif
 
-public class ColoringBookManager : MonoBehaviour
+public class ColoringBookManager : MonoBehaviour, IPaintController
 {
+    public static ColoringBookManager USE; // the resident paint scene, null until it was loaded
+
     #region variables
 
     public Material maskTexMaterial;
+    public Shader paletteResolveShader; // draws palette indexed canvas tiles into the canvas texture
     private Texture2D maskTex;
     public List<Sprite> maskTexList;
     public static int maskTexIndex = -1;
@@ -31,47 +38,58 @@ public class ColoringBookManager : MonoBehaviour
     private Color32 paintColor = new Color32(255, 0, 0, 255);
     private int brushSize = 8; // default brush size
     private DrawMode drawMode = DrawMode.Pencil;
-    private bool useLockArea = true;
-    private byte[] lockMaskPixels; // locking mask pixels
+    public bool useNativeKernels = true; // paint with the coloringcore library when it is built for this platform
+
+    // input recording and replay (InputLog), development builds
+    public bool recordInput = false; // every session goes to persistentDataPath/InputLogs
+    public TextAsset replayInput; // .bytes log replayed when the page opens
+    public bool replayAtRecordedSpeed = true; // false: as fast as possible
+    private InputLog recording;
+    private float recordingStart;
+    private bool replaying = false;
+    public bool traceLatency = false; // input to photon of every pointer sample (StrokeLatency), to persistentDataPath/Latency
+
+    // profiler markers of the paint kernels, PerfHud records the ones named here
+    public const string MousePaintMarkerName = "ColoringBook.MousePaint";
+    public const string FloodFillMarkerName = "ColoringBook.FloodFill";
+    private static readonly ProfilerMarker mousePaintMarker = new ProfilerMarker(ProfilerCategory.Scripts, MousePaintMarkerName);
+    private static readonly ProfilerMarker floodFillMarker = new ProfilerMarker(ProfilerCategory.Scripts, FloodFillMarkerName);
+    private static readonly ProfilerMarker drawCircleMarker = new ProfilerMarker(ProfilerCategory.Scripts, "ColoringBook.DrawCircle");
+    private static readonly ProfilerMarker drawAdditiveCircleMarker = new ProfilerMarker(ProfilerCategory.Scripts, "ColoringBook.DrawAdditiveCircle");
+    private static readonly ProfilerMarker drawLineMarker = new ProfilerMarker(ProfilerCategory.Scripts, "ColoringBook.DrawLine");
+    private static readonly ProfilerMarker drawAdditiveLineMarker = new ProfilerMarker(ProfilerCategory.Scripts, "ColoringBook.DrawAdditiveLine");
+    private static readonly ProfilerMarker drawStickerMarker = new ProfilerMarker(ProfilerCategory.Scripts, "ColoringBook.DrawSticker");
+    private static readonly ProfilerMarker areaLockMaskMarker = new ProfilerMarker(ProfilerCategory.Scripts, "ColoringBook.CreateAreaLockMask");
+    private static readonly ProfilerMarker updateTextureMarker = new ProfilerMarker(ProfilerCategory.Scripts, "ColoringBook.UpdateTexture");
+    private static readonly ProfilerMarker undoMarker = new ProfilerMarker(ProfilerCategory.Scripts, "ColoringBook.Undo");
+    private static readonly ProfilerMarker redoMarker = new ProfilerMarker(ProfilerCategory.Scripts, "ColoringBook.Redo");
+    private static readonly ProfilerMarker clearMarker = new ProfilerMarker(ProfilerCategory.Scripts, "ColoringBook.Clear");
+    private static readonly ProfilerMarker loadPageMarker = new ProfilerMarker(ProfilerCategory.Scripts, "ColoringBook.LoadPage");
+    private static readonly ProfilerMarker saveImageMarker = new ProfilerMarker(ProfilerCategory.Scripts, "ColoringBook.SaveImage");
+    private static readonly ProfilerMarker readMaskImageMarker = new ProfilerMarker(ProfilerCategory.Scripts, "ColoringBook.ReadMaskImage");
+    private static readonly ProfilerMarker duplicateTextureMarker = new ProfilerMarker(ProfilerCategory.Scripts, "ColoringBook.DuplicateTexture");
 
     // Stickers
     public Texture2D[] stickers;
     private int selectedSticker = 0; // currently selected sticker index
-    private byte[] stickerBytes;
-    private int stickerWidth;
-    private int stickerHeight;
-    private int stickerWidthHalf;
-    private int texWidthMinusStickerWidth;
-    private int texHeightMinusStickerHeight;
 
     // UNDO
-    private List<byte[]> undoPixels; // undo buffer(s)
-    private int redoIndex = 0;
-    private int RedoIndex
-    {
-        set
-        {
-            redoIndex = value;
-
-            UndoRedoButtons[0].image.sprite = UndoRedoButtons[0].sprites[undoPixels.Count - RedoIndex - 1 > 0 ? 0 : 1];
-            UndoRedoButtons[0].image.raycastTarget = undoPixels.Count - RedoIndex - 1 > 0;
-
-            UndoRedoButtons[1].image.sprite = UndoRedoButtons[1].sprites[undoPixels.Count > 0 && RedoIndex > 0 ? 0 : 1];
-            UndoRedoButtons[1].image.raycastTarget = undoPixels.Count > 0 && RedoIndex > 0;
-        }
-
-        get
-        {
-            return redoIndex;
-        }
-    }
+    private UndoHistory undoHistory; // painted tiles of each step
 
     //	*** private variables ***
-    private byte[] pixels; // byte array for texture painting, this is the image that we paint into.
+    private TiledCanvas canvas; // the image that we paint into, allocated per tile
+    private CanvasPainter painter; // brushes, sticker and fills on the canvas
     private byte[] maskPixels; // byte array for mask texture
-    private byte[] clearPixels; // byte array for clearing texture
 
-    private Texture2D tex; // texture that we paint into (it gets updated from pixels[] array when painted)
+    private CanvasTexture canvasTexture; // texture that we paint into (dirty tiles get uploaded from canvas when painted)
+
+    private CanvasViewport viewport = new CanvasViewport(); // zoomed and panned part of the page on screen
+    private Mesh boardMesh;
+    private bool gesturing = false; // pinch in progress, painting waits until all fingers are up
+    public float maxZoom = 8f;
+
+    public int freePaintWidth = 576; // page size without mask, e.g. 2048x3640 for print resolution
+    public int freePaintHeight = 1024;
 
     private int texWidth = 576;
     private int texHeight = 1024;
@@ -81,7 +99,30 @@ public class ColoringBookManager : MonoBehaviour
     private Vector2 pixelUV; // with mouse
     private Vector2 pixelUVOld; // with mouse
 
+    public bool smoothStrokes = true; // pencil and marker strokes follow a curve through the samples, not straight lines
+    private StrokeBatch strokeBatch = new StrokeBatch(); // page pixels of the pointer this frame
+    private List<Vector2> screenSamples = new List<Vector2>();
+#if ENABLE_INPUT_SYSTEM
+    private List<double> sampleTimes = new List<double>();
+    private double sampleTime; // input time of the last sample read, older ones belong to a frame already painted
+    private InputStateHistory<Vector2> pointerHistory; // positions of the mouse or pen of the stroke between frames
+    private Pointer historyPointer;
+#endif
+
     private bool textureNeedsUpdate = false; // if we have modified texture
+    private bool firstFrame = true; // toolbar and mask are on screen from the end of it
+    private bool pageReady = false; // the saved page is loaded, input paints from here on
+    private bool textureHasPage = false; // canvasTexture shows a page, not only white
+    private float awakeTime;
+    private System.Threading.Tasks.Task<TiledCanvas> pageDecode; // the worker decode OpenPageStaged waits for
+    private Coroutine openPageRoutine; // OpenPageStaged of the page being opened
+    private Coroutine replayRoutine; // ReplayInput on the open page
+
+    // pages left for the menu stay decoded (PageCache), reopening them skips decode and mask reading
+    public int cachedPages = 3;
+    public int pageCacheMB = 48;
+    private static PageCache pageCache;
+    private Material freePaintMaterial; // the board material of pages without mask
 
     ////////////////////////////////////////////////////
 
@@ -115,8 +156,7 @@ public class ColoringBookManager : MonoBehaviour
 
             changeThemeIndex = value;
 
-            PlayerPrefs.SetInt("Theme", value);
-            PlayerPrefs.Save();
+            GameSettings.SetInt("Theme", value);
 
             for (int i = 0; i < themes.spList.Count; i++)
             {
@@ -146,7 +186,10 @@ public class ColoringBookManager : MonoBehaviour
         }
     }
 
-    public GameObject waterMark;
+    public GameObject waterMark; // never shown, exports draw its sprite at its anchors (exportWatermark)
+    private static Watermark exportWatermark;
+    public PageImageWriter.Format exportFormat = PageImageWriter.Format.Jpg; // the screenshot button saves the page itself
+    public int exportScale = 1; // 4: print quality, streamed to the file
 
     #endregion
 
@@ -155,24 +198,43 @@ public class ColoringBookManager : MonoBehaviour
 
     private void Awake()
     {
+        TraceLog.Begin("ColoringBookManager.Awake");
+
+        USE = this;
+
+        // the menu may still be loaded, Camera.main has to be the camera of this scene from here on
+        ResidentScenes.Activate(gameObject.scene);
+
         Camera.main.aspect = 9 / 16f;
 
         GetComponent<Renderer>().sortingOrder = -99;
 
-        if (maskTexIndex < 0)
+        if (useNativeKernels && !PaintKernels.Native && PaintKernels.EnableNative())
         {
-            maskTex = null;
+            Debug.Log("Native paint kernels: " + PaintKernels.Backend);
         }
-        else
+
+        if (pageCache == null)
         {
-            maskTex = DuplicateTexture(maskTexList[maskTexIndex].texture);
+            pageCache = new PageCache(cachedPages, (long)pageCacheMB * 1024 * 1024);
+
+            MemoryGovernor.Register("page cache", MemoryGovernor.Tier.PageCache, () => pageCache.Bytes, ShedPageCache);
         }
 
+        IdleRendering.Register("page", () => textureNeedsUpdate || replaying);
+
+        awakeTime = Time.realtimeSinceStartup;
+
         InitializeEverything();
+
+        TraceLog.End("ColoringBookManager.Awake");
     }
 
-    private Texture2D DuplicateTexture(Texture2D source)
+    // a readable copy of a mask texture, main thread
+    public static Texture2D DuplicateTexture(Texture2D source)
     {
+        TraceLog.Begin("ColoringBookManager.DuplicateTexture");
+
         RenderTexture renderTex = RenderTexture.GetTemporary(
                     source.width,
                     source.height,
@@ -184,9 +246,14 @@ public class ColoringBookManager : MonoBehaviour
         RenderTexture.active = renderTex;
         Texture2D readableText = new Texture2D(source.width, source.height);
         readableText.ReadPixels(new Rect(0, 0, renderTex.width, renderTex.height), 0, 0);
-        readableText.Apply();
+        using (TraceLog.Auto("DuplicateTexture Apply"))
+        {
+            readableText.Apply();
+        }
         RenderTexture.active = previous;
         RenderTexture.ReleaseTemporary(renderTex);
+
+        TraceLog.End("ColoringBookManager.DuplicateTexture");
         return readableText;
     }
 
@@ -194,80 +261,430 @@ public class ColoringBookManager : MonoBehaviour
     {
         CreateFullScreenQuad();
 
-        // create texture
-        if (maskTex)
+        viewport.maxZoom = maxZoom;
+        freePaintMaterial = GetComponent<Renderer>().sharedMaterial;
+
+        SetupPage();
+    }
+
+    // board material, page texture and a white stand-in page for the page picked in maskTexIndex
+    private void SetupPage()
+    {
+        viewport.Reset();
+        maskPixels = null;
+
+        // create texture, the imported mask is drawn as it is until its pixels are read
+        if (maskTexIndex >= 0)
         {
+            Texture2D mask = maskTexList[maskTexIndex].texture;
             GetComponent<Renderer>().material = maskTexMaterial;
 
-            texWidth = maskTex.width;
-            texHeight = maskTex.height;
-            GetComponent<Renderer>().material.SetTexture("_MaskTex", maskTex);
-
-            useLockArea = true;
+            texWidth = mask.width;
+            texHeight = mask.height;
+            GetComponent<Renderer>().material.SetTexture("_MaskTex", mask);
         }
         else
         {
-            texWidth = 576;
-            texHeight = 1024;
+            GetComponent<Renderer>().material = freePaintMaterial;
 
-            useLockArea = false;
+            texWidth = freePaintWidth;
+            texHeight = freePaintHeight;
         }
 
         if (!GetComponent<Renderer>().material.HasProperty("_MainTex")) Debug.LogError("Fatal error: Current shader doesn't have a property: '_MainTex'");
 
+        // the resident scene keeps the texture when the next page has the same size
+        if (canvasTexture != null && (canvasTexture.texture.width != texWidth || canvasTexture.texture.height != texHeight))
+        {
+            canvasTexture.Destroy();
+            canvasTexture = null;
+        }
 
-        // create new texture
-        tex = new Texture2D(texWidth, texHeight, TextureFormat.RGBA32, false);
-        GetComponent<Renderer>().material.SetTexture("_MainTex", tex);
+        if (canvasTexture == null)
+        {
+            canvasTexture = new CanvasTexture(texWidth, texHeight, paletteResolveShader);
+            textureHasPage = false;
+        }
 
-        // init pixels array
-        pixels = new byte[texWidth * texHeight * 4];
+        canvasTexture.Bind(GetComponent<Renderer>().material);
 
-        OnClearButtonClicked();
+        // a white stand-in page, so the toolbar works before OpenPageStaged has loaded the saved one
+        CanvasPainter previous = painter;
+        ReleasePage();
 
-        // set texture modes
-        tex.filterMode = FilterMode.Point;
-        tex.wrapMode = TextureWrapMode.Clamp;
-        //tex.wrapMode = TextureWrapMode.Repeat;
+        canvas = new TiledCanvas(texWidth, texHeight);
+        undoHistory = new UndoHistory();
+        painter = new CanvasPainter(canvas, null);
 
-        if (maskTex)
+        if (previous != null)
         {
-            ReadMaskImage();
+            painter.CopySettings(previous);
         }
+        else
+        {
+            painter.brushSize = brushSize;
+            painter.SetColor(paintColor.r, paintColor.g, paintColor.b, paintColor.a);
+        }
+    }
+
+    // shows the page picked in maskTexIndex / ID on the resident scene (ScrollListManager.LoadGame),
+    // straight from the page cache when it is there
+    public void OpenPage()
+    {
+        StopPageRoutines();
+
+        firstFrame = true;
+        pageReady = false;
+        awakeTime = Time.realtimeSinceStartup;
+
+        SetupPage();
+
+        PageCache.Page cached = pageCache.Take(ID);
+        if (cached != null && cached.maskIndex == maskTexIndex)
+        {
+            TraceLog.Begin("Page Stage: Cached");
+            maskPixels = cached.maskPixels;
+            ShowPage(cached.canvas);
+            TraceLog.End("Page Stage: Cached");
+
+            PageOpened();
+        }
+        else
+        {
+            if (cached != null) cached.canvas.Release();
+
+            openPageRoutine = StartCoroutine(OpenPageStaged());
+        }
+    }
+
+    // the opening and the replay of the page before, exports go on (they run on Services)
+    private void StopPageRoutines()
+    {
+        if (openPageRoutine != null) StopCoroutine(openPageRoutine);
+        if (replayRoutine != null) StopCoroutine(replayRoutine);
+
+        openPageRoutine = null;
+        replayRoutine = null;
+        replaying = false;
+
+        AbandonPageDecode();
+    }
+
+    // hands the page to the page cache when leaving for the menu, the hidden scene keeps no canvas
+    private void StashPage()
+    {
+        if (!pageReady) return;
+
+        undoHistory.Clear();
+        painter.Release();
+
+        pageCache.Put(ID, maskTexIndex, canvas, maskPixels);
+        canvas = null;
+        pageReady = false;
+    }
+
+    // over budget the most recent page stays, on a low memory warning none
+    private static long ShedPageCache(bool lowMemory)
+    {
+        return pageCache.TrimTo(lowMemory ? 0 : 1, long.MaxValue);
+    }
+
+    // page opening after the first frame (Awake and Start are the UI stage): the mask pixels are read on the main
+    // thread while the saved page is decoded on a worker, then the page is uploaded and input is enabled
+    private IEnumerator OpenPageStaged()
+    {
+        yield return null; // toolbar and mask preview go on screen first
+
+        TraceLog.Begin("Page Stage: Read");
+        PageStore.Page saved = PageStore.Read(ID); // PlayerPrefs only works on the main thread
+        TraceLog.End("Page Stage: Read");
+
+        TiledCanvas loadCanvas = null;
+#if UNITY_WEBGL
+        // no threads, decode in this frame
+        loadCanvas = DecodeSavedPage(saved, texWidth, texHeight);
+#else
+        // the next OpenPage sets texWidth and texHeight, the worker gets the size of this one
+        int width = texWidth;
+        int height = texHeight;
+        pageDecode = System.Threading.Tasks.Task.Run(() => DecodeSavedPage(saved, width, height));
+#endif
+
+        if (maskTexIndex >= 0)
+        {
+            TraceLog.Begin("Page Stage: Mask");
+
+            using (duplicateTextureMarker.Auto())
+            {
+                maskTex = DuplicateTexture(maskTexList[maskTexIndex].texture);
+            }
+
+            using (readMaskImageMarker.Auto())
+            {
+                ReadMaskImage();
+            }
+
+            ReleaseMaskDuplicate();
+
+            TraceLog.End("Page Stage: Mask");
+        }
+
+#if !UNITY_WEBGL
+        while (!pageDecode.IsCompleted)
+        {
+            yield return null;
+        }
+
+        System.Threading.Tasks.Task<TiledCanvas> decode = pageDecode;
+        pageDecode = null;
+
+        if (decode.IsFaulted)
+        {
+            Debug.LogException(decode.Exception);
+        }
+        else
+        {
+            loadCanvas = decode.Result;
+        }
+#endif
+
+        TraceLog.Begin("Page Stage: Upload");
+        ShowPage(loadCanvas);
+        TraceLog.End("Page Stage: Upload");
+
+        PageOpened();
+    }
+
+    // the page takes input from here on
+    private void PageOpened()
+    {
+        MemoryGovernor.Register("undo history", MemoryGovernor.Tier.UndoHistory, () => UndoBytes, ShedUndoHistory);
+
+        pageReady = true;
+        IdleRendering.Wake();
+        TraceLog.Instant("Page Ready");
+
+#if UNITY_EDITOR || DEVELOPMENT_BUILD
+        Debug.Log("Page " + ID + " ready " + Mathf.RoundToInt((Time.realtimeSinceStartup - awakeTime) * 1000) + " ms after opening");
+
+        if (recordInput)
+        {
+            Recording = InputLog.Begin(canvas, maskTexIndex);
+        }
+
+        if (traceLatency)
+        {
+            StrokeLatency.Start();
+        }
+#endif
+
+        if (replayInput != null)
+        {
+            replayRoutine = StartCoroutine(ReplayInput(InputLog.Decode(replayInput.bytes), replayAtRecordedSpeed));
+        }
+    }
+
+    // worker thread, null for a blank page
+    private static TiledCanvas DecodeSavedPage(PageStore.Page saved, int width, int height)
+    {
+        if (saved == null) return null;
+
+        using (TraceLog.Auto("Page Stage: Decode"))
+        {
+            return saved.Decode(width, height);
+        }
+    }
+
+    // OpenPageStaged was stopped while its decode ran (another page opened, the scene went away), the canvas it
+    // decodes goes back to the pool when it is done
+    private void AbandonPageDecode()
+    {
+        if (pageDecode == null) return;
+
+        pageDecode.ContinueWith(t =>
+        {
+            if (t.Status == System.Threading.Tasks.TaskStatus.RanToCompletion && t.Result != null) t.Result.Release();
+        });
+        pageDecode = null;
+    }
+
+    // the saved page (CanvasPageEncoder data) or a blank one, with a fresh undo history
+    private void LoadPage(byte[] data)
+    {
+        TiledCanvas loadCanvas;
+        using (TraceLog.Auto("CanvasPageEncoder.Decode"))
+        {
+            loadCanvas = CanvasPageEncoder.Decode(data, texWidth, texHeight);
+        }
+
+        ShowPage(loadCanvas);
+    }
+
+    // replaces the page with a decoded one (null: blank), with a fresh undo history
+    private void ShowPage(TiledCanvas loadCanvas)
+    {
+        loadPageMarker.Begin();
+        TraceLog.Begin("ColoringBookManager.LoadPage");
+
+        CanvasPainter previous = painter;
+        ReleasePage();
+
+        // create new canvas, every tile starts as the shared white tile
+        canvas = new TiledCanvas(texWidth, texHeight);
 
         // undo system
-        undoPixels = new List<byte[]>();
-        undoPixels.Add(new byte[texWidth * texHeight * 4]);
-        RedoIndex = 0;
+        undoHistory = new UndoHistory();
+        UpdateUndoRedoButtons();
 
-        byte[] loadPixels = new byte[texWidth * texHeight * 4];
-        loadPixels = LoadImage(ID);
+        if (loadCanvas != null)
+        {
+            if (loadCanvas.width == texWidth && loadCanvas.height == texHeight)
+            {
+                canvas = loadCanvas;
+            }
+            else
+            {
+                Debug.LogWarning("Saved page " + ID + " is " + loadCanvas.width + "x" + loadCanvas.height + ", expected " + texWidth + "x" + texHeight);
+                loadCanvas.Release();
+            }
+        }
 
-        if (loadPixels != null)
+        // mask pages are colored from the color panels, store them as palette indices
+        if (maskPixels != null)
         {
-            pixels = loadPixels;
-            System.Array.Copy(pixels, undoPixels[0], pixels.Length);
+            int paletteCount;
+            byte[] palette = CreatePanelPalette(out paletteCount);
+            canvas.SetPalette(palette, paletteCount);
+        }
+
+        canvasTexture.SetPalette(canvas);
 
-            tex.LoadRawTextureData(pixels);
-            tex.Apply(false);
+        // a texture that showed a page gets every tile replaced, a white one only the painted ones
+        TraceLog.Begin("CanvasTexture.Upload");
+        bool uploaded;
+        if (textureHasPage)
+        {
+            uploaded = canvasTexture.UploadAll(canvas);
         }
         else
         {
-            System.Array.Copy(pixels, undoPixels[0], pixels.Length);
+            uploaded = canvasTexture.Upload(canvas);
+        }
+        if (!uploaded) textureNeedsUpdate = true;
+        textureHasPage = true;
+        TraceLog.End("CanvasTexture.Upload");
+
+        // mask pages lock strokes to the area they start in
+        painter = new CanvasPainter(canvas, maskPixels);
+        painter.CopySettings(previous);
+
+        wentOutside = true;
+
+        TraceLog.End("ColoringBookManager.LoadPage");
+        loadPageMarker.End();
+    }
+
+    // white first (blank tiles are index 0), then every distinct color of the pencil, marker and bucket panels
+    private byte[] CreatePanelPalette(out int count)
+    {
+        byte[] palette = new byte[TiledCanvas.MaxPaletteSize * 4];
+        palette[0] = palette[1] = palette[2] = palette[3] = 255;
+        count = 1;
+
+        for (int mode = (int)DrawMode.Pencil; mode <= (int)DrawMode.PaintBucket; mode++)
+        {
+            for (int i = 0; i < PanelColors[mode].childCount; i++)
+            {
+                Image image = PanelColors[mode].GetChild(i).GetComponent<Image>();
+                if (image == null) continue;
+
+                Color32 color = image.color;
+                bool found = false;
+
+                for (int p = 0; p < count * 4 && !found; p += 4)
+                {
+                    found = palette[p] == color.r && palette[p + 1] == color.g && palette[p + 2] == color.b && palette[p + 3] == color.a;
+                }
+
+                if (found) continue;
+
+                if (count == TiledCanvas.MaxPaletteSize)
+                {
+                    Debug.LogWarning("More than " + TiledCanvas.MaxPaletteSize + " panel colors, the rest paint as RGBA tiles");
+                    return palette;
+                }
+
+                palette[count * 4] = color.r;
+                palette[count * 4 + 1] = color.g;
+                palette[count * 4 + 2] = color.b;
+                palette[count * 4 + 3] = color.a;
+                count++;
+            }
+        }
+
+        return palette;
+    }
+
+    private void OnEnable()
+    {
+#if ENABLE_INPUT_SYSTEM
+        // the touch history of a frame
+        EnhancedTouch.EnhancedTouchSupport.Enable();
+#endif
+    }
+
+    private void OnDisable()
+    {
+#if ENABLE_INPUT_SYSTEM
+        EnhancedTouch.EnhancedTouchSupport.Disable();
+
+        if (pointerHistory != null)
+        {
+            pointerHistory.Dispose();
+            pointerHistory = null;
+            historyPointer = null;
         }
+#endif
+    }
+
+    private void OnDestroy()
+    {
+        if (USE == this) USE = null;
+
+        SaveInputLog();
+
+        MemoryGovernor.Unregister("undo history");
+        IdleRendering.Unregister("page");
 
-        // locking mask enabled
-        if (useLockArea)
+        ReleasePage();
+        AbandonPageDecode();
+
+        if (canvasTexture != null)
         {
-            lockMaskPixels = new byte[texWidth * texHeight * 4];
+            canvasTexture.Destroy();
         }
     }
 
+    // the tiles, undo steps and fill buffers of the open page go back to the pool
+    private void ReleasePage()
+    {
+        if (undoHistory != null) undoHistory.Clear();
+        if (canvas != null) canvas.Release();
+        if (painter != null) painter.Release();
+    }
+
+    private void OnApplicationPause(bool pause)
+    {
+        // the app may not come back
+        if (pause) SaveInputLog();
+    }
+
     private void CreateFullScreenQuad()
     {
         Camera cam = Camera.main;
         // create mesh plane, fits in camera view (with screensize adjust taken into consideration)
         Mesh go_Mesh = GetComponent<MeshFilter>().mesh;
+        boardMesh = go_Mesh;
         go_Mesh.Clear();
         go_Mesh.vertices = new[] {
                 cam.ScreenToWorldPoint(new Vector3(0, 0, cam.nearClipPlane + 0.1f)), // bottom left
@@ -289,61 +706,95 @@ public class ColoringBookManager : MonoBehaviour
 
     private void ReadMaskImage()
     {
-        maskPixels = new byte[texWidth * texHeight * 4];
+        TraceLog.Begin("ColoringBookManager.ReadMaskImage");
 
-        int pixel = 0;
-        for (int y = 0; y < texHeight; y++)
+        // the copy is RGBA32 with the bottom row first, the same bytes GetPixel gives per pixel
+        maskPixels = maskTex.GetPixelData<byte>(0).ToArray();
+
+        TraceLog.End("ColoringBookManager.ReadMaskImage");
+    }
+
+    // the pixels of the waterMark sprite, placed on the page where its anchors put it on screen
+    private Watermark CreateWatermark()
+    {
+        TraceLog.Begin("ColoringBookManager.CreateWatermark");
+
+        Sprite sprite = waterMark.GetComponent<Image>().sprite;
+        Rect rect = sprite.textureRect;
+
+        // sprites may be packed in an atlas, the copy is cut to the sprite
+        Texture2D copy = DuplicateTexture(sprite.texture);
+        Color32[] colors = copy.GetPixels32();
+        Destroy(copy);
+
+        int width = (int)rect.width;
+        int height = (int)rect.height;
+        byte[] rgba = new byte[width * height * 4];
+        for (int y = 0; y < height; y++)
         {
-            for (int x = 0; x < texWidth; x++)
+            for (int x = 0; x < width; x++)
             {
-                Color c = maskTex.GetPixel(x, y);
-                maskPixels[pixel] = (byte)(c.r * 255);
-                maskPixels[pixel + 1] = (byte)(c.g * 255);
-                maskPixels[pixel + 2] = (byte)(c.b * 255);
-                maskPixels[pixel + 3] = (byte)(c.a * 255);
-                pixel += 4;
+                Color32 c = colors[((int)rect.y + y) * sprite.texture.width + (int)rect.x + x];
+                int o = (y * width + x) * 4;
+                rgba[o] = c.r;
+                rgba[o + 1] = c.g;
+                rgba[o + 2] = c.b;
+                rgba[o + 3] = c.a;
             }
         }
+
+        RectTransform anchors = waterMark.GetComponent<RectTransform>();
+        Watermark watermark = new Watermark(rgba, width, height, anchors.anchorMin.x, anchors.anchorMin.y, anchors.anchorMax.x, anchors.anchorMax.y);
+
+        TraceLog.End("ColoringBookManager.CreateWatermark");
+        return watermark;
     }
 
-    private byte[] LoadImage(string key)
+    // the readable copy was only needed for ReadMaskImage, the material samples the imported texture it was made from
+    private void ReleaseMaskDuplicate()
     {
-#if UNITY_WEBGL
-        string file = Application.persistentDataPath + "/Portrait" + key + ".sav";
-        if (File.Exists(file))
-        {
-            return System.Convert.FromBase64String(File.ReadAllText(file));
-        }
-        else
-        {
-            return null;
-        }
-#else
-        if (PlayerPrefs.HasKey(key))
-        {
-            return System.Convert.FromBase64String(PlayerPrefs.GetString(key));
-        }
-        else
-        {
-            return null;
-        }
-#endif
+        long bytes = (long)maskTex.width * maskTex.height * 4 * 4 / 3; // RGBA32 with mipmaps
+
+        Destroy(maskTex);
+        maskTex = null;
+
+        MemoryGovernor.Log("mask texture copy released", bytes);
+    }
+
+    // keeps the newest undo steps, fewer on a low memory warning
+    private long ShedUndoHistory(bool lowMemory)
+    {
+        long bytes = undoHistory.TrimTo(lowMemory ? MemoryGovernor.USE.lowMemoryUndoSteps : MemoryGovernor.USE.undoSteps);
+        UpdateUndoRedoButtons();
+        return bytes;
+    }
+
+    // the saved pages were replaced (ProgressBackup), decoded copies of them are stale
+    public static void ForgetPages()
+    {
+        if (pageCache != null) pageCache.Clear();
     }
 
     private void SaveImage(string key)
     {
-#if UNITY_WEBGL
-        string file = Application.persistentDataPath + "/Portrait" + key + ".sav";
-        string fileData = System.Convert.ToBase64String(pixels);
-        File.WriteAllText(file, fileData);
-#else
-        PlayerPrefs.SetString(key, System.Convert.ToBase64String(pixels));
-        PlayerPrefs.Save();
-#endif
+        // the saved page is still loading, the stand-in must not replace it
+        if (!pageReady) return;
+
+        saveImageMarker.Begin();
+        TraceLog.Begin("ColoringBookManager.SaveImage");
+
+        byte[] data = CanvasPageEncoder.Encode(canvas);
+        PageStore.Write(key, data, data.Length);
+        PageStore.Save();
+
+        TraceLog.End("ColoringBookManager.SaveImage");
+        saveImageMarker.End();
     }
 
     private void Start()
     {
+        TraceLog.Begin("ColoringBookManager.Start");
+
 #if UNITY_ANDROID
         if (JavadRastadAndroidRuntimePermissions.CheckDeniedStoragePermissions())
         {
@@ -362,6 +813,10 @@ public class ColoringBookManager : MonoBehaviour
         OnStickerButtonClicked(PanelColors[(int)DrawMode.Sticker].GetChild(0).GetComponent<ButtonScript>());
 
         LoadSetting();
+
+        TraceLog.End("ColoringBookManager.Start");
+
+        openPageRoutine = StartCoroutine(OpenPageStaged());
     }
 
     private void SetPanelsUIScale(int current)
@@ -387,19 +842,111 @@ public class ColoringBookManager : MonoBehaviour
         musicButtonController.image.sprite = musicButtonController.sprites[(int)AudioListener.volume];
 
         // Theme
-        ChangeThemeIndex = PlayerPrefs.GetInt("Theme", 0);
+        ChangeThemeIndex = GameSettings.GetInt("Theme", 0);
     }
 
     private void LateUpdate()
     {
-        MousePaint();
+        if (firstFrame)
+        {
+            // begun by ScrollListManager.LoadGame, the page is on screen and takes input from here on
+            firstFrame = false;
+            TraceLog.End("Open Page");
+        }
+
+        if (!ViewportGesture() && !replaying && pageReady)
+        {
+            using (mousePaintMarker.Auto())
+            {
+                MousePaint();
+            }
+        }
+
+        // pointer samples of this frame, from the mouse, a replay or a test, are in the canvas
+        StrokeLatency.Painted();
+
+        UpdateViewport();
+
+        using (updateTextureMarker.Auto())
+        {
+            UpdateTexture();
+        }
+
+        if (!textureNeedsUpdate) StrokeLatency.Uploaded();
+    }
+
+    private void OnApplicationFocus(bool focus)
+    {
+        // the page texture may have lost its content with the graphics context
+        if (focus) textureNeedsUpdate = true;
+    }
+
+    // pinch zoom and two finger pan, mouse wheel and middle button in the editor
+    private bool ViewportGesture()
+    {
+        Camera cam = Camera.main;
+
+        if (Input.touchCount >= 2)
+        {
+            gesturing = true;
+
+            Touch touch0 = Input.GetTouch(0);
+            Touch touch1 = Input.GetTouch(1);
+
+            Vector2 previous0 = touch0.position - touch0.deltaPosition;
+            Vector2 previous1 = touch1.position - touch1.deltaPosition;
+
+            float previousDistance = Vector2.Distance(previous0, previous1);
+            float distance = Vector2.Distance(touch0.position, touch1.position);
+
+            if (previousDistance > 0f)
+            {
+                viewport.ZoomAround(cam.ScreenToViewportPoint((previous0 + previous1) * 0.5f), cam.ScreenToViewportPoint((touch0.position + touch1.position) * 0.5f), distance / previousDistance);
+            }
+        }
+        else if (gesturing && Input.touchCount == 0)
+        {
+            gesturing = false;
+        }
 
-        UpdateTexture();
+        if (gesturing)
+        {
+            wentOutside = true; // don't connect the next stroke to the one before the pinch
+            return true;
+        }
+
+        if (Input.mouseScrollDelta.y != 0f)
+        {
+            Vector2 mouse = cam.ScreenToViewportPoint(Input.mousePosition);
+            viewport.ZoomAround(mouse, mouse, Mathf.Pow(1.1f, Input.mouseScrollDelta.y));
+        }
+
+        if (Input.GetMouseButton(2))
+        {
+            viewport.Pan(new Vector2(Input.GetAxis("Mouse X") * 0.05f, Input.GetAxis("Mouse Y") * 0.05f));
+            return true;
+        }
+
+        return false;
+    }
+
+    private void UpdateViewport()
+    {
+        if (!viewport.Changed) return;
+
+        viewport.ApplyTo(boardMesh);
+        canvasTexture.SetMipmapped(viewport.IsMinified(texWidth, Camera.main.pixelWidth));
+
+        // tiles that scrolled into view may still be dirty
+        textureNeedsUpdate = true;
     }
 
     private void MousePaint()
     {
-        if (Input.GetMouseButtonDown(0) || Input.GetMouseButton(0))
+        bool down = Input.GetMouseButtonDown(0);
+        bool held = Input.GetMouseButton(0);
+
+        if (down || held)
         {
             RaycastHit hit;
             Ray ray = Camera.main.ScreenPointToRay(Input.mousePosition);
@@ -421,121 +968,246 @@ public class ColoringBookManager : MonoBehaviour
             }
         }
 
-        if (Input.GetMouseButtonDown(0))
+        if (down)
         {
-            if (useLockArea)
+            if (!Physics.Raycast(Camera.main.ScreenPointToRay(Input.mousePosition), out hit, Mathf.Infinity, 1))
             {
-                if (!Physics.Raycast(Camera.main.ScreenPointToRay(Input.mousePosition), out hit, Mathf.Infinity, 1)) return;
-                CreateAreaLockMask((int)(hit.textureCoord.x * texWidth), (int)(hit.textureCoord.y * texHeight));
+                // a stroke can not start outside the lock area
+                if (!painter.useLockArea) wentOutside = true;
+                return;
             }
 
+#if ENABLE_INPUT_SYSTEM
+            BeginInputHistory();
+#endif
+            PaintDown(HitPixel());
+        }
+
+        if (Input.GetMouseButtonUp(0))
+        {
             if (!Physics.Raycast(Camera.main.ScreenPointToRay(Input.mousePosition), out hit, Mathf.Infinity, 1)) { wentOutside = true; return; }
 
-            pixelUVOld = pixelUV; // take previous value, so can compare them
-            pixelUV = hit.textureCoord;
-            pixelUV.x *= texWidth;
-            pixelUV.y *= texHeight;
+            PaintUp(HitPixel());
+        }
 
-            if (wentOutside) { pixelUVOld = pixelUV; wentOutside = false; }
+        if (held && !down)
+        {
+            bool brush = drawMode == DrawMode.Pencil || drawMode == DrawMode.Marker;
+            strokeBatch.spacing = smoothStrokes && brush ? brushSize * 0.5f : 0f;
+            strokeBatch.repeatSamples = drawMode == DrawMode.Marker; // every held frame blends, like a resting pen
 
-            // lets paint where we hit
-            switch (drawMode)
+            ReadSamples(screenSamples);
+            for (int i = 0; i < screenSamples.Count; i++)
             {
-                case DrawMode.Sticker: // Sticker
-                    DrawSticker((int)pixelUV.x, (int)pixelUV.y);
-                    break;
+                // Only if we hit something, then we continue
+                if (!Physics.Raycast(Camera.main.ScreenPointToRay(screenSamples[i]), out hit, Mathf.Infinity, 1))
+                {
+                    PaintBatch();
+                    strokeBatch.Break();
+                    wentOutside = true;
+                    continue;
+                }
 
-                default: // unknown mode
-                    break;
+                StrokeLatency.Input();
+                Vector2 pixel = HitPixel();
+                strokeBatch.Add(pixel.x, pixel.y);
             }
 
-            textureNeedsUpdate = true;
+            PaintBatch();
         }
+    }
 
-        if (Input.GetMouseButtonUp(0))
+    // screen positions of the pointer since the last frame, oldest first: every sample the device reported (the
+    // touch history, the recorded mouse or pen positions), one per frame from the input manager without the Input System
+    private void ReadSamples(List<Vector2> samples)
+    {
+        samples.Clear();
+
+#if ENABLE_INPUT_SYSTEM
+        ReadInputHistory(samples);
+        if (samples.Count > 0) return;
+#endif
+
+        // nothing new, the pointer rests and paints again where it is
+        samples.Add(Input.touchCount > 0 ? Input.GetTouch(0).position : (Vector2)Input.mousePosition);
+    }
+
+#if ENABLE_INPUT_SYSTEM
+    // at the pointer down of a stroke: mouse and pen positions are recorded from here on
+    private void BeginInputHistory()
+    {
+        sampleTime = InputState.currentTime;
+
+        Pointer pointer = Pointer.current;
+        if (pointerHistory != null && historyPointer == pointer)
         {
-            if (!Physics.Raycast(Camera.main.ScreenPointToRay(Input.mousePosition), out hit, Mathf.Infinity, 1)) { wentOutside = true; return; }
+            pointerHistory.Clear();
+            return;
+        }
+
+        if (pointerHistory != null) pointerHistory.Dispose();
+        pointerHistory = null;
+        historyPointer = pointer;
+
+        if (pointer != null)
+        {
+            pointerHistory = new InputStateHistory<Vector2>(pointer.position);
+            pointerHistory.StartRecording();
+        }
+    }
 
-            // when starting, grab undo buffer first
-            if (RedoIndex > 0)
+    private void ReadInputHistory(List<Vector2> samples)
+    {
+        sampleTimes.Clear();
+        double newest = sampleTime;
+
+        if (EnhancedTouch.Touch.activeTouches.Count > 0)
+        {
+            // the updates of the touch in this frame and its current state
+            EnhancedTouch.Touch touch = EnhancedTouch.Touch.activeTouches[0];
+            EnhancedTouch.TouchHistory history = touch.history;
+            for (int i = 0; i < history.Count; i++)
             {
-                undoPixels.RemoveRange(undoPixels.Count - RedoIndex, RedoIndex);
+                AddSample(samples, history[i].screenPosition, history[i].time, ref newest);
             }
+            AddSample(samples, touch.screenPosition, touch.time, ref newest);
+        }
+        else if (pointerHistory != null)
+        {
+            for (int i = 0; i < pointerHistory.Count; i++)
+            {
+                AddSample(samples, pointerHistory[i].ReadValue(), pointerHistory[i].time, ref newest);
+            }
+            pointerHistory.Clear();
+        }
 
-            undoPixels.Add(new byte[texWidth * texHeight * 4]);
-            System.Array.Copy(pixels, undoPixels[undoPixels.Count - 1], pixels.Length);
+        sampleTime = newest;
+    }
 
-            RedoIndex = 0;
-        }
+    // in time order whatever order the history comes in; a sample read before or seen twice is left out
+    private void AddSample(List<Vector2> samples, Vector2 position, double time, ref double newest)
+    {
+        if (time <= sampleTime) return;
 
-        if (Input.GetMouseButtonDown(0) || Input.GetMouseButton(0))
-        {
-            // Only if we hit something, then we continue
-            if (!Physics.Raycast(Camera.main.ScreenPointToRay(Input.mousePosition), out hit, Mathf.Infinity, 1)) { wentOutside = true; return; }
+        int at = sampleTimes.Count;
+        while (at > 0 && sampleTimes[at - 1] > time) at--;
+        if (at > 0 && sampleTimes[at - 1] == time) return;
+
+        samples.Insert(at, position);
+        sampleTimes.Insert(at, time);
+        if (time > newest) newest = time;
+    }
+#endif
 
-            pixelUVOld = pixelUV; // take previous value, so can compare them
-            pixelUV = hit.textureCoord;
-            pixelUV.x *= texWidth;
-            pixelUV.y *= texHeight;
+    // the polyline of the frame: every point recorded like a pointer move, their brush stamps painted in one pass,
+    // uploaded once in UpdateTexture
+    private void PaintBatch()
+    {
+        for (int i = 0; i < strokeBatch.Count; i++)
+        {
+            PaintMove(new Vector2(strokeBatch.X(i), strokeBatch.Y(i)));
+        }
 
-            if (wentOutside) { pixelUVOld = pixelUV; wentOutside = false; }
+        PaintStamps();
+        strokeBatch.Clear();
+    }
 
-            // lets paint where we hit
-            switch (drawMode)
+    // the pencil or marker stamps PaintAt and PaintMove queued, in one pass over the tiles they touch
+    private void PaintStamps()
+    {
+        if (drawMode == DrawMode.Marker)
+        {
+            using (drawAdditiveCircleMarker.Auto())
             {
-                case DrawMode.Pencil: // drawing
-                    DrawCircle((int)pixelUV.x, (int)pixelUV.y);
-                    break;
+                painter.DrawQueued(true);
+            }
+        }
+        else
+        {
+            using (drawCircleMarker.Auto())
+            {
+                painter.DrawQueued(false);
+            }
+        }
+    }
 
-                case DrawMode.Marker: // drawing
-                    DrawAdditiveCircle((int)pixelUV.x, (int)pixelUV.y);
-                    break;
+    // page pixel of the last raycast hit
+    private Vector2 HitPixel()
+    {
+        Vector2 pixel = hit.textureCoord;
+        pixel.x *= texWidth;
+        pixel.y *= texHeight;
+        return pixel;
+    }
 
-                //case DrawMode.Sticker: // Sticker
-                //    DrawSticker((int)pixelUV.x, (int)pixelUV.y);
-                //    break;
+    private void PaintDown(Vector2 pixel)
+    {
+        StrokeLatency.Input();
+        Record(InputLog.EventType.PointerDown, pixel);
 
-                case DrawMode.PaintBucket: // floodfill
-                    if (maskTex)
-                    {
-                        FloodFillMaskOnlyWithThreshold((int)pixelUV.x, (int)pixelUV.y);
-                    }
-                    else
-                    {
-                        FloodFillWithTreshold((int)pixelUV.x, (int)pixelUV.y);
-                    }
-                    break;
+        strokeBatch.Begin(pixel.x, pixel.y);
 
-                default: // unknown mode
-                    break;
+        if (painter.useLockArea)
+        {
+            using (areaLockMaskMarker.Auto())
+            {
+                painter.CreateAreaLockMask((int)pixel.x, (int)pixel.y);
             }
+        }
 
-            textureNeedsUpdate = true;
+        pixelUVOld = pixelUV; // take previous value, so can compare them
+        pixelUV = pixel;
+
+        if (wentOutside) { pixelUVOld = pixelUV; wentOutside = false; }
+
+        // lets paint where we hit
+        switch (drawMode)
+        {
+            case DrawMode.Sticker: // Sticker
+                using (drawStickerMarker.Auto())
+                {
+                    painter.DrawSticker((int)pixelUV.x, (int)pixelUV.y);
+                }
+                break;
+
+            default: // unknown mode
+                break;
         }
 
-        if (Input.GetMouseButtonDown(0))
-        {
-            // take this position as start position
-            if (!Physics.Raycast(Camera.main.ScreenPointToRay(Input.mousePosition), out hit, Mathf.Infinity, 1)) return;
+        PaintAt(pixel);
+        PaintStamps();
 
-            pixelUVOld = pixelUV;
-        }
+        // take this position as start position
+        pixelUVOld = pixelUV;
+    }
+
+    private void PaintMove(Vector2 pixel)
+    {
+        Record(InputLog.EventType.PointerMove, pixel);
+
+        PaintAt(pixel);
 
         // check distance from previous drawing point and connect them with DrawLine
         if (Vector2.Distance(pixelUV, pixelUVOld) > brushSize)
         {
             switch (drawMode)
             {
-                case DrawMode.Pencil: // drawing
-                    DrawLine(pixelUVOld, pixelUV);
+                case DrawMode.Pencil: // drawing, painted by PaintStamps
+                    using (drawLineMarker.Auto())
+                    {
+                        painter.QueueLine((int)pixelUVOld.x, (int)pixelUVOld.y, (int)pixelUV.x, (int)pixelUV.y);
+                    }
                     break;
 
-                case DrawMode.Marker: // drawing
-                    DrawAdditiveLine(pixelUVOld, pixelUV);
+                case DrawMode.Marker: // drawing, painted by PaintStamps
+                    using (drawAdditiveLineMarker.Auto())
+                    {
+                        painter.QueueLine((int)pixelUVOld.x, (int)pixelUVOld.y, (int)pixelUV.x, (int)pixelUV.y);
+                    }
                     break;
 
                 //case DrawMode.Sticker:
-                //    DrawLineWithSticker(pixelUVOld, pixelUV);
+                //    painter.DrawLineWithSticker((int)pixelUVOld.x, (int)pixelUVOld.y, (int)pixelUV.x, (int)pixelUV.y);
                 //    break;
 
                 default: // other modes
@@ -546,206 +1218,81 @@ public class ColoringBookManager : MonoBehaviour
         }
     }
 
-    private void CreateAreaLockMask(int x, int y)
+    private void PaintUp(Vector2 pixel)
     {
-        if (maskTex)
-        {
-            LockAreaFillWithThresholdMaskOnly(x, y);
-        }
-        else
-        {
-            LockMaskFillWithThreshold(x, y);
-        }
+        Record(InputLog.EventType.PointerUp, pixel);
+
+        // stroke finished, store its tiles as one undo step
+        CommitUndoStep();
     }
 
-    private void LockAreaFillWithThresholdMaskOnly(int x, int y)
+    private void PaintAt(Vector2 pixel)
     {
-        // create locking mask floodfill, using threshold, checking pixels from mask only
-
-        // get canvas color from this point
-        byte hitColorR = maskPixels[((texWidth * (y) + x) * 4) + 0];
-        byte hitColorG = maskPixels[((texWidth * (y) + x) * 4) + 1];
-        byte hitColorB = maskPixels[((texWidth * (y) + x) * 4) + 2];
-        byte hitColorA = maskPixels[((texWidth * (y) + x) * 4) + 3];
-
-        Queue<int> fillPointX = new Queue<int>();
-        Queue<int> fillPointY = new Queue<int>();
-        fillPointX.Enqueue(x);
-        fillPointY.Enqueue(y);
-
-        int ptsx, ptsy;
-        int pixel = 0;
+        pixelUVOld = pixelUV; // take previous value, so can compare them
+        pixelUV = pixel;
 
-        lockMaskPixels = new byte[texWidth * texHeight * 4];
+        if (wentOutside) { pixelUVOld = pixelUV; wentOutside = false; }
 
-        while (fillPointX.Count > 0)
+        // lets paint where we hit
+        switch (drawMode)
         {
+            case DrawMode.Pencil: // drawing, painted by PaintStamps
+            case DrawMode.Marker:
+                painter.QueueCircle((int)pixelUV.x, (int)pixelUV.y);
+                break;
 
-            ptsx = fillPointX.Dequeue();
-            ptsy = fillPointY.Dequeue();
-
-            if (ptsy - 1 > -1)
-            {
-                pixel = (texWidth * (ptsy - 1) + ptsx) * 4; // down
-
-                if (lockMaskPixels[pixel] == 0 // this pixel is not used yet
-                    && (CompareThreshold(maskPixels[pixel + 0], hitColorR)) // if pixel is same as hit color OR same as paint color
-                    && (CompareThreshold(maskPixels[pixel + 1], hitColorG))
-                    && (CompareThreshold(maskPixels[pixel + 2], hitColorB))
-                    && (CompareThreshold(maskPixels[pixel + 3], hitColorA)))
-                {
-                    fillPointX.Enqueue(ptsx);
-                    fillPointY.Enqueue(ptsy - 1);
-                    lockMaskPixels[pixel] = 1;
-                }
-            }
-
-            if (ptsx + 1 < texWidth)
-            {
-                pixel = (texWidth * ptsy + ptsx + 1) * 4; // right
-                if (lockMaskPixels[pixel] == 0
-                    && (CompareThreshold(maskPixels[pixel + 0], hitColorR)) // if pixel is same as hit color OR same as paint color
-                    && (CompareThreshold(maskPixels[pixel + 1], hitColorG))
-                    && (CompareThreshold(maskPixels[pixel + 2], hitColorB))
-                    && (CompareThreshold(maskPixels[pixel + 3], hitColorA)))
-                {
-                    fillPointX.Enqueue(ptsx + 1);
-                    fillPointY.Enqueue(ptsy);
-                    lockMaskPixels[pixel] = 1;
-                }
-            }
+            //case DrawMode.Sticker: // Sticker
+            //    painter.DrawSticker((int)pixelUV.x, (int)pixelUV.y);
+            //    break;
 
-            if (ptsx - 1 > -1)
-            {
-                pixel = (texWidth * ptsy + ptsx - 1) * 4; // left
-                if (lockMaskPixels[pixel] == 0
-                    && (CompareThreshold(maskPixels[pixel + 0], hitColorR)) // if pixel is same as hit color OR same as paint color
-                    && (CompareThreshold(maskPixels[pixel + 1], hitColorG))
-                    && (CompareThreshold(maskPixels[pixel + 2], hitColorB))
-                    && (CompareThreshold(maskPixels[pixel + 3], hitColorA)))
+            case DrawMode.PaintBucket: // floodfill
+                using (floodFillMarker.Auto())
                 {
-                    fillPointX.Enqueue(ptsx - 1);
-                    fillPointY.Enqueue(ptsy);
-                    lockMaskPixels[pixel] = 1;
+                    painter.FloodFill((int)pixelUV.x, (int)pixelUV.y);
                 }
-            }
+                break;
 
-            if (ptsy + 1 < texHeight)
-            {
-                pixel = (texWidth * (ptsy + 1) + ptsx) * 4; // up
-                if (lockMaskPixels[pixel] == 0
-                    && (CompareThreshold(maskPixels[pixel + 0], hitColorR)) // if pixel is same as hit color OR same as paint color
-                    && (CompareThreshold(maskPixels[pixel + 1], hitColorG))
-                    && (CompareThreshold(maskPixels[pixel + 2], hitColorB))
-                    && (CompareThreshold(maskPixels[pixel + 3], hitColorA)))
-                {
-                    fillPointX.Enqueue(ptsx);
-                    fillPointY.Enqueue(ptsy + 1);
-                    lockMaskPixels[pixel] = 1;
-                }
-            }
+            default: // unknown mode
+                break;
         }
+
+        textureNeedsUpdate = true;
     }
 
-    private void LockMaskFillWithThreshold(int x, int y)
+    private void UpdateTexture()
     {
-        // create locking mask floodfill, using threshold
-
-        // get canvas color from this point
-        byte hitColorR = pixels[((texWidth * (y) + x) * 4) + 0];
-        byte hitColorG = pixels[((texWidth * (y) + x) * 4) + 1];
-        byte hitColorB = pixels[((texWidth * (y) + x) * 4) + 2];
-        byte hitColorA = pixels[((texWidth * (y) + x) * 4) + 3];
-
-        Queue<int> fillPointX = new Queue<int>();
-        Queue<int> fillPointY = new Queue<int>();
-        fillPointX.Enqueue(x);
-        fillPointY.Enqueue(y);
-
-        int ptsx, ptsy;
-        int pixel = 0;
-
-        lockMaskPixels = new byte[texWidth * texHeight * 4];
-
-        while (fillPointX.Count > 0)
+        if (textureNeedsUpdate)
         {
+            textureNeedsUpdate = false;
 
-            ptsx = fillPointX.Dequeue();
-            ptsy = fillPointY.Dequeue();
-
-            if (ptsy - 1 > -1)
-            {
-                pixel = (texWidth * (ptsy - 1) + ptsx) * 4; // down
-
-                if (lockMaskPixels[pixel] == 0 // this pixel is not used yet
-                    && (CompareThreshold(pixels[pixel + 0], hitColorR) || CompareThreshold(pixels[pixel + 0], paintColor.r)) // if pixel is same as hit color OR same as paint color
-                    && (CompareThreshold(pixels[pixel + 1], hitColorG) || CompareThreshold(pixels[pixel + 1], paintColor.g))
-                    && (CompareThreshold(pixels[pixel + 2], hitColorB) || CompareThreshold(pixels[pixel + 2], paintColor.b))
-                    && (CompareThreshold(pixels[pixel + 3], hitColorA) || CompareThreshold(pixels[pixel + 3], paintColor.a)))
-                {
-                    fillPointX.Enqueue(ptsx);
-                    fillPointY.Enqueue(ptsy - 1);
-                    lockMaskPixels[pixel] = 1;
-                }
-            }
-
-            if (ptsx + 1 < texWidth)
-            {
-                pixel = (texWidth * ptsy + ptsx + 1) * 4; // right
-                if (lockMaskPixels[pixel] == 0
-                    && (CompareThreshold(pixels[pixel + 0], hitColorR) || CompareThreshold(pixels[pixel + 0], paintColor.r)) // if pixel is same as hit color OR same as paint color
-                    && (CompareThreshold(pixels[pixel + 1], hitColorG) || CompareThreshold(pixels[pixel + 1], paintColor.g))
-                    && (CompareThreshold(pixels[pixel + 2], hitColorB) || CompareThreshold(pixels[pixel + 2], paintColor.b))
-                    && (CompareThreshold(pixels[pixel + 3], hitColorA) || CompareThreshold(pixels[pixel + 3], paintColor.a)))
-                {
-                    fillPointX.Enqueue(ptsx + 1);
-                    fillPointY.Enqueue(ptsy);
-                    lockMaskPixels[pixel] = 1;
-                }
-            }
-
-            if (ptsx - 1 > -1)
-            {
-                pixel = (texWidth * ptsy + ptsx - 1) * 4; // left
-                if (lockMaskPixels[pixel] == 0
-                    && (CompareThreshold(pixels[pixel + 0], hitColorR) || CompareThreshold(pixels[pixel + 0], paintColor.r)) // if pixel is same as hit color OR same as paint color
-                    && (CompareThreshold(pixels[pixel + 1], hitColorG) || CompareThreshold(pixels[pixel + 1], paintColor.g))
-                    && (CompareThreshold(pixels[pixel + 2], hitColorB) || CompareThreshold(pixels[pixel + 2], paintColor.b))
-                    && (CompareThreshold(pixels[pixel + 3], hitColorA) || CompareThreshold(pixels[pixel + 3], paintColor.a)))
-                {
-                    fillPointX.Enqueue(ptsx - 1);
-                    fillPointY.Enqueue(ptsy);
-                    lockMaskPixels[pixel] = 1;
-                }
-            }
+            // only what is on screen, tiles out of view stay dirty until they scroll in
+            int tx0, ty0, tx1, ty1;
+            viewport.GetVisibleTiles(canvas, out tx0, out ty0, out tx1, out ty1);
+            // tiles past what the staging textures take this frame go up with the next one
+            if (!canvasTexture.Upload(canvas, tx0, ty0, tx1, ty1)) textureNeedsUpdate = true;
 
-            if (ptsy + 1 < texHeight)
-            {
-                pixel = (texWidth * (ptsy + 1) + ptsx) * 4; // up
-                if (lockMaskPixels[pixel] == 0
-                    && (CompareThreshold(pixels[pixel + 0], hitColorR) || CompareThreshold(pixels[pixel + 0], paintColor.r)) // if pixel is same as hit color OR same as paint color
-                    && (CompareThreshold(pixels[pixel + 1], hitColorG) || CompareThreshold(pixels[pixel + 1], paintColor.g))
-                    && (CompareThreshold(pixels[pixel + 2], hitColorB) || CompareThreshold(pixels[pixel + 2], paintColor.b))
-                    && (CompareThreshold(pixels[pixel + 3], hitColorA) || CompareThreshold(pixels[pixel + 3], paintColor.a)))
-                {
-                    fillPointX.Enqueue(ptsx);
-                    fillPointY.Enqueue(ptsy + 1);
-                    lockMaskPixels[pixel] = 1;
-                }
-            }
+            // the upload is done by the time the busy check runs again, keep rendering for it
+            IdleRendering.Wake();
         }
     }
 
-    private void UpdateTexture()
+    private void CommitUndoStep()
     {
-        if (textureNeedsUpdate)
+        if (undoHistory.Commit(canvas))
         {
-            textureNeedsUpdate = false;
-            tex.LoadRawTextureData(pixels);
-            tex.Apply(false);
+            UpdateUndoRedoButtons();
         }
     }
 
+    private void UpdateUndoRedoButtons()
+    {
+        UndoRedoButtons[0].image.sprite = UndoRedoButtons[0].sprites[undoHistory.CanUndo ? 0 : 1];
+        UndoRedoButtons[0].image.raycastTarget = undoHistory.CanUndo;
+
+        UndoRedoButtons[1].image.sprite = UndoRedoButtons[1].sprites[undoHistory.CanRedo ? 0 : 1];
+        UndoRedoButtons[1].image.raycastTarget = undoHistory.CanRedo;
+    }
+
     #endregion
 
 
@@ -760,6 +1307,8 @@ public class ColoringBookManager : MonoBehaviour
 
         drawModeButton[drawModeIndex].image.sprite = drawModeButton[drawModeIndex].sprites[0];
 
+        Record(InputLog.EventType.DrawMode, drawModeIndex);
+
         int currentDrawMode = (int)drawMode;
 
         if (currentDrawMode == drawModeIndex)
@@ -776,7 +1325,10 @@ public class ColoringBookManager : MonoBehaviour
 
     public void OnBrushButtonClicked(ButtonScript sender)
     {
+        Record(InputLog.EventType.Color, sender.transform.GetSiblingIndex());
+
         paintColor = sender.GetComponent<Image>().color;
+        painter.SetColor(paintColor.r, paintColor.g, paintColor.b, paintColor.a);
         brushSizeButton.image.color = paintColor; // set current color image
 
         switch (drawMode)
@@ -839,6 +1391,7 @@ public class ColoringBookManager : MonoBehaviour
     public void OnStickerButtonClicked(ButtonScript sender)
     {
         selectedSticker = sender.transform.GetSiblingIndex();
+        Record(InputLog.EventType.Sticker, selectedSticker);
 
         for (int i = 0; i < PanelColors[(int)DrawMode.Sticker].childCount; i++)
         {
@@ -848,9 +1401,9 @@ public class ColoringBookManager : MonoBehaviour
         PanelColors[(int)DrawMode.Sticker].GetChild(selectedSticker).GetChild(0).gameObject.SetActive(true);
 
         // tell mobile paint to read sticker pixel data
-        stickerWidth = stickers[selectedSticker].width;
-        stickerHeight = stickers[selectedSticker].height;
-        stickerBytes = new byte[stickerWidth * stickerHeight * 4];
+        int stickerWidth = stickers[selectedSticker].width;
+        int stickerHeight = stickers[selectedSticker].height;
+        byte[] stickerBytes = new byte[stickerWidth * stickerHeight * 4];
 
         int pixel = 0;
         for (int y = 0; y < stickerHeight; y++)
@@ -867,10 +1420,7 @@ public class ColoringBookManager : MonoBehaviour
             }
         }
 
-        // precalculate values
-        stickerWidthHalf = (int)(stickerWidth * 0.5f);
-        texWidthMinusStickerWidth = texWidth - stickerWidth;
-        texHeightMinusStickerHeight = texHeight - stickerHeight;
+        painter.SetSticker(stickerBytes, stickerWidth, stickerHeight);
     }
 
     public void OnChangeBrushSizeButtonClicked()
@@ -882,61 +1432,53 @@ public class ColoringBookManager : MonoBehaviour
             brushSize = 8;
         }
 
+        painter.brushSize = brushSize;
+        Record(InputLog.EventType.BrushSize, brushSize);
+
         brushSizeButton.image.sprite = brushSizeButton.sprites[(brushSize - 8) / 8];
     }
 
     public void OnUndoButtonClicked()
     {
-        if (undoPixels.Count - RedoIndex - 1 > 0)
-        {
-            System.Array.Copy(undoPixels[undoPixels.Count - RedoIndex - 2], pixels, undoPixels[undoPixels.Count - RedoIndex - 2].Length);
-            tex.LoadRawTextureData(undoPixels[undoPixels.Count - RedoIndex - 2]);
-            tex.Apply(false);
+        Record(InputLog.EventType.Undo, 0);
 
-            RedoIndex++;
+        using (undoMarker.Auto())
+        {
+            if (undoHistory.Undo(canvas))
+            {
+                textureNeedsUpdate = true;
+            }
         }
+
+        UpdateUndoRedoButtons();
     }
 
     public void OnRedoButtonClicked()
     {
-        if (undoPixels.Count > 0 && RedoIndex > 0)
+        Record(InputLog.EventType.Redo, 0);
+
+        using (redoMarker.Auto())
         {
-            System.Array.Copy(undoPixels[undoPixels.Count - RedoIndex], pixels, undoPixels[undoPixels.Count - RedoIndex].Length);
-            tex.LoadRawTextureData(undoPixels[undoPixels.Count - RedoIndex]);
-            tex.Apply(false);
+            if (undoHistory.Redo(canvas))
+            {
+                textureNeedsUpdate = true;
 
-            RedoIndex--;
+                UpdateUndoRedoButtons();
+            }
         }
     }
 
     public void OnClearButtonClicked()
     {
-        int pixel = 0;
-        for (int y = 0; y < texHeight; y++)
-        {
-            for (int x = 0; x < texWidth; x++)
-            {
-                pixels[pixel] = 255;
-                pixels[pixel + 1] = 255;
-                pixels[pixel + 2] = 255;
-                pixels[pixel + 3] = 255;
-                pixel += 4;
-            }
-        }
-        tex.LoadRawTextureData(pixels);
-        tex.Apply(false);
+        Record(InputLog.EventType.Clear, 0);
 
-        if (undoPixels != null)
+        using (clearMarker.Auto())
         {
-            if (RedoIndex > 0)
-            {
-                undoPixels.RemoveRange(undoPixels.Count - RedoIndex, RedoIndex);
-                RedoIndex = 0;
-            }
-
-            undoPixels.Add(new byte[texWidth * texHeight * 4]);
-            System.Array.Copy(pixels, undoPixels[undoPixels.Count - 1], pixels.Length);
+            canvas.Clear();
         }
+        textureNeedsUpdate = true;
+
+        CommitUndoStep();
     }
 
     public void OnScreenshotButtonClicked()
@@ -946,16 +1488,21 @@ public class ColoringBookManager : MonoBehaviour
 
     private IEnumerator OnSavePictureClickListener()
     {
+        if (!pageReady) yield break;
+
 #if UNITY_ANDROID
         if (JavadRastadAndroidRuntimePermissions.RequestStoragePermissions())
         {
 #endif
         MusicController.USE.PlaySound(MusicController.USE.cameraSound);
 
-        waterMark.SetActive(true);
-        StartCoroutine(ScreenshotManager.SaveForPaint("MyPicture", "ColoringBook"));
-        yield return new WaitForSeconds(1f);
-        waterMark.SetActive(false);
+        if (exportWatermark == null)
+        {
+            exportWatermark = CreateWatermark();
+        }
+
+        // Home hides this scene, the export still gets to the gallery or share sheet
+        yield return Services.Run(PageExport.Export(canvas, maskPixels, exportWatermark, "MyPicture", "ColoringBook", exportFormat, exportScale));
 #if UNITY_ANDROID
         }
         else
@@ -982,443 +1529,280 @@ public class ColoringBookManager : MonoBehaviour
 
     public void OnHomeButtonClicked()
     {
+        TraceLog.Instant("Home");
+
         SaveImage(ID);
 
-        SceneManager.LoadScene("MainScene");
+        // the scene stays loaded behind the menu, a recording ends with the page
+        SaveInputLog();
+        recording = null;
+        if (LatencyTracer.USE != null) LatencyTracer.USE.Save();
+        StopPageRoutines();
+        StashPage();
+
+        using (TraceLog.Auto("Show MainScene"))
+        {
+            ResidentScenes.Show("MainScene");
+        }
     }
 
     #endregion
 
 
-    #region Painting Functions
+    #region Scripted Input
 
-    private void DrawCircle(int x, int y)
+    public TiledCanvas Canvas
     {
-        int pixel = 0;
+        get { return canvas; }
+    }
 
-        // draw fast circle: 
-        int r2 = brushSize * brushSize;
-        int area = r2 << 2;
-        int rr = brushSize << 1;
-        for (int i = 0; i < area; i++)
-        {
-            int tx = (i % rr) - brushSize;
-            int ty = (i / rr) - brushSize;
-            if (tx * tx + ty * ty < r2)
-            {
-                if (x + tx < 0 || y + ty < 0 || x + tx >= texWidth || y + ty >= texHeight) continue;
+    public bool Ready
+    {
+        get { return pageReady; }
+    }
 
-                pixel = (texWidth * (y + ty) + x + tx) * 4;
+    public void SelectDrawMode(int drawModeIndex)
+    {
+        OnDrawModeButtonClicked(drawModeIndex);
+    }
 
-                if (!useLockArea || (useLockArea && lockMaskPixels[pixel] == 1))
-                {
-                    pixels[pixel] = paintColor.r;
-                    pixels[pixel + 1] = paintColor.g;
-                    pixels[pixel + 2] = paintColor.b;
-                    pixels[pixel + 3] = paintColor.a;
-                }
+    public void SelectColor(int index)
+    {
+        // the sticker panel has no colors, pick from the pencil one
+        int panel = drawMode == DrawMode.Sticker ? (int)DrawMode.Pencil : (int)drawMode;
+        OnBrushButtonClicked(PanelColors[panel].GetChild(index).GetComponent<ButtonScript>());
+    }
 
-            }
+    public void SelectSticker(int index)
+    {
+        OnStickerButtonClicked(PanelColors[(int)DrawMode.Sticker].GetChild(index).GetComponent<ButtonScript>());
+    }
+
+    public void SelectBrushSize(int size)
+    {
+        for (int i = 0; i < 3 && brushSize != size; i++)
+        {
+            OnChangeBrushSizeButtonClicked();
         }
     }
 
-    private void DrawAdditiveCircle(int x, int y)
+    public void PointerDown(float x, float y)
     {
-        int pixel = 0;
+        PaintDown(new Vector2(x, y));
+    }
 
-        // draw fast circle: 
-        int r2 = brushSize * brushSize;
-        int area = r2 << 2;
-        int rr = brushSize << 1;
-        for (int i = 0; i < area; i++)
-        {
-            int tx = (i % rr) - brushSize;
-            int ty = (i / rr) - brushSize;
-            if (tx * tx + ty * ty < r2)
-            {
-                if (x + tx < 0 || y + ty < 0 || x + tx >= texWidth || y + ty >= texHeight) continue;
+    public void PointerMove(float x, float y)
+    {
+        StrokeLatency.Input();
+        PaintMove(new Vector2(x, y));
+        PaintStamps();
+    }
 
-                pixel = (texWidth * (y + ty) + x + tx) * 4;
+    public void PointerUp(float x, float y)
+    {
+        PaintUp(new Vector2(x, y));
+    }
 
-                // additive over white also
-                if (!useLockArea || (useLockArea && lockMaskPixels[pixel] == 1))
-                {
-                    pixels[pixel] = (byte)Mathf.Lerp(pixels[pixel], paintColor.r, paintColor.a / 255f * 0.1f);
-                    pixels[pixel + 1] = (byte)Mathf.Lerp(pixels[pixel + 1], paintColor.g, paintColor.a / 255f * 0.1f);
-                    pixels[pixel + 2] = (byte)Mathf.Lerp(pixels[pixel + 2], paintColor.b, paintColor.a / 255f * 0.1f);
-                    pixels[pixel + 3] = (byte)Mathf.Lerp(pixels[pixel + 3], paintColor.a, paintColor.a / 255 * 0.1f);
-                }
+    public void Undo()
+    {
+        OnUndoButtonClicked();
+    }
 
-            }
-        }
+    public void Redo()
+    {
+        OnRedoButtonClicked();
     }
 
-    private void DrawSticker(int px, int py)
+    public void Clear()
     {
-        // get position where we paint
-        int startX = (int)(px - stickerWidthHalf);
-        int startY = (int)(py - stickerWidthHalf);
+        OnClearButtonClicked();
+    }
 
-        if (startX < 0)
-        {
-            startX = 0;
-        }
-        else {
-            if (startX + stickerWidth >= texWidth) startX = texWidthMinusStickerWidth;
-        }
+    public void Save()
+    {
+        SaveImage(ID);
+    }
 
-        if (startY < 1)
-        {
-            startY = 1;
-        }
-        else {
-            if (startY + stickerHeight >= texHeight) startY = texHeightMinusStickerHeight;
-        }
+    public void Reload()
+    {
+        ShowPage(DecodeSavedPage(PageStore.Read(ID), texWidth, texHeight));
+    }
 
+    public void Open(byte[] page)
+    {
+        LoadPage(page);
+    }
 
-        int pixel = (texWidth * startY + startX) * 4;
-        int brushPixel = 0;
+    // tile memory held by the undo steps of the page
+    public long UndoBytes
+    {
+        get { return undoHistory != null ? undoHistory.Bytes : 0; }
+    }
 
-        for (int y = 0; y < stickerHeight; y++)
+    public InputLog Recording
+    {
+        get { return recording; }
+
+        set
         {
-            for (int x = 0; x < stickerWidth; x++)
-            {
-                brushPixel = (stickerWidth * (y) + x) * 4;
+            recording = value;
+            recordingStart = Time.realtimeSinceStartup;
+        }
+    }
 
-                // brush alpha is over 0 in this pixel
-                if (stickerBytes[brushPixel + 3] > 0)
-                {
-                    pixels[pixel] = stickerBytes[brushPixel];
-                    pixels[pixel + 1] = stickerBytes[brushPixel + 1];
-                    pixels[pixel + 2] = stickerBytes[brushPixel + 2];
-                    pixels[pixel + 3] = stickerBytes[brushPixel + 3];
-                }
+    #endregion
 
-                pixel += 4;
 
-            } // for x
+    #region Input Recording
+
+    private int RecordingTime()
+    {
+        return (int)((Time.realtimeSinceStartup - recordingStart) * 1000);
+    }
+
+    private void Record(InputLog.EventType type, Vector2 pixel)
+    {
+        if (recording != null) recording.AddPointer(RecordingTime(), type, pixel.x, pixel.y);
+    }
 
-            pixel = (texWidth * (startY == 0 ? 1 : startY + y) + startX + 1) * 4;
-        } // for y
+    private void Record(InputLog.EventType type, int value)
+    {
+        if (recording != null) recording.Add(RecordingTime(), type, value);
     }
 
-    private void FloodFillMaskOnlyWithThreshold(int x, int y)
+    private void SaveInputLog()
     {
-        // get canvas hit color
-        byte hitColorR = maskPixels[((texWidth * (y) + x) * 4) + 0];
-        byte hitColorG = maskPixels[((texWidth * (y) + x) * 4) + 1];
-        byte hitColorB = maskPixels[((texWidth * (y) + x) * 4) + 2];
-        byte hitColorA = maskPixels[((texWidth * (y) + x) * 4) + 3];
+        if (recording == null || recording.events.Count == 0) return;
 
-        if (paintColor.r == hitColorR && paintColor.g == hitColorG && paintColor.b == hitColorB && paintColor.a == hitColorA) return;
+        recording.Finish(canvas);
 
-        Queue<int> fillPointX = new Queue<int>();
-        Queue<int> fillPointY = new Queue<int>();
-        fillPointX.Enqueue(x);
-        fillPointY.Enqueue(y);
+        // one file per session, saving again (pause, then leaving the page) overwrites it
+        string folder = Application.persistentDataPath + "/InputLogs";
+        Directory.CreateDirectory(folder);
+        string file = folder + "/Page" + ID + "_" + System.DateTime.Now.AddSeconds(-RecordingTime() / 1000).ToString("yyyyMMdd_HHmmss") + ".bytes";
+        File.WriteAllBytes(file, recording.Encode());
 
-        int ptsx, ptsy;
-        int pixel = 0;
+        Debug.Log("Input log: " + file + ", " + recording.events.Count + " events");
+    }
 
-        lockMaskPixels = new byte[texWidth * texHeight * 4];
+    // plays a log back through the same paint path as the mouse, at the recorded speed or all at once
+    public IEnumerator ReplayInput(InputLog log, bool recordedSpeed)
+    {
+        if (log == null)
+        {
+            Debug.LogWarning("Not an input log");
+            yield break;
+        }
 
-        while (fillPointX.Count > 0)
+        if (log.maskIndex != maskTexIndex || log.width != texWidth || log.height != texHeight)
         {
-            ptsx = fillPointX.Dequeue();
-            ptsy = fillPointY.Dequeue();
+            Debug.LogWarning("Input log was recorded on page " + log.maskIndex + " (" + log.width + "x" + log.height + "), this is page " + maskTexIndex);
+            yield break;
+        }
 
-            if (ptsy - 1 > -1)
-            {
-                pixel = (texWidth * (ptsy - 1) + ptsx) * 4; // down
-                if (lockMaskPixels[pixel] == 0
-                    && CompareThreshold(maskPixels[pixel + 0], hitColorR)
-                    && CompareThreshold(maskPixels[pixel + 1], hitColorG)
-                    && CompareThreshold(maskPixels[pixel + 2], hitColorB)
-                    && CompareThreshold(maskPixels[pixel + 3], hitColorA))
-                {
-                    fillPointX.Enqueue(ptsx);
-                    fillPointY.Enqueue(ptsy - 1);
-                    DrawPoint(pixel);
-                    lockMaskPixels[pixel] = 1;
-                }
-            }
+        replaying = true;
+        recording = null; // a replay is not a session of its own
+        Open(log.page);
 
-            if (ptsx + 1 < texWidth)
-            {
-                pixel = (texWidth * ptsy + ptsx + 1) * 4; // right
-                if (lockMaskPixels[pixel] == 0
-                    && CompareThreshold(maskPixels[pixel + 0], hitColorR)
-                    && CompareThreshold(maskPixels[pixel + 1], hitColorG)
-                    && CompareThreshold(maskPixels[pixel + 2], hitColorB)
-                    && CompareThreshold(maskPixels[pixel + 3], hitColorA))
-                {
-                    fillPointX.Enqueue(ptsx + 1);
-                    fillPointY.Enqueue(ptsy);
-                    DrawPoint(pixel);
-                    lockMaskPixels[pixel] = 1;
-                }
-            }
+        float start = Time.realtimeSinceStartup;
+        int next = 0;
 
-            if (ptsx - 1 > -1)
+        while (next < log.events.Count)
+        {
+            int time = recordedSpeed ? (int)((Time.realtimeSinceStartup - start) * 1000) : int.MaxValue;
+            next = log.Replay(this, next, time);
+            yield return null;
+        }
+
+        replaying = false;
+
+        if (log.hasChecksum)
+        {
+            uint checksum = canvas.Checksum();
+            if (checksum == log.checksum)
             {
-                pixel = (texWidth * ptsy + ptsx - 1) * 4; // left
-                if (lockMaskPixels[pixel] == 0
-                    && CompareThreshold(maskPixels[pixel + 0], hitColorR)
-                    && CompareThreshold(maskPixels[pixel + 1], hitColorG)
-                    && CompareThreshold(maskPixels[pixel + 2], hitColorB)
-                    && CompareThreshold(maskPixels[pixel + 3], hitColorA))
-                {
-                    fillPointX.Enqueue(ptsx - 1);
-                    fillPointY.Enqueue(ptsy);
-                    DrawPoint(pixel);
-                    lockMaskPixels[pixel] = 1;
-                }
+                Debug.Log("Input replay painted the recorded page (" + log.events.Count + " events)");
             }
-
-            if (ptsy + 1 < texHeight)
+            else
             {
-                pixel = (texWidth * (ptsy + 1) + ptsx) * 4; // up
-                if (lockMaskPixels[pixel] == 0
-                    && CompareThreshold(maskPixels[pixel + 0], hitColorR)
-                    && CompareThreshold(maskPixels[pixel + 1], hitColorG)
-                    && CompareThreshold(maskPixels[pixel + 2], hitColorB)
-                    && CompareThreshold(maskPixels[pixel + 3], hitColorA))
-                {
-                    fillPointX.Enqueue(ptsx);
-                    fillPointY.Enqueue(ptsy + 1);
-                    DrawPoint(pixel);
-                    lockMaskPixels[pixel] = 1;
-                }
+                Debug.LogError("Input replay painted a different page: " + checksum.ToString("X8") + ", recorded " + log.checksum.ToString("X8"));
             }
         }
     }
 
-    private void FloodFillWithTreshold(int x, int y)
-    {
-        // get canvas hit color
-        byte hitColorR = pixels[((texWidth * (y) + x) * 4) + 0];
-        byte hitColorG = pixels[((texWidth * (y) + x) * 4) + 1];
-        byte hitColorB = pixels[((texWidth * (y) + x) * 4) + 2];
-        byte hitColorA = pixels[((texWidth * (y) + x) * 4) + 3];
-
-        if (paintColor.r == hitColorR && paintColor.g == hitColorG && paintColor.b == hitColorB && paintColor.a == hitColorA) return;
-
-        Queue<int> fillPointX = new Queue<int>();
-        Queue<int> fillPointY = new Queue<int>();
-        fillPointX.Enqueue(x);
-        fillPointY.Enqueue(y);
+    #endregion
 
-        int ptsx, ptsy;
-        int pixel = 0;
 
-        lockMaskPixels = new byte[texWidth * texHeight * 4];
+    #region Prefetch
 
-        while (fillPointX.Count > 0)
-        {
+    // Loads a page into the page cache while the menu is shown, so tapping it opens it like a cached page.
+    // The paint scene is hidden then, the menu runs this on its own coroutine. The saved page is decoded on a
+    // worker and the mask is read in a frame of its own; wanted is asked after each step, a page that is not
+    // wanted anymore is dropped.
+    public IEnumerator PrefetchPage(string id, int maskIndex, System.Func<bool> wanted)
+    {
+        if (pageCache.Contains(id)) yield break;
 
-            ptsx = fillPointX.Dequeue();
-            ptsy = fillPointY.Dequeue();
+        int width = maskIndex >= 0 ? maskTexList[maskIndex].texture.width : freePaintWidth;
+        int height = maskIndex >= 0 ? maskTexList[maskIndex].texture.height : freePaintHeight;
 
-            if (ptsy - 1 > -1)
-            {
-                pixel = (texWidth * (ptsy - 1) + ptsx) * 4; // down
-                if (lockMaskPixels[pixel] == 0
-                    && CompareThreshold(pixels[pixel + 0], hitColorR)
-                    && CompareThreshold(pixels[pixel + 1], hitColorG)
-                    && CompareThreshold(pixels[pixel + 2], hitColorB)
-                    && CompareThreshold(pixels[pixel + 3], hitColorA))
-                {
-                    fillPointX.Enqueue(ptsx);
-                    fillPointY.Enqueue(ptsy - 1);
-                    DrawPoint(pixel);
-                    lockMaskPixels[pixel] = 1;
-                }
-            }
+        TraceLog.Begin("Prefetch: Read");
+        PageStore.Page saved = PageStore.Read(id);
+        TraceLog.End("Prefetch: Read");
 
-            if (ptsx + 1 < texWidth)
-            {
-                pixel = (texWidth * ptsy + ptsx + 1) * 4; // right
-                if (lockMaskPixels[pixel] == 0
-                    && CompareThreshold(pixels[pixel + 0], hitColorR)
-                    && CompareThreshold(pixels[pixel + 1], hitColorG)
-                    && CompareThreshold(pixels[pixel + 2], hitColorB)
-                    && CompareThreshold(pixels[pixel + 3], hitColorA))
-                {
-                    fillPointX.Enqueue(ptsx + 1);
-                    fillPointY.Enqueue(ptsy);
-                    DrawPoint(pixel);
-                    lockMaskPixels[pixel] = 1;
-                }
-            }
+        TiledCanvas loadCanvas = null;
+        if (saved != null)
+        {
+#if UNITY_WEBGL
+            // no threads, decode in this frame
+            loadCanvas = saved.Decode(width, height);
+#else
+            System.Threading.Tasks.Task decode = System.Threading.Tasks.Task.Run(() => { loadCanvas = saved.Decode(width, height); });
 
-            if (ptsx - 1 > -1)
+            while (!decode.IsCompleted)
             {
-                pixel = (texWidth * ptsy + ptsx - 1) * 4; // left
-                if (lockMaskPixels[pixel] == 0
-                    && CompareThreshold(pixels[pixel + 0], hitColorR)
-                    && CompareThreshold(pixels[pixel + 1], hitColorG)
-                    && CompareThreshold(pixels[pixel + 2], hitColorB)
-                    && CompareThreshold(pixels[pixel + 3], hitColorA))
-                {
-                    fillPointX.Enqueue(ptsx - 1);
-                    fillPointY.Enqueue(ptsy);
-                    DrawPoint(pixel);
-                    lockMaskPixels[pixel] = 1;
-                }
+                yield return null;
             }
 
-            if (ptsy + 1 < texHeight)
+            if (decode.IsFaulted)
             {
-                pixel = (texWidth * (ptsy + 1) + ptsx) * 4; // up
-                if (lockMaskPixels[pixel] == 0
-                    && CompareThreshold(pixels[pixel + 0], hitColorR)
-                    && CompareThreshold(pixels[pixel + 1], hitColorG)
-                    && CompareThreshold(pixels[pixel + 2], hitColorB)
-                    && CompareThreshold(pixels[pixel + 3], hitColorA))
-                {
-                    fillPointX.Enqueue(ptsx);
-                    fillPointY.Enqueue(ptsy + 1);
-                    DrawPoint(pixel);
-                    lockMaskPixels[pixel] = 1;
-                }
+                Debug.LogException(decode.Exception);
+                yield break;
             }
+#endif
         }
-    }
 
-    private bool CompareThreshold(byte a, byte b)
-    {
-        if (a < b)
+        if (loadCanvas == null)
         {
-            a ^= b; b ^= a; a ^= b;
+            loadCanvas = new TiledCanvas(width, height);
         }
 
-        return (a - b) <= 128;
-    }
-
-    private void DrawPoint(int pixel)
-    {
-        pixels[pixel] = paintColor.r;
-        pixels[pixel + 1] = paintColor.g;
-        pixels[pixel + 2] = paintColor.b;
-        pixels[pixel + 3] = paintColor.a;
-    }
-
-    private void DrawLine(Vector2 start, Vector2 end)
-    {
-        int x0 = (int)start.x;
-        int y0 = (int)start.y;
-        int x1 = (int)end.x;
-        int y1 = (int)end.y;
-        int dx = Mathf.Abs(x1 - x0);
-        int dy = Mathf.Abs(y1 - y0);
-        int sx, sy;
-        if (x0 < x1) { sx = 1; } else { sx = -1; }
-        if (y0 < y1) { sy = 1; } else { sy = -1; }
-        int err = dx - dy;
-        bool loop = true;
-        int minDistance = (int)(brushSize >> 1);
-        int pixelCount = 0;
-        int e2;
-        while (loop)
+        byte[] pixels = null;
+        if (maskIndex >= 0)
         {
-            pixelCount++;
-            if (pixelCount > minDistance)
-            {
-                pixelCount = 0;
-                DrawCircle(x0, y0);
-            }
-            if ((x0 == x1) && (y0 == y1)) loop = false;
-            e2 = 2 * err;
-            if (e2 > -dy)
-            {
-                err = err - dy;
-                x0 = x0 + sx;
-            }
-            if (e2 < dx)
+            yield return null;
+
+            if (!wanted())
             {
-                err = err + dx;
-                y0 = y0 + sy;
+                loadCanvas.Release();
+                yield break;
             }
+
+            TraceLog.Begin("Prefetch: Mask");
+            Texture2D copy = DuplicateTexture(maskTexList[maskIndex].texture);
+            pixels = copy.GetPixelData<byte>(0).ToArray();
+            Destroy(copy);
+            TraceLog.End("Prefetch: Mask");
         }
-    }
 
-    private void DrawAdditiveLine(Vector2 start, Vector2 end)
-    {
-        int x0 = (int)start.x;
-        int y0 = (int)start.y;
-        int x1 = (int)end.x;
-        int y1 = (int)end.y;
-        int dx = Mathf.Abs(x1 - x0);
-        int dy = Mathf.Abs(y1 - y0);
-        int sx, sy;
-        if (x0 < x1) { sx = 1; } else { sx = -1; }
-        if (y0 < y1) { sy = 1; } else { sy = -1; }
-        int err = dx - dy;
-        bool loop = true;
-        int minDistance = (int)(brushSize >> 1);
-        int pixelCount = 0;
-        int e2;
-        while (loop)
+        if (!wanted())
         {
-            pixelCount++;
-            if (pixelCount > minDistance)
-            {
-                pixelCount = 0;
-                DrawAdditiveCircle(x0, y0);
-            }
-            if ((x0 == x1) && (y0 == y1)) loop = false;
-            e2 = 2 * err;
-            if (e2 > -dy)
-            {
-                err = err - dy;
-                x0 = x0 + sx;
-            }
-            if (e2 < dx)
-            {
-                err = err + dx;
-                y0 = y0 + sy;
-            }
+            loadCanvas.Release();
+            yield break;
         }
-    }
 
-    private void DrawLineWithSticker(Vector2 start, Vector2 end)
-    {
-        int x0 = (int)start.x;
-        int y0 = (int)start.y;
-        int x1 = (int)end.x;
-        int y1 = (int)end.y;
-        int dx = Mathf.Abs(x1 - x0);
-        int dy = Mathf.Abs(y1 - y0);
-        int sx, sy;
-        if (x0 < x1) { sx = 1; } else { sx = -1; }
-        if (y0 < y1) { sy = 1; } else { sy = -1; }
-        int err = dx - dy;
-        bool loop = true;
-        //			int minDistance=brushSize-1;
-        int minDistance = (int)(brushSize >> 1); // divide by 2, you might want to set mindistance to smaller value, to avoid gaps between brushes when moving fast
-        int pixelCount = 0;
-        int e2;
-        while (loop)
-        {
-            pixelCount++;
-            if (pixelCount > minDistance)
-            {
-                pixelCount = 0;
-                DrawSticker(x0, y0);
-            }
-            if ((x0 == x1) && (y0 == y1)) loop = false;
-            e2 = 2 * err;
-            if (e2 > -dy)
-            {
-                err = err - dy;
-                x0 = x0 + sx;
-            }
-            if (e2 < dx)
-            {
-                err = err + dx;
-                y0 = y0 + sy;
-            }
-        }
+        pageCache.Put(id, maskIndex, loadCanvas, pixels);
+        TraceLog.Instant("Prefetch: Cached");
     }
 
     #endregion
@@ -1452,4 +1836,4 @@ public class ColoringBookManager : MonoBehaviour
     }
 
     #endregion
-}
\ No newline at end of file
+}
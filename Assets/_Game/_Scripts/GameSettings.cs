@@ -0,0 +1,188 @@
+﻿using UnityEngine;
+using System.Collections.Generic;
+using System.IO;
+using System.Text;
+using System.Threading.Tasks;
+
+// The small settings (theme, music, menu state, list positions) in memory, kept in their own file apart from the
+// saved pages. A change only marks them dirty: they are written flushDelay seconds after the last change on a
+// worker, and right away when the app is paused or quits, so a tap never writes to disk on the main thread.
+// Settings that are not in the file yet are taken over from PlayerPrefs, where older builds kept them.
+public class GameSettings : MonoBehaviour
+{
+    public static GameSettings USE;
+
+    public const string FileName = "settings.txt";
+
+    public float flushDelay = 2f; // seconds after the last change
+
+    private static Dictionary<string, int> values;
+    private static bool dirty = false;
+    private static float dirtyTime;
+    private static Task writing = Task.CompletedTask;
+
+
+    #region Init
+
+    [RuntimeInitializeOnLoadMethod(RuntimeInitializeLoadType.AfterSceneLoad)]
+    private static void Create()
+    {
+        Services.Add<GameSettings>();
+    }
+
+    private void Awake()
+    {
+        USE = this;
+    }
+
+    private static string FilePath
+    {
+        get { return Application.persistentDataPath + "/" + FileName; }
+    }
+
+    private static void Load()
+    {
+        if (values != null) return;
+
+        values = new Dictionary<string, int>();
+        if (!File.Exists(FilePath)) return;
+
+        using (TraceLog.Auto("GameSettings.Load"))
+        {
+            foreach (string line in File.ReadAllLines(FilePath))
+            {
+                int split = line.LastIndexOf('=');
+                int value;
+                if (split > 0 && int.TryParse(line.Substring(split + 1), out value))
+                {
+                    values[line.Substring(0, split)] = value;
+                }
+            }
+        }
+    }
+
+    #endregion
+
+
+    #region Settings
+
+    public static bool Has(string key)
+    {
+        Load();
+        return values.ContainsKey(key) || PlayerPrefs.HasKey(key);
+    }
+
+    public static int GetInt(string key, int defaultValue = 0)
+    {
+        Load();
+
+        int value;
+        if (values.TryGetValue(key, out value)) return value;
+
+        if (PlayerPrefs.HasKey(key))
+        {
+            value = PlayerPrefs.GetInt(key);
+            SetInt(key, value);
+            return value;
+        }
+
+        return defaultValue;
+    }
+
+    public static void SetInt(string key, int value)
+    {
+        Load();
+
+        int old;
+        if (values.TryGetValue(key, out old) && old == value) return;
+
+        values[key] = value;
+        dirty = true;
+        dirtyTime = Time.unscaledTime;
+    }
+
+    #endregion
+
+
+    #region Flush
+
+    private void Update()
+    {
+        if (dirty && writing.IsCompleted && Time.unscaledTime - dirtyTime >= flushDelay)
+        {
+            Flush(false);
+        }
+    }
+
+    private void OnApplicationPause(bool pause)
+    {
+        // the app may not come back
+        if (pause) Flush(true);
+    }
+
+    private void OnApplicationQuit()
+    {
+        Flush(true);
+    }
+
+    // writes the settings if they changed, on a worker unless wait
+    public static void Flush(bool wait)
+    {
+        if (!dirty) return;
+        dirty = false;
+
+        // a copy, the settings may change while it is written
+        StringBuilder text = new StringBuilder();
+        foreach (KeyValuePair<string, int> setting in values)
+        {
+            text.Append(setting.Key).Append('=').Append(setting.Value).Append('\n');
+        }
+        string contents = text.ToString();
+        string path = FilePath;
+
+#if UNITY_WEBGL
+        // no threads
+        Write(path, contents);
+        PageStore.SyncFiles(wait);
+#else
+        Task previous = writing;
+        writing = Task.Run(() =>
+        {
+            previous.Wait();
+            Write(path, contents);
+        });
+
+        if (wait)
+        {
+            writing.Wait();
+        }
+#endif
+    }
+
+    // next to the file and moved over it, a write that is cut off leaves the last settings
+    private static void Write(string path, string contents)
+    {
+        using (TraceLog.Auto("GameSettings.Write"))
+        {
+            try
+            {
+                File.WriteAllText(path + ".tmp", contents);
+
+                if (File.Exists(path))
+                {
+                    File.Replace(path + ".tmp", path, null);
+                }
+                else
+                {
+                    File.Move(path + ".tmp", path);
+                }
+            }
+            catch (System.Exception e)
+            {
+                Debug.LogException(e);
+            }
+        }
+    }
+
+    #endregion
+}
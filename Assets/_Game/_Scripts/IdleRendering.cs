@@ -0,0 +1,103 @@
+﻿using UnityEngine;
+using UnityEngine.Rendering;
+using System.Collections.Generic;
+
+// Renders only every idleFrameInterval-th frame while nothing moves on screen: no touch, key or mouse input,
+// and none of the registered busy checks (page texture upload, menu scroll, ButtonScript tweens) true for
+// idleDelay seconds. Update still runs every frame, so the first touch is read on the frame it comes in and
+// brings rendering back to full rate before anything else runs in that frame.
+[DefaultExecutionOrder(-1000)]
+public class IdleRendering : MonoBehaviour
+{
+    public static IdleRendering USE;
+
+    public int idleFrameInterval = 6; // 10 fps at 60
+    public float idleDelay = 1f; // seconds without activity before rendering slows down
+
+    private static Dictionary<string, System.Func<bool>> busyChecks = new Dictionary<string, System.Func<bool>>();
+    private static float busyTime;
+
+    private Vector3 lastMousePosition;
+
+
+    #region Init
+
+    [RuntimeInitializeOnLoadMethod(RuntimeInitializeLoadType.AfterSceneLoad)]
+    private static void Create()
+    {
+        Services.Add<IdleRendering>();
+    }
+
+    private void Awake()
+    {
+        USE = this;
+
+        Register("button tweens", () => ButtonScript.Moving > 0);
+        Wake();
+    }
+
+    private void OnDestroy()
+    {
+        OnDemandRendering.renderFrameInterval = 1;
+    }
+
+    #endregion
+
+
+    #region Activity
+
+    // name is only a handle for Unregister, registering the same name again replaces it
+    public static void Register(string name, System.Func<bool> busy)
+    {
+        busyChecks[name] = busy;
+    }
+
+    public static void Unregister(string name)
+    {
+        busyChecks.Remove(name);
+    }
+
+    // something changed on screen that no busy check sees, e.g. a page that finished loading
+    public static void Wake()
+    {
+        busyTime = Time.unscaledTime;
+        OnDemandRendering.renderFrameInterval = 1;
+    }
+
+    public static bool Idle
+    {
+        get { return OnDemandRendering.renderFrameInterval > 1; }
+    }
+
+    private void Update()
+    {
+        if (InputActive() || AnyBusy())
+        {
+            Wake();
+        }
+        else if (!Idle && Time.unscaledTime - busyTime >= idleDelay)
+        {
+            OnDemandRendering.renderFrameInterval = Mathf.Max(1, idleFrameInterval);
+        }
+    }
+
+    private bool InputActive()
+    {
+        Vector3 mouse = Input.mousePosition;
+        bool mouseMoved = mouse != lastMousePosition;
+        lastMousePosition = mouse;
+
+        return Input.touchCount > 0 || Input.anyKey || mouseMoved || Input.mouseScrollDelta.y != 0f;
+    }
+
+    private static bool AnyBusy()
+    {
+        foreach (System.Func<bool> busy in busyChecks.Values)
+        {
+            if (busy()) return true;
+        }
+        return false;
+    }
+
+    #endregion
+}
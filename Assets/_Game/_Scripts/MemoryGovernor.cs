@@ -0,0 +1,198 @@
+﻿using UnityEngine;
+using System.Collections.Generic;
+
+// Keeps the memory the game holds on to (undo history, menu thumbnails, cached pages, pooled buffers) under a budget.
+// Holders register what they hold and how to give it back, in tiers: the cheapest loss first.
+// Over budget the tiers are shed in order until it fits, on Application.lowMemory all of them are shed as far
+// as they go, then unused assets are unloaded. Every action is logged with the bytes it reclaimed.
+public class MemoryGovernor : MonoBehaviour
+{
+    public static MemoryGovernor USE;
+
+    public enum Tier
+    {
+        UndoHistory, // oldest undo steps
+        Thumbnails, // menu thumbnails that are not on screen
+        PageCache, // decoded pages kept for reopening
+        Pools // free buffers kept for reuse
+    }
+
+    public int budgetMB = 0; // 0: a sixteenth of the device memory
+    public int undoSteps = 30; // undo steps kept when over budget
+    public int lowMemoryUndoSteps = 5; // undo steps kept on a low memory warning
+    public float checkInterval = 1f; // seconds between budget checks
+
+    private class Holder
+    {
+        public string name;
+        public Tier tier;
+        public System.Func<long> bytes; // memory held now
+        public System.Func<bool, long> shed; // gives memory back (true on a low memory warning), returns the bytes released
+    }
+
+    private static List<Holder> holders = new List<Holder>();
+
+    private float nextCheck = 0f;
+
+
+    #region Init
+
+    [RuntimeInitializeOnLoadMethod(RuntimeInitializeLoadType.AfterSceneLoad)]
+    private static void Create()
+    {
+        Services.Add<MemoryGovernor>();
+    }
+
+    private void Awake()
+    {
+        USE = this;
+
+        if (budgetMB <= 0)
+        {
+            budgetMB = Mathf.Max(64, SystemInfo.systemMemorySize / 16);
+        }
+
+        Application.lowMemory += OnLowMemory;
+
+        Register("buffer pools", Tier.Pools, PooledBytes, TrimPools);
+    }
+
+    private void OnDestroy()
+    {
+        Application.lowMemory -= OnLowMemory;
+    }
+
+    #endregion
+
+
+    #region Holders
+
+    // name is used in the log, registering the same name again replaces it
+    public static void Register(string name, Tier tier, System.Func<long> bytes, System.Func<bool, long> shed)
+    {
+        Unregister(name);
+
+        Holder holder = new Holder();
+        holder.name = name;
+        holder.tier = tier;
+        holder.bytes = bytes;
+        holder.shed = shed;
+        holders.Add(holder);
+    }
+
+    public static void Unregister(string name)
+    {
+        for (int i = holders.Count - 1; i >= 0; i--)
+        {
+            if (holders[i].name == name) holders.RemoveAt(i);
+        }
+    }
+
+    // memory held by every registered holder
+    public static long TrackedBytes
+    {
+        get
+        {
+            long bytes = 0;
+            for (int i = 0; i < holders.Count; i++)
+            {
+                bytes += holders[i].bytes();
+            }
+            return bytes;
+        }
+    }
+
+    // free tiles, undo step arrays and fill scratch waiting in the BufferPools
+    private static long PooledBytes()
+    {
+        return BufferPool<byte>.PooledBytes + BufferPool<int>.PooledBytes + BufferPool<byte[]>.PooledBytes;
+    }
+
+    private static long TrimPools(bool lowMemory)
+    {
+        return BufferPool<byte>.Trim() + BufferPool<int>.Trim() + BufferPool<byte[]>.Trim();
+    }
+
+    public long BudgetBytes
+    {
+        get { return (long)budgetMB * 1024 * 1024; }
+    }
+
+    #endregion
+
+
+    #region Shedding
+
+    private void Update()
+    {
+        if (Time.unscaledTime < nextCheck) return;
+        nextCheck = Time.unscaledTime + checkInterval;
+
+        if (TrackedBytes > BudgetBytes)
+        {
+            ShedToBudget();
+        }
+    }
+
+    // tier by tier until the tracked memory fits the budget
+    public void ShedToBudget()
+    {
+        for (Tier tier = Tier.UndoHistory; tier <= Tier.Pools; tier++)
+        {
+            Shed(tier, false);
+
+            if (TrackedBytes <= BudgetBytes) return;
+        }
+
+        Debug.LogWarning("Memory: still over budget after shedding, " + MB(TrackedBytes) + " of " + budgetMB + " MB");
+    }
+
+    private void OnLowMemory()
+    {
+        Debug.LogWarning("Memory: low memory warning, " + MB(TrackedBytes) + " tracked");
+
+        long released = 0;
+        for (Tier tier = Tier.UndoHistory; tier <= Tier.Pools; tier++)
+        {
+            released += Shed(tier, true);
+        }
+
+        Resources.UnloadUnusedAssets();
+        System.GC.Collect();
+
+        Debug.LogWarning("Memory: " + MB(released) + " released, " + MB(TrackedBytes) + " tracked");
+    }
+
+    private long Shed(Tier tier, bool lowMemory)
+    {
+        long released = 0;
+
+        for (int i = 0; i < holders.Count; i++)
+        {
+            Holder holder = holders[i];
+            if (holder.tier != tier) continue;
+
+            long bytes = holder.shed(lowMemory);
+            released += bytes;
+
+            Log(holder.name, bytes);
+        }
+
+        return released;
+    }
+
+    // one line per action, also for the ones that are not shedding tiers
+    public static void Log(string action, long bytes)
+    {
+        if (bytes <= 0) return;
+
+        Debug.Log("Memory: " + action + ", " + MB(bytes) + " reclaimed");
+    }
+
+    private static string MB(long bytes)
+    {
+        return (bytes / (1024f * 1024f)).ToString("0.0") + " MB";
+    }
+
+    #endregion
+}
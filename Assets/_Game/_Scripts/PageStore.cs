@@ -0,0 +1,155 @@
+﻿using UnityEngine;
+using System.IO;
+
+#if UNITY_WEBGL && !UNITY_EDITOR
+using System.Runtime.InteropServices;
+#endif
+
+// Where the saved pages live. Most platforms keep a page as Base64 text in PlayerPrefs. WebGL keeps each page
+// as a binary file in persistentDataPath, the CanvasPageEncoder data deflated by PagePacker. Read and decode
+// need no string, and the file is far smaller than the text. persistentDataPath only reaches IndexedDB through
+// FS.syncfs, so Save schedules one through WebGLStorage.jslib, debounced so a burst of writes is one sync.
+// Pages saved as Base64 .sav files by older builds are still read, and the next save of the page replaces them.
+public static class PageStore
+{
+    private const int SyncDelay = 1000; // ms after the last Save before WebGL syncs
+
+#if UNITY_WEBGL && !UNITY_EDITOR
+    [DllImport("__Internal")]
+    private static extern void PageStoreSync(int delay, bool log);
+#endif
+
+    // a saved page as it is stored: read and written on the main thread, made and decoded on any
+    public class Page
+    {
+        internal readonly string text; // Base64, PlayerPrefs and old WebGL saves
+        internal readonly byte[] packed; // WebGL file
+
+        internal Page(string text, byte[] packed)
+        {
+            this.text = text;
+            this.packed = packed;
+        }
+
+        // the first length bytes of data, e.g. a pooled buffer
+        public static Page FromBytes(byte[] data, int length)
+        {
+#if UNITY_WEBGL
+            return new Page(null, PagePacker.Pack(data, length));
+#else
+            return new Page(System.Convert.ToBase64String(data, 0, length), null);
+#endif
+        }
+
+        // null if it is no page
+        public TiledCanvas Decode(int legacyWidth, int legacyHeight)
+        {
+            if (text != null) return CanvasPageEncoder.DecodeBase64(text, legacyWidth, legacyHeight);
+
+            int length;
+            byte[] data = PagePacker.Unpack(packed, out length);
+            if (data == null) return null;
+
+            TiledCanvas canvas = CanvasPageEncoder.Decode(data, length, legacyWidth, legacyHeight);
+            BufferPool<byte>.Return(data);
+            return canvas;
+        }
+
+        // the CanvasPageEncoder data in a pooled buffer, null if it is broken
+        public byte[] Rent(out int length)
+        {
+            if (text == null) return PagePacker.Unpack(packed, out length);
+
+            byte[] data = BufferPool<byte>.Rent(text.Length / 4 * 3 + 3);
+            if (System.Convert.TryFromBase64String(text, data, out length)) return data;
+
+            BufferPool<byte>.Return(data);
+            return null;
+        }
+    }
+
+
+    #region Store
+
+    // null if the page was never saved, main thread
+    public static Page Read(string key)
+    {
+        using (TraceLog.Auto("PageStore.Read"))
+        {
+#if UNITY_WEBGL
+            string file = FilePath(key);
+            if (File.Exists(file)) return new Page(null, File.ReadAllBytes(file));
+
+            string legacy = LegacyFilePath(key);
+            return File.Exists(legacy) ? new Page(File.ReadAllText(legacy), null) : null;
+#else
+            return PlayerPrefs.HasKey(key) ? new Page(PlayerPrefs.GetString(key), null) : null;
+#endif
+        }
+    }
+
+    // a page from Page.FromBytes, lasts once Save has run, main thread
+    public static void Write(string key, Page page)
+    {
+        using (TraceLog.Auto("PageStore.Write"))
+        {
+#if UNITY_WEBGL
+            File.WriteAllBytes(FilePath(key), page.packed);
+
+            string legacy = LegacyFilePath(key);
+            if (File.Exists(legacy)) File.Delete(legacy);
+#else
+            PlayerPrefs.SetString(key, page.text);
+#endif
+        }
+    }
+
+    public static void Write(string key, byte[] data, int length)
+    {
+        Write(key, Page.FromBytes(data, length));
+    }
+
+    public static void Delete(string key)
+    {
+#if UNITY_WEBGL
+        if (File.Exists(FilePath(key))) File.Delete(FilePath(key));
+        if (File.Exists(LegacyFilePath(key))) File.Delete(LegacyFilePath(key));
+#else
+        PlayerPrefs.DeleteKey(key);
+#endif
+    }
+
+    // makes the writes so far last, on WebGL SyncDelay later unless more follow; now skips the wait
+    public static void Save(bool now = false)
+    {
+        PlayerPrefs.Save();
+        SyncFiles(now);
+    }
+
+    // WebGL: persistentDataPath reaches IndexedDB, other files there (GameSettings) go with the pages
+    public static void SyncFiles(bool now = false)
+    {
+#if UNITY_WEBGL && !UNITY_EDITOR
+        PageStoreSync(now ? 0 : SyncDelay, Debug.isDebugBuild); // development builds log each sync
+#endif
+    }
+
+    #endregion
+
+
+    #region WebGL Files
+
+#if UNITY_WEBGL
+    private static string FilePath(string key)
+    {
+        return Application.persistentDataPath + "/Portrait" + key + ".page";
+    }
+
+    private static string LegacyFilePath(string key)
+    {
+        return Application.persistentDataPath + "/Portrait" + key + ".sav";
+    }
+#endif
+
+    #endregion
+}
@@ -0,0 +1,48 @@
+﻿using UnityEngine;
+using System.Collections;
+
+// One object for the whole session that neither scene owns, so ResidentScenes never hides it. The app-wide
+// components (settings, memory governor, idle rendering, the debug tools) put themselves on it with Add from
+// their RuntimeInitializeOnLoadMethod, and work that must go on while its scene is hidden (exports, backups)
+// runs here with Run.
+public class Services : MonoBehaviour
+{
+    public static Services USE;
+
+
+    #region Init
+
+    private static Services Host()
+    {
+        if (USE == null)
+        {
+            GameObject go = new GameObject("Services");
+            DontDestroyOnLoad(go);
+            USE = go.AddComponent<Services>();
+        }
+
+        return USE;
+    }
+
+    // the component of type T on the services object, added the first time
+    public static T Add<T>() where T : Component
+    {
+        Services host = Host();
+
+        T component = host.GetComponent<T>();
+        return component != null ? component : host.gameObject.AddComponent<T>();
+    }
+
+    #endregion
+
+
+    #region Coroutines
+
+    // a coroutine that outlives the scene that started it
+    public static Coroutine Run(IEnumerator routine)
+    {
+        return Host().StartCoroutine(routine);
+    }
+
+    #endregion
+}
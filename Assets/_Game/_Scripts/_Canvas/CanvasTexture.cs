@@ -0,0 +1,508 @@
+﻿using UnityEngine;
+using UnityEngine.Rendering;
+using Unity.Collections;
+using Unity.Profiling;
+using System.Collections.Generic;
+
+// GPU side of a TiledCanvas: one page sized texture used as the tile atlas.
+// Dirty tiles are written into a staging atlas and copied into place on the GPU,
+// so an upload costs the painted tiles only, not the whole page.
+// Indexed tiles upload their index bytes and are resolved through the palette texture into the page,
+// everything sampling the page keeps seeing plain RGBA.
+// A staging texture is uploaded once per frame and written again only FramesInFlight frames later, when the GPU
+// is done copying out of it: rewriting a texture that queued copies still read makes tile based mobile drivers
+// wait or copy it. A frame stages at most AtlasesPerStage atlases of tiles, the rest stay dirty for the next
+// frames, so staging memory and the bytes uploaded per frame stay the same on any page size.
+// Without GPU copies the page is written on the CPU into one of two textures, the one not on screen, and swapped in.
+public class CanvasTexture
+{
+    private const int FramesInFlight = 3; // frames before a staging texture is written again
+    private const int StagingColumns = 4; // a staging atlas holds StagingColumns x StagingColumns tiles
+    private const int AtlasesPerStage = 4; // staging atlases uploaded in one frame
+    private const int StageTiles = StagingColumns * StagingColumns * AtlasesPerStage;
+
+    public const string UploadMarkerName = "CanvasTexture.Upload";
+    private static readonly ProfilerMarker uploadMarker = new ProfilerMarker(ProfilerCategory.Render, UploadMarkerName);
+
+    public static long uploadedBytes = 0; // bytes sent to the GPU by all pages, PerfHud reads and resets it every frame
+    public static bool useCopyTexture = true; // false: pages made after take the path of devices without CopyTexture, the performance tests time both
+
+    public Texture texture; // page texture, bind with Bind, it changes on uploads without GPU copies
+
+    private RenderTexture page; // when the GPU can copy between textures
+    private Texture2D[] pageFallback; // otherwise written on the CPU and uploaded whole, front and back
+    private int front = 0;
+    private List<int>[] pendingTiles; // tiles of the other fallback texture this one is missing
+
+    private Material material; // shows the page
+
+    // staging textures written in one frame
+    private class Stage
+    {
+        public Texture2D[] atlases = new Texture2D[AtlasesPerStage]; // made as they are needed
+        public int used = 0; // tiles in the atlases this frame
+        public bool applied = false; // the atlases went up this frame
+    }
+
+    // a tile written into a stage, copied into the page once the stage is uploaded
+    private struct StagedTile
+    {
+        public Texture2D source;
+        public int sx, sy; // in source
+        public int x, y, w, h; // in the page
+    }
+
+    private Stage[] stages; // RGBA tiles, one per frame in flight
+    private Stage[] indexStages; // index tiles
+    private int stageIndex = 0;
+    private int stageFrame = -1;
+    private List<StagedTile> staged = new List<StagedTile>();
+    private List<StagedTile> indexStaged = new List<StagedTile>();
+
+    private Material resolveMaterial; // draws an index staging tile into the page through paletteTexture
+    private Texture2D paletteTexture; // 256x1, one texel per palette entry
+    private byte[] expanded; // indexed tile resolved on the CPU, when there is no resolve pass
+    private List<int> uploadTiles = new List<int>();
+
+    private bool mipmapped = false;
+
+    // resolveShader: palette resolve pass for indexed tiles, can be null
+    public CanvasTexture(int width, int height, Shader resolveShader)
+    {
+        if (useCopyTexture && (SystemInfo.copyTextureSupport & CopyTextureSupport.Basic) != 0)
+        {
+            page = new RenderTexture(width, height, 0, RenderTextureFormat.ARGB32, RenderTextureReadWrite.Linear);
+            page.useMipMap = true;
+            page.autoGenerateMips = false;
+            page.Create();
+            Graphics.Blit(Texture2D.whiteTexture, page);
+
+            stages = CreateStages();
+
+            if (resolveShader != null && resolveShader.isSupported && SystemInfo.SupportsTextureFormat(TextureFormat.R8))
+            {
+                resolveMaterial = new Material(resolveShader);
+                indexStages = CreateStages();
+            }
+
+            texture = page;
+        }
+        else
+        {
+            pageFallback = new Texture2D[2];
+            pendingTiles = new List<int>[2];
+
+            for (int i = 0; i < pageFallback.Length; i++)
+            {
+                pageFallback[i] = new Texture2D(width, height, TextureFormat.RGBA32, true);
+                pageFallback[i].filterMode = FilterMode.Point;
+                pageFallback[i].wrapMode = TextureWrapMode.Clamp;
+                pendingTiles[i] = new List<int>();
+
+                NativeArray<uint> data = pageFallback[i].GetPixelData<uint>(0);
+                for (int j = 0; j < data.Length; j++)
+                {
+                    data[j] = 0xFFFFFFFF;
+                }
+                pageFallback[i].Apply(true);
+            }
+
+            texture = pageFallback[front];
+        }
+
+        texture.filterMode = FilterMode.Point;
+        texture.wrapMode = TextureWrapMode.Clamp;
+    }
+
+    private static Stage[] CreateStages()
+    {
+        Stage[] created = new Stage[FramesInFlight];
+        for (int i = 0; i < created.Length; i++)
+        {
+            created[i] = new Stage();
+        }
+        return created;
+    }
+
+    // shows the page with material (_MainTex), kept up to date when the page texture changes
+    public void Bind(Material material)
+    {
+        this.material = material;
+        material.SetTexture("_MainTex", texture);
+    }
+
+    // mipmaps are only sampled while the page is drawn smaller than its size, keep them updated only then
+    public void SetMipmapped(bool value)
+    {
+        if (mipmapped == value) return;
+
+        mipmapped = value;
+        FilterMode filter = mipmapped ? FilterMode.Trilinear : FilterMode.Point;
+
+        if (page != null)
+        {
+            page.filterMode = filter;
+            if (mipmapped) page.GenerateMips();
+        }
+        else
+        {
+            pageFallback[0].filterMode = filter;
+            pageFallback[1].filterMode = filter;
+
+            // the back texture gets its mipmaps and is swapped in
+            if (mipmapped)
+            {
+                uploadTiles.Clear();
+                PresentFallback(null);
+            }
+        }
+    }
+
+    // palette of an indexed canvas, call it again whenever the canvas palette changes
+    public void SetPalette(TiledCanvas canvas)
+    {
+        if (!canvas.Indexed || resolveMaterial == null) return;
+
+        if (paletteTexture == null)
+        {
+            paletteTexture = new Texture2D(TiledCanvas.MaxPaletteSize, 1, TextureFormat.RGBA32, false, true);
+            paletteTexture.filterMode = FilterMode.Point;
+            paletteTexture.wrapMode = TextureWrapMode.Clamp;
+            resolveMaterial.SetTexture("_PaletteTex", paletteTexture);
+        }
+
+        paletteTexture.LoadRawTextureData(canvas.Palette);
+        paletteTexture.Apply(false);
+        uploadedBytes += canvas.Palette.Length;
+    }
+
+    // uploads all dirty tiles of the canvas, false if some wait for the next frame
+    public bool Upload(TiledCanvas canvas)
+    {
+        return Upload(canvas, 0, 0, canvas.tilesX, canvas.tilesY);
+    }
+
+    // uploads the dirty tiles inside the tile rect [tx0, tx1) x [ty0, ty1), the others stay dirty;
+    // false if some of them stay dirty too, their staging texture was already uploaded this frame
+    public bool Upload(TiledCanvas canvas, int tx0, int ty0, int tx1, int ty1)
+    {
+        using (uploadMarker.Auto())
+        {
+            return UploadTiles(canvas, tx0, ty0, tx1, ty1);
+        }
+    }
+
+    public bool UploadAll(TiledCanvas canvas)
+    {
+        canvas.MarkAllDirty();
+        return Upload(canvas);
+    }
+
+    private bool UploadTiles(TiledCanvas canvas, int tx0, int ty0, int tx1, int ty1)
+    {
+        if (page != null && !page.IsCreated())
+        {
+            // render texture content is lost with the graphics context (e.g. app switch on Android)
+            page.Create();
+            canvas.MarkAllDirty();
+        }
+
+        uploadTiles.Clear();
+        canvas.TakeDirtyTiles(tx0, ty0, tx1, ty1, uploadTiles);
+
+        if (uploadTiles.Count == 0) return true;
+
+        if (page == null)
+        {
+            PresentFallback(canvas);
+            return true;
+        }
+
+        bool done = StageDirty(canvas);
+
+        if (mipmapped) page.GenerateMips();
+
+        return done;
+    }
+
+    // the stages of this frame
+    private void NextFrame()
+    {
+        if (stageFrame == Time.frameCount) return;
+
+        stageFrame = Time.frameCount;
+        stageIndex = (stageIndex + 1) % FramesInFlight;
+
+        ResetStage(stages[stageIndex]);
+        if (indexStages != null) ResetStage(indexStages[stageIndex]);
+    }
+
+    private static void ResetStage(Stage stage)
+    {
+        stage.used = 0;
+        stage.applied = false;
+    }
+
+    // the stage takes tiles until its atlases are full or went up this frame
+    private static bool IsFull(Stage stage)
+    {
+        return stage.applied || stage.used == StageTiles;
+    }
+
+    // writes the tiles into this frame's stages, uploads them and copies them into the page;
+    // tiles past what the stages take stay dirty
+    private bool StageDirty(TiledCanvas canvas)
+    {
+        NextFrame();
+
+        Stage stage = stages[stageIndex];
+        Stage indexStage = indexStages != null ? indexStages[stageIndex] : null;
+
+        bool done = true;
+        staged.Clear();
+        indexStaged.Clear();
+
+        for (int i = 0; i < uploadTiles.Count; i++)
+        {
+            int index = uploadTiles[i];
+            byte[] tile = canvas.GetTile(index);
+            bool resolve = indexStage != null && TiledCanvas.IsIndexedTile(tile);
+
+            if (IsFull(resolve ? indexStage : stage))
+            {
+                canvas.MarkDirty(index);
+                done = false;
+                continue;
+            }
+
+            if (resolve)
+            {
+                indexStaged.Add(Write(canvas, index, tile, indexStage, true));
+            }
+            else
+            {
+                if (TiledCanvas.IsIndexedTile(tile)) tile = Expand(canvas, index);
+
+                staged.Add(Write(canvas, index, tile, stage, false));
+            }
+        }
+
+        Apply(stage, staged.Count > 0);
+        if (indexStage != null) Apply(indexStage, indexStaged.Count > 0);
+
+        for (int i = 0; i < staged.Count; i++)
+        {
+            StagedTile t = staged[i];
+            Graphics.CopyTexture(t.source, 0, 0, t.sx, t.sy, t.w, t.h, page, 0, 0, t.x, t.y);
+        }
+
+        for (int i = 0; i < indexStaged.Count; i++)
+        {
+            ResolveTile(indexStaged[i]);
+        }
+
+        return done;
+    }
+
+    // tile data into the next free place of the stage's atlases
+    private StagedTile Write(TiledCanvas canvas, int index, byte[] tile, Stage stage, bool indexBytes)
+    {
+        StagedTile t = new StagedTile();
+        t.x = (index % canvas.tilesX) << TiledCanvas.TileShift;
+        t.y = (index / canvas.tilesX) << TiledCanvas.TileShift;
+        t.w = Mathf.Min(TiledCanvas.TileSize, canvas.width - t.x);
+        t.h = Mathf.Min(TiledCanvas.TileSize, canvas.height - t.y);
+
+        int atlas = stage.used / (StagingColumns * StagingColumns);
+        int cell = stage.used % (StagingColumns * StagingColumns);
+        stage.used++;
+
+        if (stage.atlases[atlas] == null) stage.atlases[atlas] = CreateStaging(StagingColumns * TiledCanvas.TileSize, indexBytes);
+
+        t.source = stage.atlases[atlas];
+        t.sx = (cell % StagingColumns) << TiledCanvas.TileShift;
+        t.sy = (cell / StagingColumns) << TiledCanvas.TileShift;
+
+        int pixelBytes = indexBytes ? 1 : 4;
+        int atlasWidth = t.source.width;
+        NativeArray<byte> data = t.source.GetPixelData<byte>(0);
+        for (int row = 0; row < TiledCanvas.TileSize; row++)
+        {
+            NativeArray<byte>.Copy(tile, (row << TiledCanvas.TileShift) * pixelBytes, data, ((t.sy + row) * atlasWidth + t.sx) * pixelBytes, TiledCanvas.TileSize * pixelBytes);
+        }
+        return t;
+    }
+
+    // the atlases written this frame go up, each once
+    private void Apply(Stage stage, bool written)
+    {
+        if (!written) return;
+
+        stage.applied = true;
+
+        int count = (stage.used + StagingColumns * StagingColumns - 1) / (StagingColumns * StagingColumns);
+        for (int i = 0; i < count; i++)
+        {
+            Texture2D atlas = stage.atlases[i];
+            atlas.Apply(false);
+            uploadedBytes += atlas.width * atlas.height * (atlas.format == TextureFormat.R8 ? 1 : 4);
+        }
+    }
+
+    private static Texture2D CreateStaging(int size, bool indexBytes)
+    {
+        if (!indexBytes) return new Texture2D(size, size, TextureFormat.RGBA32, false);
+
+        Texture2D created = new Texture2D(size, size, TextureFormat.R8, false, true);
+        created.filterMode = FilterMode.Point;
+        return created;
+    }
+
+    // draws the staged index bytes (a quarter of an RGBA tile) through the palette into the page
+    private void ResolveTile(StagedTile t)
+    {
+        RenderTexture previous = RenderTexture.active;
+        RenderTexture.active = page;
+
+        resolveMaterial.mainTexture = t.source;
+        resolveMaterial.SetPass(0);
+
+        float u0 = (float)t.sx / t.source.width;
+        float v0 = (float)t.sy / t.source.height;
+        float u1 = (float)(t.sx + t.w) / t.source.width;
+        float v1 = (float)(t.sy + t.h) / t.source.height;
+
+        GL.PushMatrix();
+        GL.LoadPixelMatrix(0, page.width, 0, page.height);
+        GL.Begin(GL.QUADS);
+        GL.TexCoord2(u0, v0);
+        GL.Vertex3(t.x, t.y, 0);
+        GL.TexCoord2(u0, v1);
+        GL.Vertex3(t.x, t.y + t.h, 0);
+        GL.TexCoord2(u1, v1);
+        GL.Vertex3(t.x + t.w, t.y + t.h, 0);
+        GL.TexCoord2(u1, v0);
+        GL.Vertex3(t.x + t.w, t.y, 0);
+        GL.End();
+        GL.PopMatrix();
+
+        RenderTexture.active = previous;
+    }
+
+    private byte[] Expand(TiledCanvas canvas, int index)
+    {
+        if (expanded == null)
+        {
+            expanded = new byte[TiledCanvas.TileBytes];
+        }
+
+        canvas.ResolveTile(index, expanded);
+        return expanded;
+    }
+
+    // the dirty tiles into the back texture, with the ones the front got since the back was shown, then swapped in;
+    // canvas can be null when no tiles are to be uploaded
+    private void PresentFallback(TiledCanvas canvas)
+    {
+        int back = 1 - front;
+        NativeArray<byte> data = pageFallback[back].GetPixelData<byte>(0);
+        NativeArray<byte> frontData = pageFallback[front].GetPixelData<byte>(0);
+
+        List<int> missing = pendingTiles[back];
+        for (int i = 0; i < missing.Count; i++)
+        {
+            CopyTile(frontData, data, missing[i]);
+        }
+        missing.Clear();
+
+        for (int i = 0; i < uploadTiles.Count; i++)
+        {
+            WriteTile(canvas, uploadTiles[i], data);
+            pendingTiles[front].Add(uploadTiles[i]);
+        }
+
+        // the whole page goes up, not just the written tiles
+        pageFallback[back].Apply(mipmapped);
+        uploadedBytes += pageFallback[back].width * pageFallback[back].height * 4;
+
+        front = back;
+        texture = pageFallback[front];
+        if (material != null) material.SetTexture("_MainTex", texture);
+    }
+
+    private void CopyTile(NativeArray<byte> src, NativeArray<byte> dst, int index)
+    {
+        int width = pageFallback[0].width;
+        int tilesX = (width + TiledCanvas.TileMask) >> TiledCanvas.TileShift;
+        int x = (index % tilesX) << TiledCanvas.TileShift;
+        int y = (index / tilesX) << TiledCanvas.TileShift;
+        int w = Mathf.Min(TiledCanvas.TileSize, width - x);
+        int h = Mathf.Min(TiledCanvas.TileSize, pageFallback[0].height - y);
+
+        for (int row = 0; row < h; row++)
+        {
+            int offset = ((y + row) * width + x) * 4;
+            NativeArray<byte>.Copy(src, offset, dst, offset, w * 4);
+        }
+    }
+
+    private void WriteTile(TiledCanvas canvas, int index, NativeArray<byte> data)
+    {
+        int x = (index % canvas.tilesX) << TiledCanvas.TileShift;
+        int y = (index / canvas.tilesX) << TiledCanvas.TileShift;
+        int w = Mathf.Min(TiledCanvas.TileSize, canvas.width - x);
+        int h = Mathf.Min(TiledCanvas.TileSize, canvas.height - y);
+
+        byte[] tile = canvas.GetTile(index);
+
+        if (TiledCanvas.IsIndexedTile(tile))
+        {
+            tile = Expand(canvas, index);
+        }
+
+        for (int row = 0; row < h; row++)
+        {
+            NativeArray<byte>.Copy(tile, (row << TiledCanvas.TileShift) * 4, data, ((y + row) * canvas.width + x) * 4, w * 4);
+        }
+    }
+
+    public void Destroy()
+    {
+        if (page != null)
+        {
+            page.Release();
+            Object.Destroy(page);
+
+            DestroyStages(stages);
+            DestroyStages(indexStages);
+        }
+        else
+        {
+            Object.Destroy(pageFallback[0]);
+            Object.Destroy(pageFallback[1]);
+        }
+
+        if (resolveMaterial != null)
+        {
+            Object.Destroy(resolveMaterial);
+        }
+
+        if (paletteTexture != null)
+        {
+            Object.Destroy(paletteTexture);
+        }
+    }
+
+    private static void DestroyStages(Stage[] list)
+    {
+        if (list == null) return;
+
+        for (int i = 0; i < list.Length; i++)
+        {
+            for (int j = 0; j < list[i].atlases.Length; j++)
+            {
+                if (list[i].atlases[j] != null) Object.Destroy(list[i].atlases[j]);
+            }
+        }
+    }
+}
@@ -0,0 +1,97 @@
+﻿using UnityEngine;
+
+// Zoom and pan of the painting board.
+// The board quad always fills the screen, the viewport only changes which part of the page its UVs show,
+// so raycast texture coordinates map screen positions to canvas positions with the zoom already applied.
+public class CanvasViewport
+{
+    public float maxZoom = 8f;
+
+    private float zoom = 1f;
+    private Vector2 min = Vector2.zero; // bottom left of the visible part of the page, in UV
+    private bool changed = true;
+
+    public float Zoom
+    {
+        get { return zoom; }
+    }
+
+    // size of the visible part of the page, in UV
+    public float Size
+    {
+        get { return 1f / zoom; }
+    }
+
+    public bool Changed
+    {
+        get { return changed; }
+    }
+
+    public void Reset()
+    {
+        zoom = 1f;
+        min = Vector2.zero;
+        changed = true;
+    }
+
+    // viewport point (0..1 on screen) to page UV
+    public Vector2 ViewportToUV(Vector2 viewportPoint)
+    {
+        return min + viewportPoint * Size;
+    }
+
+    // scales the view by factor keeping the page point under viewportAnchor, then moves it to viewportTarget
+    public void ZoomAround(Vector2 viewportAnchor, Vector2 viewportTarget, float factor)
+    {
+        Vector2 uvAnchor = ViewportToUV(viewportAnchor);
+
+        zoom = Mathf.Clamp(zoom * factor, 1f, maxZoom);
+        min = uvAnchor - viewportTarget * Size;
+
+        Clamp();
+    }
+
+    public void Pan(Vector2 viewportDelta)
+    {
+        min -= viewportDelta * Size;
+
+        Clamp();
+    }
+
+    private void Clamp()
+    {
+        float limit = 1f - Size;
+        min.x = Mathf.Clamp(min.x, 0f, limit);
+        min.y = Mathf.Clamp(min.y, 0f, limit);
+        changed = true;
+    }
+
+    // writes the visible UV rect into the board quad (vertex order of CreateFullScreenQuad)
+    public void ApplyTo(Mesh mesh)
+    {
+        float size = Size;
+        mesh.uv = new[] {
+            new Vector2(min.x, min.y),
+            new Vector2(min.x, min.y + size),
+            new Vector2(min.x + size, min.y + size),
+            new Vector2(min.x + size, min.y)
+        };
+        changed = false;
+    }
+
+    // tile rect [tx0, tx1) x [ty0, ty1) of the canvas that is on screen
+    public void GetVisibleTiles(TiledCanvas canvas, out int tx0, out int ty0, out int tx1, out int ty1)
+    {
+        float size = Size;
+        tx0 = Mathf.Clamp((int)(min.x * canvas.width) >> TiledCanvas.TileShift, 0, canvas.tilesX);
+        ty0 = Mathf.Clamp((int)(min.y * canvas.height) >> TiledCanvas.TileShift, 0, canvas.tilesY);
+        tx1 = Mathf.Clamp(((int)Mathf.Ceil((min.x + size) * canvas.width) + TiledCanvas.TileMask) >> TiledCanvas.TileShift, 0, canvas.tilesX);
+        ty1 = Mathf.Clamp(((int)Mathf.Ceil((min.y + size) * canvas.height) + TiledCanvas.TileMask) >> TiledCanvas.TileShift, 0, canvas.tilesY);
+    }
+
+    // true while one screen pixel covers more than one canvas pixel, mipmaps are sampled then
+    public bool IsMinified(int canvasWidth, int screenWidth)
+    {
+        return canvasWidth * Size > screenWidth;
+    }
+}
@@ -0,0 +1,128 @@
+﻿using UnityEngine;
+using UnityEngine.Experimental.Rendering;
+using System.Collections;
+using System.IO;
+using System.Threading.Tasks;
+
+// Saves the open page as an image, straight from the CPU side of the page instead of a screen capture.
+// The page is copied on the main thread, then composited with its mask, encoded and written to its file once
+// on a worker. Gallery, share and download get the file from ScreenshotManager once it is written, the UI keeps
+// running meanwhile. Page resolution goes through ImageConversion, print exports (scale > 1) are streamed to the
+// file band by band by PageImageWriter so the scaled frame is never held whole.
+public static class PageExport
+{
+    public static int jpgQuality = 90;
+
+    // watermark may be null
+    public static IEnumerator Export(TiledCanvas canvas, byte[] maskPixels, Watermark watermark, string fileName, string albumName, PageImageWriter.Format format, int scale = 1)
+    {
+        TraceLog.Instant("PageExport.Export");
+
+        string screenshotFilename = ScreenshotManager.NextFileName(fileName, format == PageImageWriter.Format.Png ? ".png" : ".jpg");
+        string path = ScreenshotManager.FilePath(screenshotFilename);
+
+        Debug.Log("Export page " + screenshotFilename + " at " + scale + "x");
+
+        TiledCanvas snapshot;
+        using (TraceLog.Auto("Export Snapshot"))
+        {
+            snapshot = canvas.Clone();
+        }
+
+        byte[] bytes = null;
+#if UNITY_WEBGL
+        // no threads, and the browser downloads the bytes instead of a file
+        if (scale > 1)
+        {
+            using (MemoryStream stream = new MemoryStream())
+            {
+                WriteScaled(snapshot, maskPixels, watermark, format, scale, stream);
+                bytes = stream.ToArray();
+            }
+        }
+        else
+        {
+            bytes = Encode(snapshot, maskPixels, watermark, format);
+        }
+#else
+        Task encode = Task.Run(() =>
+        {
+            if (scale > 1)
+            {
+                using (FileStream file = new FileStream(path, FileMode.Create, FileAccess.Write, FileShare.None, 1 << 16))
+                {
+                    WriteScaled(snapshot, maskPixels, watermark, format, scale, file);
+                }
+                return;
+            }
+
+            bytes = Encode(snapshot, maskPixels, watermark, format);
+
+            using (TraceLog.Auto("Export Write"))
+            {
+                File.WriteAllBytes(path, bytes);
+            }
+        });
+
+        while (!encode.IsCompleted)
+        {
+            yield return null;
+        }
+
+        if (encode.IsFaulted)
+        {
+            Debug.LogException(encode.Exception);
+            yield break;
+        }
+#endif
+
+        yield return ScreenshotManager.Publish(path, screenshotFilename, albumName, bytes);
+    }
+
+    // the page at its own resolution as a file in memory, any thread, releases snapshot
+    public static byte[] Encode(TiledCanvas snapshot, byte[] maskPixels, Watermark watermark, PageImageWriter.Format format)
+    {
+        int width = snapshot.width;
+        int height = snapshot.height;
+        byte[] pixels = BufferPool<byte>.Rent(width * height * 4);
+
+        try
+        {
+            using (TraceLog.Auto("Export Composite"))
+            {
+                PageCompositor.CompositeRows(snapshot, maskPixels, watermark, 0, height, pixels);
+            }
+
+            using (TraceLog.Auto("Export Encode"))
+            {
+                if (format == PageImageWriter.Format.Png)
+                {
+                    return ImageConversion.EncodeArrayToPNG(pixels, GraphicsFormat.R8G8B8A8_UNorm, (uint)width, (uint)height);
+                }
+
+                return ImageConversion.EncodeArrayToJPG(pixels, GraphicsFormat.R8G8B8A8_UNorm, (uint)width, (uint)height, 0, jpgQuality);
+            }
+        }
+        finally
+        {
+            BufferPool<byte>.Return(pixels);
+            snapshot.Release();
+        }
+    }
+
+    // any thread, releases snapshot
+    private static void WriteScaled(TiledCanvas snapshot, byte[] maskPixels, Watermark watermark, PageImageWriter.Format format, int scale, Stream output)
+    {
+        try
+        {
+            using (TraceLog.Auto("Export Stream"))
+            {
+                PageImageWriter.Write(snapshot, maskPixels, watermark, scale, format, jpgQuality, output);
+            }
+        }
+        finally
+        {
+            snapshot.Release();
+        }
+    }
+}
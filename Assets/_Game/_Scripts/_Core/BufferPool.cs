@@ -0,0 +1,132 @@
+﻿using System;
+using System.Collections.Generic;
+using System.Runtime.InteropServices;
+
+// Shared arrays for canvas sized buffers, tiles and fill scratch, so painting does not allocate once it runs.
+// Lengths come in size classes, four per power of two: Rent returns the smallest class that fits, so an array
+// is at most a quarter longer than asked for and may hold old content. Class sizes are exact for powers of two,
+// tiles (TilePixels, TileBytes) keep their length. Return takes back arrays of a class size and drops others.
+// Lengths past the largest class (7 * 2^28) get an exact array that is never pooled.
+// Safe to use from any thread.
+public static class BufferPool<T>
+{
+    public static long maxPooledBytes = 32L << 20; // returned arrays beyond this are left to the GC
+
+    private const int MinShift = 4; // smallest class: 16 elements
+    private const int ClassCount = (31 - MinShift) * 4;
+    private const int MaxClassLength = 7 << 28; // size of the last class, the next one is past int
+
+    private static readonly List<T[]>[] classes = new List<T[]>[ClassCount];
+    private static readonly object sync = new object();
+    private static readonly int elementSize = typeof(T).IsValueType ? Marshal.SizeOf(typeof(T)) : IntPtr.Size;
+    private static readonly bool clearOnReturn = !typeof(T).IsValueType; // don't keep what the elements point to alive
+    private static long pooledBytes = 0;
+
+    // an array of at least length elements
+    public static T[] Rent(int length)
+    {
+        if (length > MaxClassLength) return new T[length];
+
+        int index = ClassIndex(length);
+
+        lock (sync)
+        {
+            List<T[]> free = classes[index];
+            if (free != null && free.Count > 0)
+            {
+                T[] array = free[free.Count - 1];
+                free.RemoveAt(free.Count - 1);
+                pooledBytes -= (long)array.Length * elementSize;
+                return array;
+            }
+        }
+
+        return new T[ClassSize(index)];
+    }
+
+    // the array must not be used after this, null is ignored
+    public static void Return(T[] array)
+    {
+        if (array == null || array.Length < 1 << MinShift || array.Length > MaxClassLength) return;
+
+        int index = ClassIndex(array.Length);
+        if (ClassSize(index) != array.Length) return;
+
+        long bytes = (long)array.Length * elementSize;
+
+        if (clearOnReturn)
+        {
+            Array.Clear(array, 0, array.Length);
+        }
+
+        lock (sync)
+        {
+            if (pooledBytes + bytes > maxPooledBytes) return;
+
+            if (classes[index] == null)
+            {
+                classes[index] = new List<T[]>();
+            }
+
+            classes[index].Add(array);
+            pooledBytes += bytes;
+        }
+    }
+
+    // a longer array with the first count elements of array, which goes back to the pool
+    public static T[] Grow(T[] array, int count)
+    {
+        T[] grown = Rent((int)Math.Min(array.Length * 2L, int.MaxValue));
+        Array.Copy(array, grown, count);
+        Return(array);
+        return grown;
+    }
+
+    public static long PooledBytes
+    {
+        get
+        {
+            lock (sync)
+            {
+                return pooledBytes;
+            }
+        }
+    }
+
+    // drops every pooled array, returns the bytes released
+    public static long Trim()
+    {
+        lock (sync)
+        {
+            long bytes = pooledBytes;
+
+            for (int i = 0; i < classes.Length; i++)
+            {
+                if (classes[i] != null) classes[i].Clear();
+            }
+
+            pooledBytes = 0;
+            return bytes;
+        }
+    }
+
+    private static int ClassIndex(int length)
+    {
+        if (length <= 1 << MinShift) return 0;
+
+        int shift = MinShift;
+        while (length >> (shift + 1) != 0) shift++;
+
+        // quarter steps between 2^shift and 2^(shift + 1)
+        int step = 1 << (shift - 2);
+        int quarter = (length - (1 << shift) + step - 1) / step;
+
+        return (shift - MinShift) * 4 + quarter;
+    }
+
+    private static int ClassSize(int index)
+    {
+        int shift = index / 4 + MinShift;
+        return (4 + index % 4) << (shift - 2);
+    }
+}
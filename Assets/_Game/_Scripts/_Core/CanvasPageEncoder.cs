@@ -0,0 +1,140 @@
+﻿using System.IO;
+
+// Saved page format: header (and palette) followed by the painted tiles only.
+// Version 1 pages (RGBA tiles, no palette) and pages saved before tiling,
+// a flat RGBA32 dump, are still accepted by Decode.
+public static class CanvasPageEncoder
+{
+    private const int Magic = 0x43544243; // "CBTC"
+    private const byte Version = 2;
+
+    private const byte RgbaTile = 0;
+    private const byte IndexedTile = 1;
+
+    public static byte[] Encode(TiledCanvas canvas)
+    {
+        int count = canvas.AllocatedTileCount;
+
+        using (MemoryStream stream = new MemoryStream((int)(25 + canvas.PaletteCount * 4 + count * 5 + canvas.AllocatedBytes)))
+        {
+            using (BinaryWriter writer = new BinaryWriter(stream))
+            {
+                writer.Write(Magic);
+                writer.Write(Version);
+                writer.Write(canvas.width);
+                writer.Write(canvas.height);
+                writer.Write(TiledCanvas.TileSize);
+                writer.Write(canvas.PaletteCount);
+                if (canvas.Indexed)
+                {
+                    writer.Write(canvas.Palette, 0, canvas.PaletteCount * 4);
+                }
+                writer.Write(count);
+
+                for (int i = 0; i < canvas.TileCount; i++)
+                {
+                    if (!canvas.IsAllocated(i)) continue;
+
+                    byte[] tile = canvas.GetTile(i);
+
+                    writer.Write(i);
+                    writer.Write(TiledCanvas.IsIndexedTile(tile) ? IndexedTile : RgbaTile);
+                    writer.Write(tile);
+                }
+            }
+
+            return stream.ToArray();
+        }
+    }
+
+    // legacyWidth / legacyHeight: page size assumed for flat RGBA32 saves, returns null if data is not a page
+    public static TiledCanvas Decode(byte[] data, int legacyWidth, int legacyHeight)
+    {
+        return Decode(data, data != null ? data.Length : 0, legacyWidth, legacyHeight);
+    }
+
+    // a page stored as Base64 text (PlayerPrefs, WebGL .sav files), decoded through a pooled buffer, safe on any thread
+    public static TiledCanvas DecodeBase64(string text, int legacyWidth, int legacyHeight)
+    {
+        if (text == null) return null;
+
+        byte[] buffer = BufferPool<byte>.Rent(text.Length / 4 * 3 + 3);
+        int length;
+
+        TiledCanvas canvas = null;
+        if (System.Convert.TryFromBase64String(text, buffer, out length))
+        {
+            canvas = Decode(buffer, length, legacyWidth, legacyHeight);
+        }
+
+        BufferPool<byte>.Return(buffer);
+        return canvas;
+    }
+
+    // the page in the first length bytes of data, e.g. a pooled buffer, tiles are read into pooled arrays
+    public static TiledCanvas Decode(byte[] data, int length, int legacyWidth, int legacyHeight)
+    {
+        if (data == null) return null;
+
+        if (length == legacyWidth * legacyHeight * 4)
+        {
+            TiledCanvas legacy = new TiledCanvas(legacyWidth, legacyHeight);
+            legacy.LoadRaw(data);
+            return legacy;
+        }
+
+        if (length < 21) return null;
+
+        using (BinaryReader reader = new BinaryReader(new MemoryStream(data, 0, length)))
+        {
+            if (reader.ReadInt32() != Magic) return null;
+
+            byte version = reader.ReadByte();
+            if (version < 1 || version > Version) return null;
+
+            int width = reader.ReadInt32();
+            int height = reader.ReadInt32();
+            int tileSize = reader.ReadInt32();
+
+            if (tileSize != TiledCanvas.TileSize || width <= 0 || height <= 0) return null;
+
+            TiledCanvas canvas = new TiledCanvas(width, height);
+
+            if (version >= 2)
+            {
+                int paletteCount = reader.ReadInt32();
+                if (paletteCount < 0 || paletteCount > TiledCanvas.MaxPaletteSize) return null;
+
+                if (paletteCount > 0)
+                {
+                    byte[] palette = reader.ReadBytes(paletteCount * 4);
+                    if (palette.Length != paletteCount * 4 || palette[0] != 255 || palette[1] != 255 || palette[2] != 255 || palette[3] != 255) return null;
+
+                    canvas.SetPalette(palette, paletteCount);
+                }
+            }
+
+            int count = reader.ReadInt32();
+
+            for (int i = 0; i < count; i++)
+            {
+                if (reader.BaseStream.Position + 5 > length) return null;
+
+                int index = reader.ReadInt32();
+                byte kind = version >= 2 ? reader.ReadByte() : RgbaTile;
+
+                if (kind == IndexedTile && !canvas.Indexed) return null;
+
+                int tileLength = kind == IndexedTile ? TiledCanvas.TilePixels : TiledCanvas.TileBytes;
+                if (index < 0 || index >= canvas.TileCount || reader.BaseStream.Position + tileLength > length) return null;
+
+                byte[] tile = BufferPool<byte>.Rent(tileLength);
+                reader.Read(tile, 0, tileLength);
+
+                canvas.SetTile(index, tile);
+            }
+
+            return canvas;
+        }
+    }
+}
@@ -0,0 +1,550 @@
+﻿using System;
+using System.Collections.Generic;
+
+// Pencil, marker, sticker and paint bucket on a TiledCanvas, in page pixels.
+// Holds what the UI picked (color, brush size, sticker) and the lock area of the current stroke,
+// ColoringBookManager only turns input into page positions and calls in here.
+public class CanvasPainter
+{
+    public const int FillThreshold = 128; // max channel difference of pixels in one fill area
+
+    public readonly TiledCanvas canvas;
+    public readonly byte[] maskPixels; // RGBA outline image of mask pages, null on free paint pages
+
+    public int brushSize = 8;
+    public bool useLockArea = false; // strokes stay inside the area picked where they started
+
+    private readonly int width;
+    private readonly int height;
+
+    private byte paintR = 255, paintG = 0, paintB = 0, paintA = 255;
+
+    private byte[] lockMaskPixels; // locking mask, one byte per canvas pixel (pooled, may be longer)
+    private int[] fillQueue; // pixels waiting in a flood fill, y * width + x (pooled)
+    private int[] regionBounds = new int[4]; // rect of the last labelled fill region
+
+    // brush stamps waiting for DrawQueued (pooled, queuedCount entries are used)
+    private int[] queuedX;
+    private int[] queuedY;
+    private int queuedCount = 0;
+
+    // sticker, RGBA rows bottom up
+    private byte[] stickerBytes;
+    private int stickerWidth;
+    private int stickerHeight;
+    private int stickerWidthHalf;
+
+    public CanvasPainter(TiledCanvas canvas, byte[] maskPixels)
+    {
+        this.canvas = canvas;
+        this.maskPixels = maskPixels;
+
+        width = canvas.width;
+        height = canvas.height;
+
+        // mask pages always paint inside the area under the stroke start
+        useLockArea = maskPixels != null;
+        if (useLockArea)
+        {
+            ClearLockMask();
+        }
+    }
+
+    // gives the lock mask, fill queue and stamp queue back to the pool, call it when the page is closed
+    public void Release()
+    {
+        BufferPool<byte>.Return(lockMaskPixels);
+        BufferPool<int>.Return(fillQueue);
+        BufferPool<int>.Return(queuedX);
+        BufferPool<int>.Return(queuedY);
+        lockMaskPixels = null;
+        fillQueue = null;
+        queuedX = null;
+        queuedY = null;
+        queuedCount = 0;
+    }
+
+    public byte[] LockMask
+    {
+        get { return lockMaskPixels; }
+    }
+
+    public void SetColor(byte r, byte g, byte b, byte a)
+    {
+        paintR = r;
+        paintG = g;
+        paintB = b;
+        paintA = a;
+    }
+
+    public void SetSticker(byte[] rgba, int stickerWidth, int stickerHeight)
+    {
+        stickerBytes = rgba;
+        this.stickerWidth = stickerWidth;
+        this.stickerHeight = stickerHeight;
+
+        // precalculate values
+        stickerWidthHalf = (int)(stickerWidth * 0.5f);
+    }
+
+    // color, brush size and sticker of another painter, e.g. the one of the page before a reload
+    public void CopySettings(CanvasPainter other)
+    {
+        brushSize = other.brushSize;
+        SetColor(other.paintR, other.paintG, other.paintB, other.paintA);
+        SetSticker(other.stickerBytes, other.stickerWidth, other.stickerHeight);
+    }
+
+
+    #region Lock Area
+
+    // the same buffer for every stroke and fill, zeroed
+    private void ClearLockMask()
+    {
+        if (lockMaskPixels == null)
+        {
+            lockMaskPixels = BufferPool<byte>.Rent(width * height);
+        }
+
+        Array.Clear(lockMaskPixels, 0, width * height);
+    }
+
+    // each pixel is queued once after it is marked, the seed may come back once more
+    private int[] FillQueue()
+    {
+        if (fillQueue == null)
+        {
+            fillQueue = BufferPool<int>.Rent(width * height + 1);
+        }
+
+        return fillQueue;
+    }
+
+    public void CreateAreaLockMask(int x, int y)
+    {
+        if (maskPixels != null)
+        {
+            LockAreaFillWithThresholdMaskOnly(x, y);
+        }
+        else
+        {
+            LockMaskFillWithThreshold(x, y);
+        }
+    }
+
+    private void LockAreaFillWithThresholdMaskOnly(int x, int y)
+    {
+        // create locking mask from the mask region under the point (mask pixels within threshold of the hit pixel)
+        if (lockMaskPixels == null) ClearLockMask(); // LabelRegion zeroes it
+        PaintKernels.LabelRegion(maskPixels, width, height, x, y, FillThreshold, lockMaskPixels, null);
+    }
+
+    private void LockMaskFillWithThreshold(int x, int y)
+    {
+        // create locking mask floodfill, using threshold
+
+        // get canvas color from this point
+        byte hitColorR, hitColorG, hitColorB, hitColorA;
+        canvas.GetPixel(x, y, out hitColorR, out hitColorG, out hitColorB, out hitColorA);
+        byte r, g, b, a;
+
+        int[] queue = FillQueue();
+        int head = 0, tail = 0;
+        queue[tail++] = width * y + x;
+
+        int ptsx, ptsy;
+        int pixel = 0;
+
+        ClearLockMask();
+
+        while (head < tail)
+        {
+
+            ptsx = queue[head] % width;
+            ptsy = queue[head++] / width;
+
+            if (ptsy - 1 > -1)
+            {
+                pixel = width * (ptsy - 1) + ptsx; // down
+                canvas.GetPixel(ptsx, ptsy - 1, out r, out g, out b, out a);
+
+                if (lockMaskPixels[pixel] == 0 // this pixel is not used yet
+                    && (CompareThreshold(r, hitColorR) || CompareThreshold(r, paintR)) // if pixel is same as hit color OR same as paint color
+                    && (CompareThreshold(g, hitColorG) || CompareThreshold(g, paintG))
+                    && (CompareThreshold(b, hitColorB) || CompareThreshold(b, paintB))
+                    && (CompareThreshold(a, hitColorA) || CompareThreshold(a, paintA)))
+                {
+                    queue[tail++] = pixel;
+                    lockMaskPixels[pixel] = 1;
+                }
+            }
+
+            if (ptsx + 1 < width)
+            {
+                pixel = width * ptsy + ptsx + 1; // right
+                canvas.GetPixel(ptsx + 1, ptsy, out r, out g, out b, out a);
+                if (lockMaskPixels[pixel] == 0
+                    && (CompareThreshold(r, hitColorR) || CompareThreshold(r, paintR)) // if pixel is same as hit color OR same as paint color
+                    && (CompareThreshold(g, hitColorG) || CompareThreshold(g, paintG))
+                    && (CompareThreshold(b, hitColorB) || CompareThreshold(b, paintB))
+                    && (CompareThreshold(a, hitColorA) || CompareThreshold(a, paintA)))
+                {
+                    queue[tail++] = pixel;
+                    lockMaskPixels[pixel] = 1;
+                }
+            }
+
+            if (ptsx - 1 > -1)
+            {
+                pixel = width * ptsy + ptsx - 1; // left
+                canvas.GetPixel(ptsx - 1, ptsy, out r, out g, out b, out a);
+                if (lockMaskPixels[pixel] == 0
+                    && (CompareThreshold(r, hitColorR) || CompareThreshold(r, paintR)) // if pixel is same as hit color OR same as paint color
+                    && (CompareThreshold(g, hitColorG) || CompareThreshold(g, paintG))
+                    && (CompareThreshold(b, hitColorB) || CompareThreshold(b, paintB))
+                    && (CompareThreshold(a, hitColorA) || CompareThreshold(a, paintA)))
+                {
+                    queue[tail++] = pixel;
+                    lockMaskPixels[pixel] = 1;
+                }
+            }
+
+            if (ptsy + 1 < height)
+            {
+                pixel = width * (ptsy + 1) + ptsx; // up
+                canvas.GetPixel(ptsx, ptsy + 1, out r, out g, out b, out a);
+                if (lockMaskPixels[pixel] == 0
+                    && (CompareThreshold(r, hitColorR) || CompareThreshold(r, paintR)) // if pixel is same as hit color OR same as paint color
+                    && (CompareThreshold(g, hitColorG) || CompareThreshold(g, paintG))
+                    && (CompareThreshold(b, hitColorB) || CompareThreshold(b, paintB))
+                    && (CompareThreshold(a, hitColorA) || CompareThreshold(a, paintA)))
+                {
+                    queue[tail++] = pixel;
+                    lockMaskPixels[pixel] = 1;
+                }
+            }
+        }
+    }
+
+    #endregion
+
+
+    #region Brushes
+
+    public void DrawCircle(int x, int y)
+    {
+        // brush stamp, tile by tile
+        canvas.StampCircle(x, y, brushSize, paintR, paintG, paintB, paintA, useLockArea ? lockMaskPixels : null);
+    }
+
+    public void DrawAdditiveCircle(int x, int y)
+    {
+        // draw fast circle, one span per row, additive over white also
+        int r2 = brushSize * brushSize;
+        for (int ty = 1 - brushSize; ty < brushSize; ty++)
+        {
+            int halfWidth = PaintKernels.HalfWidth(r2 - ty * ty);
+            canvas.BlendSpan(y + ty, x - halfWidth, x + halfWidth + 1, paintR, paintG, paintB, paintA, useLockArea ? lockMaskPixels : null);
+        }
+    }
+
+    public void DrawSticker(int px, int py)
+    {
+        if (stickerBytes == null) return;
+
+        // get position where we paint
+        int startX = (int)(px - stickerWidthHalf);
+        int startY = (int)(py - stickerWidthHalf);
+
+        if (startX < 0)
+        {
+            startX = 0;
+        }
+        else {
+            if (startX + stickerWidth >= width) startX = width - stickerWidth;
+        }
+
+        if (startY < 1)
+        {
+            startY = 1;
+        }
+        else {
+            if (startY + stickerHeight >= height) startY = height - stickerHeight;
+        }
+
+        // copy row by row, pixels with brush alpha 0 are skipped
+        for (int y = 0; y < stickerHeight; y++)
+        {
+            canvas.BlitSpan(startY + y, startX, stickerBytes, stickerWidth * y * 4, stickerWidth);
+        }
+    }
+
+    public void DrawPoint(int x, int y)
+    {
+        canvas.SetPixel(x, y, paintR, paintG, paintB, paintA);
+    }
+
+    public void DrawLine(int x0, int y0, int x1, int y1)
+    {
+        QueueLine(x0, y0, x1, y1);
+        DrawQueued(false);
+    }
+
+    public void DrawAdditiveLine(int x0, int y0, int x1, int y1)
+    {
+        QueueLine(x0, y0, x1, y1);
+        DrawQueued(true);
+    }
+
+    public void DrawLineWithSticker(int x0, int y0, int x1, int y1)
+    {
+        int dx = Math.Abs(x1 - x0);
+        int dy = Math.Abs(y1 - y0);
+        int sx, sy;
+        if (x0 < x1) { sx = 1; } else { sx = -1; }
+        if (y0 < y1) { sy = 1; } else { sy = -1; }
+        int err = dx - dy;
+        bool loop = true;
+        int minDistance = (int)(brushSize >> 1); // divide by 2, you might want to set mindistance to smaller value, to avoid gaps between brushes when moving fast
+        int pixelCount = 0;
+        int e2;
+        while (loop)
+        {
+            pixelCount++;
+            if (pixelCount > minDistance)
+            {
+                pixelCount = 0;
+                DrawSticker(x0, y0);
+            }
+            if ((x0 == x1) && (y0 == y1)) loop = false;
+            e2 = 2 * err;
+            if (e2 > -dy)
+            {
+                err = err - dy;
+                x0 = x0 + sx;
+            }
+            if (e2 < dx)
+            {
+                err = err + dx;
+                y0 = y0 + sy;
+            }
+        }
+    }
+
+    #endregion
+
+
+    #region Stamp Queue
+
+    // a brush stamp for the next DrawQueued, e.g. one per point of a frame's stroke
+    public void QueueCircle(int x, int y)
+    {
+        if (queuedX == null)
+        {
+            queuedX = BufferPool<int>.Rent(64);
+            queuedY = BufferPool<int>.Rent(64);
+        }
+        else if (queuedCount == queuedX.Length)
+        {
+            queuedX = BufferPool<int>.Grow(queuedX, queuedCount);
+            queuedY = BufferPool<int>.Grow(queuedY, queuedCount);
+        }
+
+        queuedX[queuedCount] = x;
+        queuedY[queuedCount] = y;
+        queuedCount++;
+    }
+
+    // the stamps of a line: one every half brush size along it
+    public void QueueLine(int x0, int y0, int x1, int y1)
+    {
+        int dx = Math.Abs(x1 - x0);
+        int dy = Math.Abs(y1 - y0);
+        int sx, sy;
+        if (x0 < x1) { sx = 1; } else { sx = -1; }
+        if (y0 < y1) { sy = 1; } else { sy = -1; }
+        int err = dx - dy;
+        bool loop = true;
+        int minDistance = (int)(brushSize >> 1);
+        int pixelCount = 0;
+        int e2;
+        while (loop)
+        {
+            pixelCount++;
+            if (pixelCount > minDistance)
+            {
+                pixelCount = 0;
+                QueueCircle(x0, y0);
+            }
+            if ((x0 == x1) && (y0 == y1)) loop = false;
+            e2 = 2 * err;
+            if (e2 > -dy)
+            {
+                err = err - dy;
+                x0 = x0 + sx;
+            }
+            if (e2 < dx)
+            {
+                err = err + dx;
+                y0 = y0 + sy;
+            }
+        }
+    }
+
+    // paints the queued stamps in one pass over the tiles they touch, like DrawCircle (or DrawAdditiveCircle) at each
+    public void DrawQueued(bool additive)
+    {
+        if (queuedCount == 0) return;
+
+        byte[] lockMask = useLockArea ? lockMaskPixels : null;
+        if (additive)
+        {
+            canvas.BlendCircles(queuedX, queuedY, queuedCount, brushSize, paintR, paintG, paintB, paintA, lockMask);
+        }
+        else
+        {
+            canvas.StampCircles(queuedX, queuedY, queuedCount, brushSize, paintR, paintG, paintB, paintA, lockMask);
+        }
+
+        queuedCount = 0;
+    }
+
+    #endregion
+
+
+    #region Paint Bucket
+
+    public void FloodFill(int x, int y)
+    {
+        if (maskPixels != null)
+        {
+            FloodFillMaskOnlyWithThreshold(x, y);
+        }
+        else
+        {
+            FloodFillWithTreshold(x, y);
+        }
+    }
+
+    private void FloodFillMaskOnlyWithThreshold(int x, int y)
+    {
+        // get canvas hit color
+        byte hitColorR = maskPixels[((width * (y) + x) * 4) + 0];
+        byte hitColorG = maskPixels[((width * (y) + x) * 4) + 1];
+        byte hitColorB = maskPixels[((width * (y) + x) * 4) + 2];
+        byte hitColorA = maskPixels[((width * (y) + x) * 4) + 3];
+
+        if (paintR == hitColorR && paintG == hitColorG && paintB == hitColorB && paintA == hitColorA) return;
+
+        // label the mask region, then fill it row by row through the region as lock mask
+        if (lockMaskPixels == null) ClearLockMask(); // LabelRegion zeroes it
+        if (PaintKernels.LabelRegion(maskPixels, width, height, x, y, FillThreshold, lockMaskPixels, regionBounds) == 0) return;
+
+        for (int row = regionBounds[1]; row < regionBounds[3]; row++)
+        {
+            canvas.FillSpan(row, regionBounds[0], regionBounds[2], paintR, paintG, paintB, paintA, lockMaskPixels);
+        }
+    }
+
+    private void FloodFillWithTreshold(int x, int y)
+    {
+        // get canvas hit color
+        byte hitColorR, hitColorG, hitColorB, hitColorA;
+        canvas.GetPixel(x, y, out hitColorR, out hitColorG, out hitColorB, out hitColorA);
+        byte r, g, b, a;
+
+        if (paintR == hitColorR && paintG == hitColorG && paintB == hitColorB && paintA == hitColorA) return;
+
+        int[] queue = FillQueue();
+        int head = 0, tail = 0;
+        queue[tail++] = width * y + x;
+
+        int ptsx, ptsy;
+        int pixel = 0;
+
+        ClearLockMask();
+
+        while (head < tail)
+        {
+
+            ptsx = queue[head] % width;
+            ptsy = queue[head++] / width;
+
+            if (ptsy - 1 > -1)
+            {
+                pixel = width * (ptsy - 1) + ptsx; // down
+                canvas.GetPixel(ptsx, ptsy - 1, out r, out g, out b, out a);
+                if (lockMaskPixels[pixel] == 0
+                    && CompareThreshold(r, hitColorR)
+                    && CompareThreshold(g, hitColorG)
+                    && CompareThreshold(b, hitColorB)
+                    && CompareThreshold(a, hitColorA))
+                {
+                    queue[tail++] = pixel;
+                    DrawPoint(ptsx, ptsy - 1);
+                    lockMaskPixels[pixel] = 1;
+                }
+            }
+
+            if (ptsx + 1 < width)
+            {
+                pixel = width * ptsy + ptsx + 1; // right
+                canvas.GetPixel(ptsx + 1, ptsy, out r, out g, out b, out a);
+                if (lockMaskPixels[pixel] == 0
+                    && CompareThreshold(r, hitColorR)
+                    && CompareThreshold(g, hitColorG)
+                    && CompareThreshold(b, hitColorB)
+                    && CompareThreshold(a, hitColorA))
+                {
+                    queue[tail++] = pixel;
+                    DrawPoint(ptsx + 1, ptsy);
+                    lockMaskPixels[pixel] = 1;
+                }
+            }
+
+            if (ptsx - 1 > -1)
+            {
+                pixel = width * ptsy + ptsx - 1; // left
+                canvas.GetPixel(ptsx - 1, ptsy, out r, out g, out b, out a);
+                if (lockMaskPixels[pixel] == 0
+                    && CompareThreshold(r, hitColorR)
+                    && CompareThreshold(g, hitColorG)
+                    && CompareThreshold(b, hitColorB)
+                    && CompareThreshold(a, hitColorA))
+                {
+                    queue[tail++] = pixel;
+                    DrawPoint(ptsx - 1, ptsy);
+                    lockMaskPixels[pixel] = 1;
+                }
+            }
+
+            if (ptsy + 1 < height)
+            {
+                pixel = width * (ptsy + 1) + ptsx; // up
+                canvas.GetPixel(ptsx, ptsy + 1, out r, out g, out b, out a);
+                if (lockMaskPixels[pixel] == 0
+                    && CompareThreshold(r, hitColorR)
+                    && CompareThreshold(g, hitColorG)
+                    && CompareThreshold(b, hitColorB)
+                    && CompareThreshold(a, hitColorA))
+                {
+                    queue[tail++] = pixel;
+                    DrawPoint(ptsx, ptsy + 1);
+                    lockMaskPixels[pixel] = 1;
+                }
+            }
+        }
+    }
+
+    public static bool CompareThreshold(byte a, byte b)
+    {
+        if (a < b)
+        {
+            a ^= b; b ^= a; a ^= b;
+        }
+
+        return (a - b) <= FillThreshold;
+    }
+
+    #endregion
+}
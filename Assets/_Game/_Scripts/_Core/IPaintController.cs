@@ -0,0 +1,38 @@
+﻿// The paint scene as scripted input drives it (PlayMode tests, InputLog replays): pointer events in page pixels
+// and the toolbar buttons. ColoringBookManager implements it, find it with FindObjectsByType.
+public interface IPaintController
+{
+    TiledCanvas Canvas { get; }
+
+    // false while the page is still opening (OpenPageStaged), wait for it before sending input
+    bool Ready { get; }
+
+    // 0 pencil, 1 marker, 2 paint bucket, 3 sticker
+    void SelectDrawMode(int drawMode);
+
+    // button index in the color panel of the current draw mode
+    void SelectColor(int index);
+
+    void SelectSticker(int index);
+
+    // 8, 16 or 24
+    void SelectBrushSize(int brushSize);
+
+    void PointerDown(float x, float y);
+    void PointerMove(float x, float y);
+    void PointerUp(float x, float y);
+
+    void Undo();
+    void Redo();
+    void Clear();
+
+    // stores the page under its ID, Reload reads it back like opening the page again
+    void Save();
+    void Reload();
+
+    // replaces the page with CanvasPageEncoder data (null: blank page), the undo history starts empty
+    void Open(byte[] page);
+
+    // while set, every input above that reaches the page is appended to it
+    InputLog Recording { get; set; }
+}
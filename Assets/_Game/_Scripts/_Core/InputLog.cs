@@ -0,0 +1,261 @@
+﻿using System.Collections.Generic;
+using System.IO;
+
+// Recorded painting session: the page it started on and every input the paint scene reacted to,
+// pointer samples in page pixels and the toolbar buttons, with milliseconds since the start.
+// Replaying it through an IPaintController paints the same bytes, at any speed.
+public class InputLog
+{
+    private const int Magic = 0x4C494243; // "CBIL"
+    private const byte Version = 1;
+
+    public enum EventType : byte
+    {
+        PointerDown,
+        PointerMove,
+        PointerUp,
+        DrawMode,
+        Color,
+        Sticker,
+        BrushSize,
+        Undo,
+        Redo,
+        Clear
+    }
+
+    public struct Event
+    {
+        public int time; // ms since the start of the log
+        public EventType type;
+        public float x; // pointer events, page pixels
+        public float y;
+        public int value; // draw mode, button index or brush size
+    }
+
+    public int maskIndex; // page the session was painted on, -1 free page
+    public int width;
+    public int height;
+    public byte[] page; // CanvasPageEncoder data of the page at the start
+    public bool hasChecksum;
+    public uint checksum; // TiledCanvas.Checksum at the end, set by Finish
+
+    public readonly List<Event> events = new List<Event>();
+
+    // starts a log on the current content of canvas
+    public static InputLog Begin(TiledCanvas canvas, int maskIndex)
+    {
+        InputLog log = new InputLog();
+        log.maskIndex = maskIndex;
+        log.width = canvas.width;
+        log.height = canvas.height;
+        log.page = CanvasPageEncoder.Encode(canvas);
+        return log;
+    }
+
+    public void AddPointer(int time, EventType type, float x, float y)
+    {
+        Event e = new Event();
+        e.time = time;
+        e.type = type;
+        e.x = x;
+        e.y = y;
+        events.Add(e);
+    }
+
+    public void Add(int time, EventType type, int value)
+    {
+        Event e = new Event();
+        e.time = time;
+        e.type = type;
+        e.value = value;
+        events.Add(e);
+    }
+
+    // stores the result the replay has to reach
+    public void Finish(TiledCanvas canvas)
+    {
+        checksum = canvas.Checksum();
+        hasChecksum = true;
+    }
+
+    public int Duration
+    {
+        get { return events.Count > 0 ? events[events.Count - 1].time : 0; }
+    }
+
+
+    #region Replay
+
+    // opens the start page and feeds every event, as fast as possible
+    public void Replay(IPaintController target)
+    {
+        target.Open(page);
+        Replay(target, 0, int.MaxValue);
+    }
+
+    // feeds the events from index next up to time (ms), returns the index to continue from
+    public int Replay(IPaintController target, int next, int time)
+    {
+        for (; next < events.Count && events[next].time <= time; next++)
+        {
+            Event e = events[next];
+
+            switch (e.type)
+            {
+                case EventType.PointerDown: target.PointerDown(e.x, e.y); break;
+                case EventType.PointerMove: target.PointerMove(e.x, e.y); break;
+                case EventType.PointerUp: target.PointerUp(e.x, e.y); break;
+                case EventType.DrawMode: target.SelectDrawMode(e.value); break;
+                case EventType.Color: target.SelectColor(e.value); break;
+                case EventType.Sticker: target.SelectSticker(e.value); break;
+                case EventType.BrushSize: target.SelectBrushSize(e.value); break;
+                case EventType.Undo: target.Undo(); break;
+                case EventType.Redo: target.Redo(); break;
+                case EventType.Clear: target.Clear(); break;
+            }
+        }
+
+        return next;
+    }
+
+    #endregion
+
+
+    #region Encoding
+
+    // header, start page, then per event: type byte, time delta (varint), x and y floats or value (varint)
+    public byte[] Encode()
+    {
+        using (MemoryStream stream = new MemoryStream(32 + page.Length + events.Count * 10))
+        {
+            using (BinaryWriter writer = new BinaryWriter(stream))
+            {
+                writer.Write(Magic);
+                writer.Write(Version);
+                writer.Write(maskIndex);
+                writer.Write(width);
+                writer.Write(height);
+                writer.Write(hasChecksum);
+                writer.Write(checksum);
+                writer.Write(page.Length);
+                writer.Write(page);
+                writer.Write(events.Count);
+
+                int time = 0;
+                for (int i = 0; i < events.Count; i++)
+                {
+                    Event e = events[i];
+
+                    writer.Write((byte)e.type);
+                    WriteVarint(writer, (uint)(e.time - time));
+                    time = e.time;
+
+                    if (IsPointer(e.type))
+                    {
+                        writer.Write(e.x);
+                        writer.Write(e.y);
+                    }
+                    else if (HasValue(e.type))
+                    {
+                        WriteVarint(writer, (uint)e.value);
+                    }
+                }
+            }
+
+            return stream.ToArray();
+        }
+    }
+
+    // returns null if data is not an input log
+    public static InputLog Decode(byte[] data)
+    {
+        if (data == null || data.Length < 30) return null;
+
+        try
+        {
+            using (BinaryReader reader = new BinaryReader(new MemoryStream(data)))
+            {
+                if (reader.ReadInt32() != Magic) return null;
+                if (reader.ReadByte() != Version) return null;
+
+                InputLog log = new InputLog();
+                log.maskIndex = reader.ReadInt32();
+                log.width = reader.ReadInt32();
+                log.height = reader.ReadInt32();
+                log.hasChecksum = reader.ReadBoolean();
+                log.checksum = reader.ReadUInt32();
+
+                int pageLength = reader.ReadInt32();
+                if (pageLength < 0 || pageLength > data.Length) return null;
+                log.page = reader.ReadBytes(pageLength);
+                if (log.page.Length != pageLength) return null;
+
+                int count = reader.ReadInt32();
+                if (count < 0 || count > data.Length) return null;
+
+                int time = 0;
+                for (int i = 0; i < count; i++)
+                {
+                    Event e = new Event();
+                    e.type = (EventType)reader.ReadByte();
+                    if (e.type > EventType.Clear) return null;
+
+                    time += (int)ReadVarint(reader);
+                    e.time = time;
+
+                    if (IsPointer(e.type))
+                    {
+                        e.x = reader.ReadSingle();
+                        e.y = reader.ReadSingle();
+                    }
+                    else if (HasValue(e.type))
+                    {
+                        e.value = (int)ReadVarint(reader);
+                    }
+
+                    log.events.Add(e);
+                }
+
+                return log;
+            }
+        }
+        catch (EndOfStreamException)
+        {
+            return null;
+        }
+    }
+
+    private static bool IsPointer(EventType type)
+    {
+        return type <= EventType.PointerUp;
+    }
+
+    private static bool HasValue(EventType type)
+    {
+        return type >= EventType.DrawMode && type <= EventType.BrushSize;
+    }
+
+    private static void WriteVarint(BinaryWriter writer, uint value)
+    {
+        while (value >= 0x80)
+        {
+            writer.Write((byte)(value | 0x80));
+            value >>= 7;
+        }
+        writer.Write((byte)value);
+    }
+
+    private static uint ReadVarint(BinaryReader reader)
+    {
+        uint value = 0;
+        for (int shift = 0; shift < 35; shift += 7)
+        {
+            byte b = reader.ReadByte();
+            value |= (uint)(b & 0x7F) << shift;
+            if ((b & 0x80) == 0) return value;
+        }
+        throw new EndOfStreamException();
+    }
+
+    #endregion
+}
@@ -0,0 +1,459 @@
+﻿using System.IO;
+
+// Streams a baseline JPEG (YCbCr 4:2:0, the standard Huffman tables) to a stream one row at a time, top row first.
+// Rows are collected until a row of 16x16 MCUs is complete, which is then encoded and written right away,
+// so whatever the image size, memory stays at 16 rows plus the Huffman bit buffer.
+public class JpegRowWriter
+{
+    private static readonly int[] naturalOrder =
+    {
+         0,  1,  8, 16,  9,  2,  3, 10,
+        17, 24, 32, 25, 18, 11,  4,  5,
+        12, 19, 26, 33, 40, 48, 41, 34,
+        27, 20, 13,  6,  7, 14, 21, 28,
+        35, 42, 49, 56, 57, 50, 43, 36,
+        29, 22, 15, 23, 30, 37, 44, 51,
+        58, 59, 52, 45, 38, 31, 39, 46,
+        53, 60, 61, 54, 47, 55, 62, 63
+    };
+
+    // JPEG Annex K, natural order
+    private static readonly byte[] lumaQuant =
+    {
+        16, 11, 10, 16, 24, 40, 51, 61,
+        12, 12, 14, 19, 26, 58, 60, 55,
+        14, 13, 16, 24, 40, 57, 69, 56,
+        14, 17, 22, 29, 51, 87, 80, 62,
+        18, 22, 37, 56, 68, 109, 103, 77,
+        24, 35, 55, 64, 81, 104, 113, 92,
+        49, 64, 78, 87, 103, 121, 120, 101,
+        72, 92, 95, 98, 112, 100, 103, 99
+    };
+
+    private static readonly byte[] chromaQuant =
+    {
+        17, 18, 24, 47, 99, 99, 99, 99,
+        18, 21, 26, 66, 99, 99, 99, 99,
+        24, 26, 56, 99, 99, 99, 99, 99,
+        47, 66, 99, 99, 99, 99, 99, 99,
+        99, 99, 99, 99, 99, 99, 99, 99,
+        99, 99, 99, 99, 99, 99, 99, 99,
+        99, 99, 99, 99, 99, 99, 99, 99,
+        99, 99, 99, 99, 99, 99, 99, 99
+    };
+
+    private static readonly byte[] dcLumaBits = { 0, 1, 5, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0, 0, 0 };
+    private static readonly byte[] dcChromaBits = { 0, 3, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0 };
+    private static readonly byte[] dcValues = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11 };
+
+    private static readonly byte[] acLumaBits = { 0, 2, 1, 3, 3, 2, 4, 3, 5, 5, 4, 4, 0, 0, 1, 0x7d };
+    private static readonly byte[] acLumaValues =
+    {
+        0x01, 0x02, 0x03, 0x00, 0x04, 0x11, 0x05, 0x12, 0x21, 0x31, 0x41, 0x06, 0x13, 0x51, 0x61, 0x07,
+        0x22, 0x71, 0x14, 0x32, 0x81, 0x91, 0xa1, 0x08, 0x23, 0x42, 0xb1, 0xc1, 0x15, 0x52, 0xd1, 0xf0,
+        0x24, 0x33, 0x62, 0x72, 0x82, 0x09, 0x0a, 0x16, 0x17, 0x18, 0x19, 0x1a, 0x25, 0x26, 0x27, 0x28,
+        0x29, 0x2a, 0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3a, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48, 0x49,
+        0x4a, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58, 0x59, 0x5a, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68, 0x69,
+        0x6a, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79, 0x7a, 0x83, 0x84, 0x85, 0x86, 0x87, 0x88, 0x89,
+        0x8a, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99, 0x9a, 0xa2, 0xa3, 0xa4, 0xa5, 0xa6, 0xa7,
+        0xa8, 0xa9, 0xaa, 0xb2, 0xb3, 0xb4, 0xb5, 0xb6, 0xb7, 0xb8, 0xb9, 0xba, 0xc2, 0xc3, 0xc4, 0xc5,
+        0xc6, 0xc7, 0xc8, 0xc9, 0xca, 0xd2, 0xd3, 0xd4, 0xd5, 0xd6, 0xd7, 0xd8, 0xd9, 0xda, 0xe1, 0xe2,
+        0xe3, 0xe4, 0xe5, 0xe6, 0xe7, 0xe8, 0xe9, 0xea, 0xf1, 0xf2, 0xf3, 0xf4, 0xf5, 0xf6, 0xf7, 0xf8,
+        0xf9, 0xfa
+    };
+
+    private static readonly byte[] acChromaBits = { 0, 2, 1, 2, 4, 4, 3, 4, 7, 5, 4, 4, 0, 1, 2, 0x77 };
+    private static readonly byte[] acChromaValues =
+    {
+        0x00, 0x01, 0x02, 0x03, 0x11, 0x04, 0x05, 0x21, 0x31, 0x06, 0x12, 0x41, 0x51, 0x07, 0x61, 0x71,
+        0x13, 0x22, 0x32, 0x81, 0x08, 0x14, 0x42, 0x91, 0xa1, 0xb1, 0xc1, 0x09, 0x23, 0x33, 0x52, 0xf0,
+        0x15, 0x62, 0x72, 0xd1, 0x0a, 0x16, 0x24, 0x34, 0xe1, 0x25, 0xf1, 0x17, 0x18, 0x19, 0x1a, 0x26,
+        0x27, 0x28, 0x29, 0x2a, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3a, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48,
+        0x49, 0x4a, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58, 0x59, 0x5a, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68,
+        0x69, 0x6a, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79, 0x7a, 0x82, 0x83, 0x84, 0x85, 0x86, 0x87,
+        0x88, 0x89, 0x8a, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99, 0x9a, 0xa2, 0xa3, 0xa4, 0xa5,
+        0xa6, 0xa7, 0xa8, 0xa9, 0xaa, 0xb2, 0xb3, 0xb4, 0xb5, 0xb6, 0xb7, 0xb8, 0xb9, 0xba, 0xc2, 0xc3,
+        0xc4, 0xc5, 0xc6, 0xc7, 0xc8, 0xc9, 0xca, 0xd2, 0xd3, 0xd4, 0xd5, 0xd6, 0xd7, 0xd8, 0xd9, 0xda,
+        0xe2, 0xe3, 0xe4, 0xe5, 0xe6, 0xe7, 0xe8, 0xe9, 0xea, 0xf2, 0xf3, 0xf4, 0xf5, 0xf6, 0xf7, 0xf8,
+        0xf9, 0xfa
+    };
+
+    // AAN DCT output scale per row / column
+    private static readonly float[] aanScale = { 1f, 1.387039845f, 1.306562965f, 1.175875602f, 1f, 0.785694958f, 0.541196100f, 0.275899379f };
+
+    private class Huffman
+    {
+        public int[] codes = new int[256];
+        public int[] sizes = new int[256];
+
+        public Huffman(byte[] bits, byte[] values)
+        {
+            int code = 0;
+            int k = 0;
+            for (int length = 1; length <= 16; length++)
+            {
+                for (int i = 0; i < bits[length - 1]; i++)
+                {
+                    codes[values[k]] = code++;
+                    sizes[values[k]] = length;
+                    k++;
+                }
+                code <<= 1;
+            }
+        }
+    }
+
+    private static readonly Huffman dcLuma = new Huffman(dcLumaBits, dcValues);
+    private static readonly Huffman dcChroma = new Huffman(dcChromaBits, dcValues);
+    private static readonly Huffman acLuma = new Huffman(acLumaBits, acLumaValues);
+    private static readonly Huffman acChroma = new Huffman(acChromaBits, acChromaValues);
+
+    private readonly Stream output;
+    private readonly int width;
+    private readonly int height;
+    private readonly int paddedWidth; // multiple of 16, the last column repeats
+    private readonly byte[] lumaTable = new byte[64]; // quality scaled, natural order
+    private readonly byte[] chromaTable = new byte[64];
+    private readonly float[] lumaDivisors = new float[64];
+    private readonly float[] chromaDivisors = new float[64];
+
+    private byte[] rows; // 16 RGB rows of paddedWidth
+    private int rowsInMcu = 0;
+    private int rowsWritten = 0;
+
+    private readonly float[] block = new float[64];
+    private readonly int[] quantized = new int[64];
+    private int dcY, dcCb, dcCr;
+
+    // Huffman output, bytes go out through a small buffer with 0xFF stuffed
+    private int bitBuffer = 0;
+    private int bitCount = 0;
+    private readonly byte[] outBuffer = new byte[4096];
+    private int outCount = 0;
+
+    // quality 1 - 100 like libjpeg
+    public JpegRowWriter(Stream output, int width, int height, int quality)
+    {
+        this.output = output;
+        this.width = width;
+        this.height = height;
+        paddedWidth = (width + 15) & ~15;
+        rows = BufferPool<byte>.Rent(paddedWidth * 3 * 16);
+
+        quality = System.Math.Max(1, System.Math.Min(100, quality));
+        int scale = quality < 50 ? 5000 / quality : 200 - quality * 2;
+        SetupTable(lumaQuant, scale, lumaTable, lumaDivisors);
+        SetupTable(chromaQuant, scale, chromaTable, chromaDivisors);
+
+        WriteHeaders();
+    }
+
+    private static void SetupTable(byte[] baseTable, int scale, byte[] table, float[] divisors)
+    {
+        for (int i = 0; i < 64; i++)
+        {
+            int q = (baseTable[i] * scale + 50) / 100;
+            table[i] = (byte)System.Math.Max(1, System.Math.Min(255, q));
+            divisors[i] = 1f / (table[i] * aanScale[i >> 3] * aanScale[i & 7] * 8f);
+        }
+    }
+
+    // the next row from the top, width RGBA pixels (alpha is dropped) at offset
+    public void WriteRow(byte[] rgba, int offset)
+    {
+        if (rowsWritten == height) throw new System.InvalidOperationException("all " + height + " rows are written");
+
+        int dst = rowsInMcu * paddedWidth * 3;
+        for (int x = 0; x < width; x++, offset += 4, dst += 3)
+        {
+            rows[dst] = rgba[offset];
+            rows[dst + 1] = rgba[offset + 1];
+            rows[dst + 2] = rgba[offset + 2];
+        }
+        for (int x = width; x < paddedWidth; x++, dst += 3)
+        {
+            rows[dst] = rows[dst - 3];
+            rows[dst + 1] = rows[dst - 2];
+            rows[dst + 2] = rows[dst - 1];
+        }
+
+        rowsInMcu++;
+        rowsWritten++;
+
+        if (rowsInMcu == 16 || rowsWritten == height)
+        {
+            EncodeMcuRow();
+        }
+    }
+
+    // ends the image, the stream stays open
+    public void Finish()
+    {
+        if (rowsWritten != height) throw new System.InvalidOperationException(rowsWritten + " of " + height + " rows written");
+
+        // pad the last byte with ones
+        WriteBits(0x7F, 7);
+        FlushOutput();
+
+        output.WriteByte(0xFF);
+        output.WriteByte(0xD9);
+
+        BufferPool<byte>.Return(rows);
+        rows = null;
+    }
+
+
+    #region Blocks
+
+    private void EncodeMcuRow()
+    {
+        // the last MCU row repeats its last row
+        int rowBytes = paddedWidth * 3;
+        for (int r = rowsInMcu; r < 16; r++)
+        {
+            System.Buffer.BlockCopy(rows, (rowsInMcu - 1) * rowBytes, rows, r * rowBytes, rowBytes);
+        }
+        rowsInMcu = 0;
+
+        for (int mx = 0; mx < paddedWidth; mx += 16)
+        {
+            for (int by = 0; by < 16; by += 8)
+            {
+                for (int bx = 0; bx < 16; bx += 8)
+                {
+                    LoadLuma(mx + bx, by);
+                    dcY = EncodeBlock(lumaDivisors, dcY, dcLuma, acLuma);
+                }
+            }
+
+            LoadChroma(mx, 1);
+            dcCb = EncodeBlock(chromaDivisors, dcCb, dcChroma, acChroma);
+
+            LoadChroma(mx, 2);
+            dcCr = EncodeBlock(chromaDivisors, dcCr, dcChroma, acChroma);
+        }
+    }
+
+    private void LoadLuma(int x0, int y0)
+    {
+        int rowBytes = paddedWidth * 3;
+
+        for (int y = 0; y < 8; y++)
+        {
+            int p = (y0 + y) * rowBytes + x0 * 3;
+            for (int x = 0; x < 8; x++, p += 3)
+            {
+                block[y * 8 + x] = 0.299f * rows[p] + 0.587f * rows[p + 1] + 0.114f * rows[p + 2] - 128f;
+            }
+        }
+    }
+
+    // channel 1: Cb, 2: Cr, each sample the average of 2x2 pixels
+    private void LoadChroma(int x0, int channel)
+    {
+        int rowBytes = paddedWidth * 3;
+
+        for (int y = 0; y < 8; y++)
+        {
+            for (int x = 0; x < 8; x++)
+            {
+                int p = y * 2 * rowBytes + (x0 + x * 2) * 3;
+                float r = rows[p] + rows[p + 3] + rows[p + rowBytes] + rows[p + rowBytes + 3];
+                float g = rows[p + 1] + rows[p + 4] + rows[p + rowBytes + 1] + rows[p + rowBytes + 4];
+                float b = rows[p + 2] + rows[p + 5] + rows[p + rowBytes + 2] + rows[p + rowBytes + 5];
+
+                block[y * 8 + x] = channel == 1
+                    ? (-0.168736f * r - 0.331264f * g + 0.5f * b) * 0.25f
+                    : (0.5f * r - 0.418688f * g - 0.081312f * b) * 0.25f;
+            }
+        }
+    }
+
+    // DCT, quantization and Huffman coding of block, returns its DC value for the next block of the component
+    private int EncodeBlock(float[] divisors, int previousDc, Huffman dc, Huffman ac)
+    {
+        ForwardDct(block);
+
+        for (int i = 0; i < 64; i++)
+        {
+            int n = naturalOrder[i];
+            float v = block[n] * divisors[n];
+            quantized[i] = (int)(v < 0 ? v - 0.5f : v + 0.5f);
+        }
+
+        int diff = quantized[0] - previousDc;
+        WriteValue(diff, dc, 0);
+
+        int run = 0;
+        for (int i = 1; i < 64; i++)
+        {
+            if (quantized[i] == 0)
+            {
+                run++;
+                continue;
+            }
+
+            while (run > 15)
+            {
+                WriteBits(ac.codes[0xF0], ac.sizes[0xF0]);
+                run -= 16;
+            }
+
+            WriteValue(quantized[i], ac, run << 4);
+            run = 0;
+        }
+
+        if (run > 0)
+        {
+            WriteBits(ac.codes[0x00], ac.sizes[0x00]);
+        }
+
+        return quantized[0];
+    }
+
+    // symbol (run in the high nibble, bit count in the low one) and the bits of value
+    private void WriteValue(int value, Huffman table, int run)
+    {
+        int magnitude = value < 0 ? -value : value;
+        int size = 0;
+        while (magnitude != 0)
+        {
+            size++;
+            magnitude >>= 1;
+        }
+
+        int symbol = run | size;
+        WriteBits(table.codes[symbol], table.sizes[symbol]);
+
+        if (size > 0)
+        {
+            if (value < 0) value--;
+            WriteBits(value & ((1 << size) - 1), size);
+        }
+    }
+
+    // float AAN forward DCT, rows then columns, output scaled by aanScale (divisors undo it)
+    private static void ForwardDct(float[] d)
+    {
+        for (int pass = 0; pass < 2; pass++)
+        {
+            int step = pass == 0 ? 1 : 8;
+            int next = pass == 0 ? 8 : 1;
+
+            for (int line = 0, o = 0; line < 8; line++, o += next)
+            {
+                float tmp0 = d[o] + d[o + 7 * step];
+                float tmp7 = d[o] - d[o + 7 * step];
+                float tmp1 = d[o + step] + d[o + 6 * step];
+                float tmp6 = d[o + step] - d[o + 6 * step];
+                float tmp2 = d[o + 2 * step] + d[o + 5 * step];
+                float tmp5 = d[o + 2 * step] - d[o + 5 * step];
+                float tmp3 = d[o + 3 * step] + d[o + 4 * step];
+                float tmp4 = d[o + 3 * step] - d[o + 4 * step];
+
+                float tmp10 = tmp0 + tmp3;
+                float tmp13 = tmp0 - tmp3;
+                float tmp11 = tmp1 + tmp2;
+                float tmp12 = tmp1 - tmp2;
+
+                d[o] = tmp10 + tmp11;
+                d[o + 4 * step] = tmp10 - tmp11;
+
+                float z1 = (tmp12 + tmp13) * 0.707106781f;
+                d[o + 2 * step] = tmp13 + z1;
+                d[o + 6 * step] = tmp13 - z1;
+
+                tmp10 = tmp4 + tmp5;
+                tmp11 = tmp5 + tmp6;
+                tmp12 = tmp6 + tmp7;
+
+                float z5 = (tmp10 - tmp12) * 0.382683433f;
+                float z2 = 0.541196100f * tmp10 + z5;
+                float z4 = 1.306562965f * tmp12 + z5;
+                float z3 = tmp11 * 0.707106781f;
+
+                float z11 = tmp7 + z3;
+                float z13 = tmp7 - z3;
+
+                d[o + 5 * step] = z13 + z2;
+                d[o + 3 * step] = z13 - z2;
+                d[o + step] = z11 + z4;
+                d[o + 7 * step] = z11 - z4;
+            }
+        }
+    }
+
+    #endregion
+
+
+    #region Output
+
+    private void WriteBits(int bits, int count)
+    {
+        bitBuffer = (bitBuffer << count) | (bits & ((1 << count) - 1));
+        bitCount += count;
+
+        while (bitCount >= 8)
+        {
+            byte b = (byte)(bitBuffer >> (bitCount - 8));
+            bitCount -= 8;
+
+            Put(b);
+            if (b == 0xFF) Put(0);
+        }
+
+        bitBuffer &= (1 << bitCount) - 1;
+    }
+
+    private void Put(byte b)
+    {
+        outBuffer[outCount++] = b;
+        if (outCount == outBuffer.Length) FlushOutput();
+    }
+
+    private void FlushOutput()
+    {
+        output.Write(outBuffer, 0, outCount);
+        outCount = 0;
+    }
+
+    private void WriteHeaders()
+    {
+        // SOI, JFIF APP0
+        WriteBytes(0xFF, 0xD8);
+        WriteBytes(0xFF, 0xE0, 0, 16, (byte)'J', (byte)'F', (byte)'I', (byte)'F', 0, 1, 1, 0, 0, 1, 0, 1, 0, 0);
+
+        // DQT, both tables in zigzag order
+        WriteBytes(0xFF, 0xDB, 0, 132, 0);
+        for (int i = 0; i < 64; i++) output.WriteByte(lumaTable[naturalOrder[i]]);
+        output.WriteByte(1);
+        for (int i = 0; i < 64; i++) output.WriteByte(chromaTable[naturalOrder[i]]);
+
+        // SOF0: 8 bit, 3 components, Y sampled 2x2, Cb and Cr 1x1
+        WriteBytes(0xFF, 0xC0, 0, 17, 8, (byte)(height >> 8), (byte)height, (byte)(width >> 8), (byte)width, 3,
+            1, 0x22, 0, 2, 0x11, 1, 3, 0x11, 1);
+
+        WriteHuffmanTable(0x00, dcLumaBits, dcValues);
+        WriteHuffmanTable(0x10, acLumaBits, acLumaValues);
+        WriteHuffmanTable(0x01, dcChromaBits, dcValues);
+        WriteHuffmanTable(0x11, acChromaBits, acChromaValues);
+
+        // SOS
+        WriteBytes(0xFF, 0xDA, 0, 12, 3, 1, 0x00, 2, 0x11, 3, 0x11, 0, 63, 0);
+    }
+
+    private void WriteHuffmanTable(byte classAndId, byte[] bits, byte[] values)
+    {
+        int length = 2 + 1 + 16 + values.Length;
+        WriteBytes(0xFF, 0xC4, (byte)(length >> 8), (byte)length, classAndId);
+        output.Write(bits, 0, 16);
+        output.Write(values, 0, values.Length);
+    }
+
+    private void WriteBytes(params byte[] bytes)
+    {
+        output.Write(bytes, 0, bytes.Length);
+    }
+
+    #endregion
+}
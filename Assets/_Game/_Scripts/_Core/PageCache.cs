@@ -0,0 +1,123 @@
+﻿using System.Collections.Generic;
+
+// The last opened pages, kept decoded with their mask pixels, so opening one of them again skips the Base64 decode,
+// CanvasPageEncoder and reading the mask. The least recently stored page goes first, by count and by bytes.
+// A page in the cache owns its canvas: evicting it gives the tiles back to the pool.
+public class PageCache
+{
+    public class Page
+    {
+        public string id;
+        public int maskIndex; // -1 on free paint pages
+        public TiledCanvas canvas;
+        public byte[] maskPixels; // null on free paint pages
+
+        public long Bytes
+        {
+            get { return canvas.AllocatedBytes + (maskPixels != null ? maskPixels.Length : 0); }
+        }
+    }
+
+    public int capacity; // pages kept
+    public long maxBytes; // memory the kept pages may use
+
+    private List<Page> pages = new List<Page>(); // oldest first
+
+    public PageCache(int capacity, long maxBytes)
+    {
+        this.capacity = capacity;
+        this.maxBytes = maxBytes;
+    }
+
+    public int Count
+    {
+        get { return pages.Count; }
+    }
+
+    public long Bytes
+    {
+        get
+        {
+            long bytes = 0;
+            for (int i = 0; i < pages.Count; i++)
+            {
+                bytes += pages[i].Bytes;
+            }
+            return bytes;
+        }
+    }
+
+    // the cache owns canvas from here on, an older copy of the same page is dropped
+    public void Put(string id, int maskIndex, TiledCanvas canvas, byte[] maskPixels)
+    {
+        Remove(id);
+
+        Page page = new Page();
+        page.id = id;
+        page.maskIndex = maskIndex;
+        page.canvas = canvas;
+        page.maskPixels = maskPixels;
+        pages.Add(page);
+
+        TrimTo(capacity, maxBytes);
+    }
+
+    public bool Contains(string id)
+    {
+        return IndexOf(id) >= 0;
+    }
+
+    // removes the page and hands it over, null if it is not cached
+    public Page Take(string id)
+    {
+        int index = IndexOf(id);
+        if (index < 0) return null;
+
+        Page page = pages[index];
+        pages.RemoveAt(index);
+        return page;
+    }
+
+    // for pages changed outside the paint scene (e.g. a restored backup)
+    public void Remove(string id)
+    {
+        int index = IndexOf(id);
+        if (index < 0) return;
+
+        pages[index].canvas.Release();
+        pages.RemoveAt(index);
+    }
+
+    // drops the oldest pages until at most count pages using at most bytes are left, returns the bytes released
+    public long TrimTo(int count, long bytes)
+    {
+        long released = 0;
+        long kept = Bytes;
+
+        while (pages.Count > 0 && (pages.Count > count || kept > bytes))
+        {
+            long pageBytes = pages[0].Bytes;
+            pages[0].canvas.Release();
+            pages.RemoveAt(0);
+
+            released += pageBytes;
+            kept -= pageBytes;
+        }
+
+        return released;
+    }
+
+    public long Clear()
+    {
+        return TrimTo(0, 0);
+    }
+
+    private int IndexOf(string id)
+    {
+        for (int i = 0; i < pages.Count; i++)
+        {
+            if (pages[i].id == id) return i;
+        }
+        return -1;
+    }
+}
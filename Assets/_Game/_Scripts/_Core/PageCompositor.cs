@@ -0,0 +1,147 @@
+﻿// Flattens a page for export: the canvas with the outline image of mask pages drawn over it by its alpha, like
+// the board shows it (without the soft edge the board shader gives the outline), and the watermark on top.
+// Rows are RGBA32 with alpha 255, bottom row first like Texture2D data, so they can go to ImageConversion as they are.
+// Print exports scale the page up (CompositeScaledRows): painted regions keep their hard edges, the outline is
+// filtered so it stays smooth.
+public static class PageCompositor
+{
+    // rows [y0, y0 + rows) of the page to dst, width * 4 bytes each, maskPixels null on free paint pages,
+    // watermark may be null
+    public static void CompositeRows(TiledCanvas canvas, byte[] maskPixels, Watermark watermark, int y0, int rows, byte[] dst)
+    {
+        int rowBytes = canvas.width * 4;
+
+        for (int row = 0; row < rows; row++)
+        {
+            int offset = row * rowBytes;
+            canvas.ReadRow(y0 + row, dst, offset);
+
+            if (maskPixels != null)
+            {
+                BlendRow(maskPixels, (y0 + row) * rowBytes, dst, offset, rowBytes);
+            }
+            else
+            {
+                for (int i = offset + 3; i < offset + rowBytes; i += 4)
+                {
+                    dst[i] = 255;
+                }
+            }
+        }
+
+        if (watermark != null)
+        {
+            watermark.BlendRows(canvas.width, canvas.height, y0, rows, dst);
+        }
+    }
+
+    // rows [y0, y0 + rows) of the page scaled up by scale, width * scale * 4 bytes each. Canvas pixels are repeated,
+    // the outline is sampled bilinearly (premultiplied), so the region borders of the canvas, which follow the outline,
+    // end up under a smooth line instead of showing their steps.
+    public static void CompositeScaledRows(TiledCanvas canvas, byte[] maskPixels, Watermark watermark, int scale, int y0, int rows, byte[] dst)
+    {
+        if (scale == 1)
+        {
+            CompositeRows(canvas, maskPixels, watermark, y0, rows, dst);
+            return;
+        }
+
+        int width = canvas.width;
+        int height = canvas.height;
+        int outWidth = width * scale;
+        byte[] source = BufferPool<byte>.Rent(width * 4);
+        int sourceRow = -1;
+
+        for (int row = 0; row < rows; row++)
+        {
+            int y = y0 + row;
+            int offset = row * outWidth * 4;
+
+            if (y / scale != sourceRow)
+            {
+                sourceRow = y / scale;
+                canvas.ReadRow(sourceRow, source, 0);
+            }
+
+            for (int x = 0, d = offset; x < outWidth; x++, d += 4)
+            {
+                int s = (x / scale) * 4;
+                dst[d] = source[s];
+                dst[d + 1] = source[s + 1];
+                dst[d + 2] = source[s + 2];
+                dst[d + 3] = 255;
+            }
+
+            if (maskPixels != null)
+            {
+                BlendScaledMaskRow(maskPixels, width, height, scale, y, dst, offset);
+            }
+        }
+
+        BufferPool<byte>.Return(source);
+
+        if (watermark != null)
+        {
+            watermark.BlendRows(outWidth, height * scale, y0, rows, dst);
+        }
+    }
+
+    private static void BlendScaledMaskRow(byte[] mask, int width, int height, int scale, int y, byte[] dst, int offset)
+    {
+        float sy = System.Math.Max(0f, (y + 0.5f) / scale - 0.5f);
+        int my0 = System.Math.Min((int)sy, height - 1);
+        int my1 = System.Math.Min(my0 + 1, height - 1);
+        float fy = System.Math.Min(1f, sy - my0);
+        int row0 = my0 * width * 4;
+        int row1 = my1 * width * 4;
+
+        for (int x = 0, d = offset; x < width * scale; x++, d += 4)
+        {
+            float sx = System.Math.Max(0f, (x + 0.5f) / scale - 0.5f);
+            int mx0 = System.Math.Min((int)sx, width - 1);
+            int mx1 = System.Math.Min(mx0 + 1, width - 1);
+            float fx = System.Math.Min(1f, sx - mx0);
+
+            int p00 = row0 + mx0 * 4;
+            int p10 = row0 + mx1 * 4;
+            int p01 = row1 + mx0 * 4;
+            int p11 = row1 + mx1 * 4;
+
+            // most of the page is away from the outline
+            if ((mask[p00 + 3] | mask[p10 + 3] | mask[p01 + 3] | mask[p11 + 3]) == 0) continue;
+
+            float w00 = (1 - fx) * (1 - fy) * mask[p00 + 3];
+            float w10 = fx * (1 - fy) * mask[p10 + 3];
+            float w01 = (1 - fx) * fy * mask[p01 + 3];
+            float w11 = fx * fy * mask[p11 + 3];
+            float inv = 1f - (w00 + w10 + w01 + w11) / 255f;
+
+            for (int c = 0; c < 3; c++)
+            {
+                float premultiplied = (mask[p00 + c] * w00 + mask[p10 + c] * w10 + mask[p01 + c] * w01 + mask[p11 + c] * w11) / 255f;
+                dst[d + c] = (byte)(premultiplied + dst[d + c] * inv + 0.5f);
+            }
+        }
+    }
+
+    // src over dst by the alpha of src, for count bytes of RGBA pixels
+    public static void BlendRow(byte[] src, int srcOffset, byte[] dst, int dstOffset, int count)
+    {
+        for (int i = 0; i < count; i += 4)
+        {
+            int s = srcOffset + i;
+            int d = dstOffset + i;
+            int a = src[s + 3];
+
+            if (a != 0)
+            {
+                int inv = 255 - a;
+                dst[d] = (byte)((src[s] * a + dst[d] * inv + 127) / 255);
+                dst[d + 1] = (byte)((src[s + 1] * a + dst[d + 1] * inv + 127) / 255);
+                dst[d + 2] = (byte)((src[s + 2] * a + dst[d + 2] * inv + 127) / 255);
+            }
+
+            dst[d + 3] = 255;
+        }
+    }
+}
@@ -0,0 +1,67 @@
+﻿using System.IO;
+
+// Writes a page as PNG or baseline JPEG straight to a stream, band by band from the top: each band of BandRows
+// rows is composited (PageCompositor, scaled up for print) and handed to the row writer, which compresses and
+// writes it before the next band is made. Memory stays at one band and the writer's rows whatever the output
+// size, a 4x export of a 576x1024 page never holds its 2304x4096 frame. Runs on any thread, on a copy of the page.
+public static class PageImageWriter
+{
+    public enum Format
+    {
+        Jpg,
+        Png
+    }
+
+    public const int BandRows = 16;
+
+    // maskPixels and watermark may be null, scale 1 is page resolution
+    public static void Write(TiledCanvas canvas, byte[] maskPixels, Watermark watermark, int scale, Format format, int jpgQuality, Stream output)
+    {
+        int width = canvas.width * scale;
+        int height = canvas.height * scale;
+        int rowBytes = width * 4;
+
+        PngRowWriter png = null;
+        JpegRowWriter jpg = null;
+        if (format == Format.Png)
+        {
+            png = new PngRowWriter(output, width, height);
+        }
+        else
+        {
+            jpg = new JpegRowWriter(output, width, height, jpgQuality);
+        }
+
+        byte[] band = BufferPool<byte>.Rent(rowBytes * BandRows);
+
+        // composited rows are bottom first, the image files want the top row first
+        for (int top = 0; top < height; top += BandRows)
+        {
+            int rows = System.Math.Min(BandRows, height - top);
+            PageCompositor.CompositeScaledRows(canvas, maskPixels, watermark, scale, height - top - rows, rows, band);
+
+            for (int row = rows - 1; row >= 0; row--)
+            {
+                if (png != null)
+                {
+                    png.WriteRow(band, row * rowBytes);
+                }
+                else
+                {
+                    jpg.WriteRow(band, row * rowBytes);
+                }
+            }
+        }
+
+        BufferPool<byte>.Return(band);
+
+        if (png != null)
+        {
+            png.Finish();
+        }
+        else
+        {
+            jpg.Finish();
+        }
+    }
+}
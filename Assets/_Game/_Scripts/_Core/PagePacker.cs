@@ -0,0 +1,97 @@
+﻿using System.IO;
+using ICSharpCode.SharpZipLib;
+using ICSharpCode.SharpZipLib.Zip.Compression;
+
+// A saved page as PageStore keeps it in a WebGL file: the length of the CanvasPageEncoder data (int, little
+// endian), then the data deflated with a zlib header (managed SharpZipLib, no native zlib needed in the browser).
+public static class PagePacker
+{
+    private const int MaxPageBytes = 1 << 26; // a 4096x4096 RGBA page with its tile headers is well below
+    private const int MaxRatio = 1032; // deflate never packs more than this many bytes into one
+
+
+    #region Pack
+
+    // the first length bytes of data; speed over size, WebGL compresses on the main thread
+    public static byte[] Pack(byte[] data, int length)
+    {
+        using (TraceLog.Auto("PagePacker.Pack"))
+        {
+            Deflater deflater = new Deflater(Deflater.BEST_SPEED);
+            deflater.SetInput(data, 0, length);
+            deflater.Finish();
+
+            byte[] chunk = BufferPool<byte>.Rent(1 << 16);
+            using (MemoryStream stream = new MemoryStream(length / 8 + 64))
+            {
+                stream.WriteByte((byte)length);
+                stream.WriteByte((byte)(length >> 8));
+                stream.WriteByte((byte)(length >> 16));
+                stream.WriteByte((byte)(length >> 24));
+
+                while (!deflater.IsFinished)
+                {
+                    int n = deflater.Deflate(chunk, 0, chunk.Length);
+                    stream.Write(chunk, 0, n);
+                }
+
+                BufferPool<byte>.Return(chunk);
+                return stream.ToArray();
+            }
+        }
+    }
+
+    #endregion
+
+
+    #region Unpack
+
+    // the data in a pooled buffer, null if packed is broken, ends early or holds more or less than its length says
+    public static byte[] Unpack(byte[] packed, out int length)
+    {
+        using (TraceLog.Auto("PagePacker.Unpack"))
+        {
+            length = 0;
+            if (packed == null || packed.Length < 4) return null;
+
+            int size = packed[0] | packed[1] << 8 | packed[2] << 16 | packed[3] << 24;
+
+            // a damaged length must not rent more than the file can hold
+            if (size < 0 || size > MaxPageBytes || size > (packed.Length - 4L) * MaxRatio) return null;
+
+            byte[] data = BufferPool<byte>.Rent(size);
+            Inflater inflater = new Inflater();
+            inflater.SetInput(packed, 4, packed.Length - 4);
+
+            try
+            {
+                while (length < size)
+                {
+                    int n = inflater.Inflate(data, length, size - length);
+                    if (n == 0) break; // ended early or needs input it does not have
+                    length += n;
+                }
+
+                // the stream has to end with size: one more byte or no end means the length is wrong
+                if (length == size)
+                {
+                    byte[] probe = BufferPool<byte>.Rent(1);
+                    if (inflater.Inflate(probe, 0, 1) != 0 || !inflater.IsFinished) length = -1;
+                    BufferPool<byte>.Return(probe);
+                }
+            }
+            catch (SharpZipBaseException)
+            {
+                length = -1;
+            }
+
+            if (length == size) return data;
+
+            BufferPool<byte>.Return(data);
+            length = 0;
+            return null;
+        }
+    }
+
+    #endregion
+}
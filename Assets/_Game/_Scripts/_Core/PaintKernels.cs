@@ -0,0 +1,404 @@
+﻿using System;
+using System.Collections.Generic;
+using System.Runtime.InteropServices;
+
+// Inner loops of painting: span fill, marker blend, sticker blit, brush stamp and region labelling.
+// The managed loops always work, EnableNative switches to the coloringcore library (Native/coloringcore,
+// SSE2/AVX2/NEON picked per CPU) when it is built for the platform. Both write exactly the same bytes.
+public static class PaintKernels
+{
+#if UNITY_IOS && !UNITY_EDITOR
+    private const string Library = "__Internal"; // linked statically into the player
+#else
+    private const string Library = "coloringcore";
+#endif
+    private const int NativeVersion = 1;
+
+    private static bool native = false;
+    private static string backend = "managed";
+
+    public static bool Native
+    {
+        get { return native; }
+    }
+
+    public static string Backend
+    {
+        get { return backend; }
+    }
+
+    // returns false, and keeps the managed loops, when the library is missing or has another version
+    public static bool EnableNative()
+    {
+#if UNITY_WEBGL
+        return false;
+#else
+        try
+        {
+            if (cc_version() != NativeVersion) return false;
+
+            backend = Marshal.PtrToStringAnsi(cc_backend());
+            native = true;
+            return true;
+        }
+        catch (DllNotFoundException)
+        {
+            return false;
+        }
+        catch (EntryPointNotFoundException)
+        {
+            return false;
+        }
+#endif
+    }
+
+    public static void DisableNative()
+    {
+        native = false;
+        backend = "managed";
+    }
+
+    public static uint PackColor(byte r, byte g, byte b, byte a)
+    {
+        return (uint)(r | (g << 8) | (b << 16) | (a << 24));
+    }
+
+
+    #region Spans
+
+    // count RGBA pixels from byte offset, mask (can be null) is read from maskOffset, only pixels set to 1 are written
+    public static void FillRgba(byte[] dst, int offset, int count, byte r, byte g, byte b, byte a, byte[] mask, int maskOffset)
+    {
+        if (count <= 0) return;
+
+        if (native)
+        {
+            if (mask == null)
+            {
+                cc_fill_span_rgba(ref dst[offset], count, PackColor(r, g, b, a), IntPtr.Zero);
+            }
+            else
+            {
+                cc_fill_span_rgba(ref dst[offset], count, PackColor(r, g, b, a), ref mask[maskOffset]);
+            }
+            return;
+        }
+
+        for (int i = 0, o = offset; i < count; i++, o += 4)
+        {
+            if (mask != null && mask[maskOffset + i] != 1) continue;
+
+            dst[o] = r;
+            dst[o + 1] = g;
+            dst[o + 2] = b;
+            dst[o + 3] = a;
+        }
+    }
+
+    // count palette index bytes
+    public static void FillIndex(byte[] dst, int offset, int count, byte index, byte[] mask, int maskOffset)
+    {
+        if (count <= 0) return;
+
+        if (native)
+        {
+            if (mask == null)
+            {
+                cc_fill_span_index(ref dst[offset], count, index, IntPtr.Zero);
+            }
+            else
+            {
+                cc_fill_span_index(ref dst[offset], count, index, ref mask[maskOffset]);
+            }
+            return;
+        }
+
+        for (int i = 0; i < count; i++)
+        {
+            if (mask != null && mask[maskOffset + i] != 1) continue;
+
+            dst[offset + i] = index;
+        }
+    }
+
+    // marker: every channel moves towards the color by t (alpha by tAlpha), truncated
+    public static void BlendRgba(byte[] dst, int offset, int count, byte r, byte g, byte b, byte a, float t, float tAlpha, byte[] mask, int maskOffset)
+    {
+        if (count <= 0) return;
+
+        if (native)
+        {
+            if (mask == null)
+            {
+                cc_blend_span_rgba(ref dst[offset], count, PackColor(r, g, b, a), t, tAlpha, IntPtr.Zero);
+            }
+            else
+            {
+                cc_blend_span_rgba(ref dst[offset], count, PackColor(r, g, b, a), t, tAlpha, ref mask[maskOffset]);
+            }
+            return;
+        }
+
+        for (int i = 0, o = offset; i < count; i++, o += 4)
+        {
+            if (mask != null && mask[maskOffset + i] != 1) continue;
+
+            dst[o] = (byte)(dst[o] + (r - dst[o]) * t);
+            dst[o + 1] = (byte)(dst[o + 1] + (g - dst[o + 1]) * t);
+            dst[o + 2] = (byte)(dst[o + 2] + (b - dst[o + 2]) * t);
+            dst[o + 3] = (byte)(dst[o + 3] + (a - dst[o + 3]) * tAlpha);
+        }
+    }
+
+    // sticker: copies count RGBA pixels, transparent source pixels are skipped
+    public static void BlitRgba(byte[] dst, int offset, byte[] src, int srcOffset, int count)
+    {
+        if (count <= 0) return;
+
+        if (native)
+        {
+            cc_blit_span_rgba(ref dst[offset], ref src[srcOffset], count);
+            return;
+        }
+
+        for (int i = 0; i < count; i++, offset += 4, srcOffset += 4)
+        {
+            if (src[srcOffset + 3] == 0) continue;
+
+            dst[offset] = src[srcOffset];
+            dst[offset + 1] = src[srcOffset + 1];
+            dst[offset + 2] = src[srcOffset + 2];
+            dst[offset + 3] = src[srcOffset + 3];
+        }
+    }
+
+    #endregion
+
+
+    #region Brush
+
+    // brush stamp into one tile (tileSize x tileSize at page pixel originX, originY): every page pixel with
+    // (x - cx)^2 + (y - cy)^2 < radius^2 gets value, a packed color for RGBA tiles or the palette index for indexed ones.
+    // returns the pixels painted, with tile null only counts them
+    public static int StampCircle(byte[] tile, int tileSize, int originX, int originY, int cx, int cy, int radius, uint value, byte[] mask, int width, int height)
+    {
+        int bpp = tile != null && tile.Length == tileSize * tileSize ? 1 : 4;
+
+        if (native)
+        {
+            return cc_stamp_circle(tile, tileSize, bpp, value, originX, originY, cx, cy, radius, mask, width, height);
+        }
+
+        if (radius <= 0) return 0;
+
+        int r2 = radius * radius;
+        int y0 = Math.Max(Math.Max(cy - radius + 1, originY), 0);
+        int y1 = Math.Min(Math.Min(cy + radius, originY + tileSize), height);
+
+        int painted = 0;
+
+        for (int y = y0; y < y1; y++)
+        {
+            int dy = y - cy;
+            int half = HalfWidth(r2 - dy * dy);
+
+            int x0 = Math.Max(Math.Max(cx - half, originX), 0);
+            int x1 = Math.Min(Math.Min(cx + half + 1, originX + tileSize), width);
+            int maskRow = y * width;
+
+            if (x0 >= x1) continue;
+
+            if (tile == null && mask == null)
+            {
+                painted += x1 - x0;
+                continue;
+            }
+
+            for (int x = x0; x < x1; x++)
+            {
+                if (mask != null && mask[maskRow + x] != 1) continue;
+
+                painted++;
+                if (tile == null) continue;
+
+                int pixel = (y - originY) * tileSize + x - originX;
+
+                if (bpp == 1)
+                {
+                    tile[pixel] = (byte)value;
+                }
+                else
+                {
+                    pixel <<= 2;
+                    tile[pixel] = (byte)value;
+                    tile[pixel + 1] = (byte)(value >> 8);
+                    tile[pixel + 2] = (byte)(value >> 16);
+                    tile[pixel + 3] = (byte)(value >> 24);
+                }
+            }
+        }
+
+        return painted;
+    }
+
+    // largest d with d * d < limit
+    public static int HalfWidth(int limit)
+    {
+        int d = (int)Math.Sqrt(limit);
+        while (d > 0 && d * d >= limit) d--;
+        while ((d + 1) * (d + 1) < limit) d++;
+        return d;
+    }
+
+    #endregion
+
+
+    #region Regions
+
+    // 4-connected region around (x, y) of pixels whose channels all differ from the seed pixel by at most threshold.
+    // region (width * height) is set to 1 inside and 0 outside, the seed alone (no matching neighbour) is not a region.
+    // bounds (can be null) gets x0, y0, x1, y1 of the region (exclusive), returns the region pixel count
+    public static int LabelRegion(byte[] rgba, int width, int height, int x, int y, int threshold, byte[] region, int[] bounds)
+    {
+        if (native)
+        {
+            return cc_label_region(rgba, width, height, x, y, threshold, region, bounds);
+        }
+
+        Array.Clear(region, 0, width * height);
+
+        if (bounds != null)
+        {
+            bounds[0] = bounds[1] = bounds[2] = bounds[3] = 0;
+        }
+
+        if (x < 0 || y < 0 || x >= width || y >= height) return 0;
+
+        int seed = (y * width + x) * 4;
+        byte seedR = rgba[seed];
+        byte seedG = rgba[seed + 1];
+        byte seedB = rgba[seed + 2];
+        byte seedA = rgba[seed + 3];
+
+        int minX = x, minY = y, maxX = x, maxY = y;
+        int count = 0;
+
+        // scanline fill, one stack entry per run of matching pixels, the stack comes from the pool
+        int[] stack = BufferPool<int>.Rent(256);
+        int top = 0;
+        stack[top++] = y * width + x;
+
+        while (top > 0)
+        {
+            int pixel = stack[--top];
+            if (region[pixel] != 0) continue;
+
+            int py = pixel / width;
+            int row = py * width;
+
+            int left = pixel - row;
+            int right = left;
+            while (left > 0 && region[row + left - 1] == 0 && Matches(rgba, row + left - 1, seedR, seedG, seedB, seedA, threshold)) left--;
+            while (right + 1 < width && region[row + right + 1] == 0 && Matches(rgba, row + right + 1, seedR, seedG, seedB, seedA, threshold)) right++;
+
+            for (int i = left; i <= right; i++)
+            {
+                region[row + i] = 1;
+            }
+            count += right - left + 1;
+
+            if (left < minX) minX = left;
+            if (right > maxX) maxX = right;
+            if (py < minY) minY = py;
+            if (py > maxY) maxY = py;
+
+            for (int ny = py - 1; ny <= py + 1; ny += 2)
+            {
+                if (ny < 0 || ny >= height) continue;
+
+                int next = ny * width;
+                bool inRun = false;
+
+                for (int nx = left; nx <= right; nx++)
+                {
+                    bool candidate = region[next + nx] == 0 && Matches(rgba, next + nx, seedR, seedG, seedB, seedA, threshold);
+
+                    if (candidate && !inRun)
+                    {
+                        if (top == stack.Length) stack = BufferPool<int>.Grow(stack, top);
+                        stack[top++] = next + nx;
+                    }
+                    inRun = candidate;
+                }
+            }
+        }
+
+        BufferPool<int>.Return(stack);
+
+        // the seed only counts when a neighbour matches it
+        if (count == 1)
+        {
+            region[y * width + x] = 0;
+            return 0;
+        }
+
+        if (bounds != null)
+        {
+            bounds[0] = minX;
+            bounds[1] = minY;
+            bounds[2] = maxX + 1;
+            bounds[3] = maxY + 1;
+        }
+
+        return count;
+    }
+
+    private static bool Matches(byte[] rgba, int pixel, byte r, byte g, byte b, byte a, int threshold)
+    {
+        int offset = pixel * 4;
+        return Math.Abs(rgba[offset] - r) <= threshold
+            && Math.Abs(rgba[offset + 1] - g) <= threshold
+            && Math.Abs(rgba[offset + 2] - b) <= threshold
+            && Math.Abs(rgba[offset + 3] - a) <= threshold;
+    }
+
+    #endregion
+
+
+    #region Native
+
+    [DllImport(Library)]
+    private static extern int cc_version();
+
+    [DllImport(Library)]
+    private static extern IntPtr cc_backend();
+
+    [DllImport(Library)]
+    private static extern void cc_fill_span_rgba(ref byte dst, int count, uint rgba, ref byte mask);
+
+    [DllImport(Library)]
+    private static extern void cc_fill_span_rgba(ref byte dst, int count, uint rgba, IntPtr mask);
+
+    [DllImport(Library)]
+    private static extern void cc_fill_span_index(ref byte dst, int count, byte index, ref byte mask);
+
+    [DllImport(Library)]
+    private static extern void cc_fill_span_index(ref byte dst, int count, byte index, IntPtr mask);
+
+    [DllImport(Library)]
+    private static extern void cc_blend_span_rgba(ref byte dst, int count, uint rgba, float t, float tAlpha, ref byte mask);
+
+    [DllImport(Library)]
+    private static extern void cc_blend_span_rgba(ref byte dst, int count, uint rgba, float t, float tAlpha, IntPtr mask);
+
+    [DllImport(Library)]
+    private static extern void cc_blit_span_rgba(ref byte dst, ref byte src, int count);
+
+    [DllImport(Library)]
+    private static extern int cc_stamp_circle([In, Out] byte[] tile, int tileSize, int bpp, uint value, int originX, int originY, int cx, int cy, int radius, byte[] mask, int width, int height);
+
+    [DllImport(Library)]
+    private static extern int cc_label_region(byte[] rgba, int width, int height, int x, int y, int threshold, [In, Out] byte[] region, [In, Out] int[] bounds);
+
+    #endregion
+}
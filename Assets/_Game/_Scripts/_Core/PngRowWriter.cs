@@ -0,0 +1,269 @@
+﻿using System.IO;
+using ICSharpCode.SharpZipLib.Zip.Compression;
+using ICSharpCode.SharpZipLib.Zip.Compression.Streams;
+
+// Streams an 8 bit RGB PNG to a stream one row at a time, top row first. Each row gets the PNG filter that
+// leaves it the smallest values (None, Sub, Up or Paeth) and goes through deflate into IDAT chunks of ChunkSize,
+// so whatever the image size, memory stays at two rows, one chunk and the deflate window. Deflate is managed
+// SharpZipLib like PageStore's, WebGL has no native zlib for System.IO.Compression.
+public class PngRowWriter
+{
+    private const int ChunkSize = 1 << 16;
+
+    private static readonly uint[] crcTable = CreateCrcTable();
+
+    private readonly Stream output;
+    private readonly int height;
+    private readonly int rowBytes;
+
+    private byte[] row; // RGB of the row being written
+    private byte[] previous; // RGB of the row above, zero above the first
+    private byte[] filtered; // filter type byte and the filtered row
+    private int rowsWritten = 0;
+
+    private readonly IdatStream idat;
+    private readonly DeflaterOutputStream deflate;
+
+    // level 0 (stored) to 9 (smallest)
+    public PngRowWriter(Stream output, int width, int height, int level = Deflater.DEFAULT_COMPRESSION)
+    {
+        this.output = output;
+        this.height = height;
+        rowBytes = width * 3;
+
+        row = BufferPool<byte>.Rent(rowBytes);
+        previous = BufferPool<byte>.Rent(rowBytes);
+        filtered = BufferPool<byte>.Rent(rowBytes + 1);
+        System.Array.Clear(previous, 0, rowBytes);
+
+        output.Write(new byte[] { 137, 80, 78, 71, 13, 10, 26, 10 }, 0, 8);
+
+        byte[] header = new byte[13];
+        WriteInt(header, 0, width);
+        WriteInt(header, 4, height);
+        header[8] = 8; // bits per channel
+        header[9] = 2; // RGB
+        WriteChunk(output, "IHDR", header, 13);
+
+        // a zlib stream, the deflater writes its header and Adler-32
+        idat = new IdatStream(output);
+        deflate = new DeflaterOutputStream(idat, new Deflater(level), 1 << 14);
+        deflate.IsStreamOwner = false;
+    }
+
+    // the next row from the top, width RGBA pixels (alpha is dropped) at offset
+    public void WriteRow(byte[] rgba, int offset)
+    {
+        if (rowsWritten == height) throw new System.InvalidOperationException("all " + height + " rows are written");
+
+        for (int x = 0, s = offset; x < rowBytes; x += 3, s += 4)
+        {
+            row[x] = rgba[s];
+            row[x + 1] = rgba[s + 1];
+            row[x + 2] = rgba[s + 2];
+        }
+
+        int filter = ChooseFilter();
+        Filter(filter);
+
+        deflate.Write(filtered, 0, rowBytes + 1);
+
+        byte[] swap = previous;
+        previous = row;
+        row = swap;
+        rowsWritten++;
+    }
+
+    // ends the image, the stream stays open
+    public void Finish()
+    {
+        if (rowsWritten != height) throw new System.InvalidOperationException(rowsWritten + " of " + height + " rows written");
+
+        deflate.Finish();
+        idat.Flush();
+
+        WriteChunk(output, "IEND", new byte[0], 0);
+
+        BufferPool<byte>.Return(row);
+        BufferPool<byte>.Return(previous);
+        BufferPool<byte>.Return(filtered);
+        row = previous = filtered = null;
+    }
+
+
+    #region Filters
+
+    // the usual heuristic: the filter whose output has the smallest sum of absolute (signed) values
+    private int ChooseFilter()
+    {
+        long none = 0, sub = 0, up = 0, paeth = 0;
+
+        for (int i = 0; i < rowBytes; i++)
+        {
+            int a = i >= 3 ? row[i - 3] : 0;
+            int b = previous[i];
+            int c = i >= 3 ? previous[i - 3] : 0;
+            int x = row[i];
+
+            none += Cost(x);
+            sub += Cost(x - a);
+            up += Cost(x - b);
+            paeth += Cost(x - Paeth(a, b, c));
+        }
+
+        int filter = 0;
+        long best = none;
+        if (sub < best) { best = sub; filter = 1; }
+        if (up < best) { best = up; filter = 2; }
+        if (paeth < best) { filter = 4; }
+        return filter;
+    }
+
+    private void Filter(int filter)
+    {
+        filtered[0] = (byte)filter;
+
+        for (int i = 0; i < rowBytes; i++)
+        {
+            int a = i >= 3 ? row[i - 3] : 0;
+            int b = previous[i];
+            int c = i >= 3 ? previous[i - 3] : 0;
+            int x = row[i];
+
+            switch (filter)
+            {
+                case 1: x -= a; break;
+                case 2: x -= b; break;
+                case 4: x -= Paeth(a, b, c); break;
+            }
+
+            filtered[i + 1] = (byte)x;
+        }
+    }
+
+    private static int Cost(int value)
+    {
+        int signed = (sbyte)(byte)value;
+        return signed < 0 ? -signed : signed;
+    }
+
+    private static int Paeth(int a, int b, int c)
+    {
+        int p = a + b - c;
+        int pa = System.Math.Abs(p - a);
+        int pb = System.Math.Abs(p - b);
+        int pc = System.Math.Abs(p - c);
+
+        if (pa <= pb && pa <= pc) return a;
+        if (pb <= pc) return b;
+        return c;
+    }
+
+    #endregion
+
+
+    #region Chunks
+
+    // collects the zlib stream and writes it out as IDAT chunks
+    private class IdatStream : Stream
+    {
+        private readonly Stream output;
+        private readonly byte[] buffer = new byte[ChunkSize];
+        private int count = 0;
+
+        public IdatStream(Stream output)
+        {
+            this.output = output;
+        }
+
+        public override void Write(byte[] data, int offset, int length)
+        {
+            while (length > 0)
+            {
+                int n = System.Math.Min(length, ChunkSize - count);
+                System.Buffer.BlockCopy(data, offset, buffer, count, n);
+                count += n;
+                offset += n;
+                length -= n;
+
+                if (count == ChunkSize) Flush();
+            }
+        }
+
+        public override void WriteByte(byte value)
+        {
+            buffer[count++] = value;
+            if (count == ChunkSize) Flush();
+        }
+
+        public override void Flush()
+        {
+            if (count == 0) return;
+
+            WriteChunk(output, "IDAT", buffer, count);
+            count = 0;
+        }
+
+        public override bool CanRead { get { return false; } }
+        public override bool CanSeek { get { return false; } }
+        public override bool CanWrite { get { return true; } }
+        public override long Length { get { throw new System.NotSupportedException(); } }
+        public override long Position { get { throw new System.NotSupportedException(); } set { throw new System.NotSupportedException(); } }
+        public override int Read(byte[] data, int offset, int length) { throw new System.NotSupportedException(); }
+        public override long Seek(long offset, SeekOrigin origin) { throw new System.NotSupportedException(); }
+        public override void SetLength(long value) { throw new System.NotSupportedException(); }
+    }
+
+    private static void WriteChunk(Stream output, string type, byte[] data, int count)
+    {
+        byte[] header = new byte[8];
+        WriteInt(header, 0, count);
+        for (int i = 0; i < 4; i++)
+        {
+            header[4 + i] = (byte)type[i];
+        }
+        output.Write(header, 0, 8);
+        output.Write(data, 0, count);
+
+        uint crc = Crc(0xFFFFFFFF, header, 4, 4);
+        crc = Crc(crc, data, 0, count) ^ 0xFFFFFFFF;
+
+        byte[] footer = new byte[4];
+        WriteInt(footer, 0, (int)crc);
+        output.Write(footer, 0, 4);
+    }
+
+    private static void WriteInt(byte[] dst, int offset, int value)
+    {
+        dst[offset] = (byte)(value >> 24);
+        dst[offset + 1] = (byte)(value >> 16);
+        dst[offset + 2] = (byte)(value >> 8);
+        dst[offset + 3] = (byte)value;
+    }
+
+    private static uint[] CreateCrcTable()
+    {
+        uint[] table = new uint[256];
+        for (uint n = 0; n < 256; n++)
+        {
+            uint c = n;
+            for (int k = 0; k < 8; k++)
+            {
+                c = (c & 1) != 0 ? 0xEDB88320 ^ (c >> 1) : c >> 1;
+            }
+            table[n] = c;
+        }
+        return table;
+    }
+
+    private static uint Crc(uint crc, byte[] data, int offset, int count)
+    {
+        for (int i = offset; i < offset + count; i++)
+        {
+            crc = crcTable[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+        }
+        return crc;
+    }
+
+    #endregion
+}
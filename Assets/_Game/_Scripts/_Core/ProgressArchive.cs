@@ -0,0 +1,134 @@
+﻿using System.IO;
+using ICSharpCode.SharpZipLib.Zip.Compression;
+using ICSharpCode.SharpZipLib.Zip.Compression.Streams;
+
+// Backup of the player's progress: settings and saved pages in one file. After the header (magic, version) the
+// rest is one raw deflate stream of records, each a tag byte and its data (managed SharpZipLib, which WebGL has):
+//   Setting  key, int value
+//   Page     key, int length, the page as CanvasPageEncoder saved it (header and painted tiles only)
+//   End
+// Pages are copied through as saved, neither side decodes them. Read hands over one page at a time in a pooled
+// buffer, so a restore holds the largest page, not the archive.
+public static class ProgressArchive
+{
+    private const int Magic = 0x4B424243; // "CBBK"
+    private const byte Version = 1;
+
+    private const byte SettingRecord = 1;
+    private const byte PageRecord = 2;
+    private const byte EndRecord = 0;
+
+    private const int MaxPageBytes = 1 << 26; // a 4096x4096 RGBA page with its tile headers is well below
+
+
+    #region Write
+
+    // writes records to a stream, Finish ends the archive, the stream stays open
+    public class Writer
+    {
+        private readonly DeflaterOutputStream deflate;
+        private readonly BinaryWriter writer;
+
+        // level 0 (stored) to 9 (smallest)
+        public Writer(Stream output, int level = Deflater.DEFAULT_COMPRESSION)
+        {
+            BinaryWriter header = new BinaryWriter(output);
+            header.Write(Magic);
+            header.Write(Version);
+            header.Flush();
+
+            deflate = new DeflaterOutputStream(output, new Deflater(level, true), 1 << 14);
+            deflate.IsStreamOwner = false;
+            writer = new BinaryWriter(deflate);
+        }
+
+        public void WriteSetting(string key, int value)
+        {
+            writer.Write(SettingRecord);
+            writer.Write(key);
+            writer.Write(value);
+        }
+
+        // the first length bytes of page, e.g. a pooled buffer
+        public void WritePage(string key, byte[] page, int length)
+        {
+            writer.Write(PageRecord);
+            writer.Write(key);
+            writer.Write(length);
+            writer.Write(page, 0, length);
+        }
+
+        public void Finish()
+        {
+            writer.Write(EndRecord);
+            writer.Flush();
+            deflate.Finish();
+        }
+    }
+
+    #endregion
+
+
+    #region Read
+
+    // Calls setting and page for every record in order, page gets a pooled buffer that is only valid during the
+    // call. Returns false if input is no progress archive of a known version, throws if it ends early or is broken.
+    public static bool Read(Stream input, System.Action<string, int> setting, System.Action<string, byte[], int> page)
+    {
+        BinaryReader header = new BinaryReader(input);
+        if (header.ReadInt32() != Magic) return false;
+        if (header.ReadByte() != Version) return false;
+
+        using (InflaterInputStream inflate = new InflaterInputStream(input, new Inflater(true), 1 << 14))
+        {
+            inflate.IsStreamOwner = false;
+            BinaryReader reader = new BinaryReader(inflate);
+
+            while (true)
+            {
+                byte record = reader.ReadByte();
+                if (record == EndRecord) return true;
+
+                string key = reader.ReadString();
+
+                if (record == SettingRecord)
+                {
+                    setting(key, reader.ReadInt32());
+                }
+                else if (record == PageRecord)
+                {
+                    int length = reader.ReadInt32();
+                    if (length < 0 || length > MaxPageBytes) throw new InvalidDataException("page " + key + " of " + length + " bytes");
+
+                    byte[] buffer = BufferPool<byte>.Rent(length);
+                    try
+                    {
+                        ReadFully(inflate, buffer, length);
+                        page(key, buffer, length);
+                    }
+                    finally
+                    {
+                        BufferPool<byte>.Return(buffer);
+                    }
+                }
+                else
+                {
+                    throw new InvalidDataException("unknown record " + record);
+                }
+            }
+        }
+    }
+
+    // the inflater returns what it has inflated, not what was asked for
+    private static void ReadFully(Stream input, byte[] buffer, int length)
+    {
+        for (int offset = 0; offset < length;)
+        {
+            int n = input.Read(buffer, offset, length - offset);
+            if (n == 0) throw new EndOfStreamException();
+            offset += n;
+        }
+    }
+
+    #endregion
+}
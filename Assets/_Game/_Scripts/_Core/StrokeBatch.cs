@@ -0,0 +1,125 @@
+﻿using System;
+
+// The pointer samples of one frame of a stroke, as the polyline the painter gets in one pass, page pixels.
+// Samples less than a pixel from the one before are merged, or painted again with repeatSamples. With spacing set, the gap from the stroke so far to
+// each sample is filled with points spacing apart on a Catmull-Rom curve through the samples before it, so a fast
+// curve that is read only once per frame stays round instead of turning into a polygon. The curve ends at the
+// newest sample, nothing waits for the samples of the next frame.
+public class StrokeBatch
+{
+    public float spacing = 0f; // between filled points, 0: the samples only
+    public bool repeatSamples = false; // a sample on the last one is painted again (the marker darkens where it rests)
+
+    private float[] points = new float[64]; // x, y pairs
+    private int count = 0;
+
+    // the last two samples of the stroke, p1 the newest
+    private float x0, y0, x1, y1;
+    private int known = 0;
+
+    public int Count
+    {
+        get { return count; }
+    }
+
+    public float X(int index)
+    {
+        return points[index * 2];
+    }
+
+    public float Y(int index)
+    {
+        return points[index * 2 + 1];
+    }
+
+    // a stroke starts at x, y, it is painted by the pointer down, not part of a batch
+    public void Begin(float x, float y)
+    {
+        count = 0;
+        known = 1;
+        x1 = x;
+        y1 = y;
+    }
+
+    // the stroke left the page, the next sample is not connected with a curve
+    public void Break()
+    {
+        known = 0;
+    }
+
+    // the batch was painted, the stroke goes on
+    public void Clear()
+    {
+        count = 0;
+    }
+
+    public void Add(float x, float y)
+    {
+        if (known > 0)
+        {
+            float dx = x - x1;
+            float dy = y - y1;
+            if (dx * dx + dy * dy < 1f)
+            {
+                if (repeatSamples) Append(x, y);
+                return;
+            }
+
+            if (spacing > 0f) Fill(x, y);
+        }
+
+        Append(x, y);
+
+        x0 = x1;
+        y0 = y1;
+        x1 = x;
+        y1 = y;
+        known = Math.Min(known + 1, 2);
+    }
+
+    // points between p1 and the new sample p2; p0 is the sample before p1 (p1 itself at the start of a stroke),
+    // p3 continues the samples past the end with the turn they are taking, in a straight line at the start
+    private void Fill(float x2, float y2)
+    {
+        float length = (float)Math.Sqrt((x2 - x1) * (x2 - x1) + (y2 - y1) * (y2 - y1));
+        int steps = (int)(length / spacing);
+        if (steps < 2) return;
+
+        float px0 = x1, py0 = y1;
+        float px3 = x2 + (x2 - x1);
+        float py3 = y2 + (y2 - y1);
+
+        if (known > 1)
+        {
+            px0 = x0;
+            py0 = y0;
+            px3 += (x2 - x1) - (x1 - x0);
+            py3 += (y2 - y1) - (y1 - y0);
+        }
+
+        for (int i = 1; i < steps; i++)
+        {
+            float t = i / (float)steps;
+            Append(CatmullRom(px0, x1, x2, px3, t), CatmullRom(py0, y1, y2, py3, t));
+        }
+    }
+
+    private static float CatmullRom(float p0, float p1, float p2, float p3, float t)
+    {
+        float t2 = t * t;
+        float t3 = t2 * t;
+        return 0.5f * (2f * p1 + (p2 - p0) * t + (2f * p0 - 5f * p1 + 4f * p2 - p3) * t2 + (3f * p1 - p0 - 3f * p2 + p3) * t3);
+    }
+
+    private void Append(float x, float y)
+    {
+        if (count * 2 + 2 > points.Length)
+        {
+            Array.Resize(ref points, points.Length * 2);
+        }
+
+        points[count * 2] = x;
+        points[count * 2 + 1] = y;
+        count++;
+    }
+}
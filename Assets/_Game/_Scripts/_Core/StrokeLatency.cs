@@ -0,0 +1,226 @@
+﻿using System;
+using System.Diagnostics;
+using System.Globalization;
+using System.IO;
+using System.Text;
+
+// Input to photon estimate of painting: every pointer sample is stamped when the paint scene reads it, then when
+// the frame has rasterized it, when it is on the GPU and when the frame showing it is presented. Stages are
+// marked for all samples waiting for them at once, the samples of a frame share their later stamps.
+// Main thread only, off until Start, the buffer keeps the last Capacity samples.
+public static class StrokeLatency
+{
+    public const int Capacity = 1 << 12;
+
+    public enum Stage
+    {
+        Paint, // input to rasterized
+        Upload, // input to uploaded
+        Present // input to the estimated photon time of its frame
+    }
+
+    private struct Sample
+    {
+        public long input; // Stopwatch ticks
+        public long painted;
+        public long uploaded;
+        public long presented;
+    }
+
+    private static Sample[] samples;
+    private static long written = 0; // samples ever stamped, the ring index is written % Capacity
+    private static long painted = 0; // samples before this one are painted
+    private static long uploaded = 0;
+    private static long presented = 0;
+    private static long startTicks;
+    private static double[] sorted; // percentile scratch
+
+    public static bool Enabled
+    {
+        get { return samples != null; }
+    }
+
+    // samples that went through every stage and are still in the buffer
+    public static int Count
+    {
+        get { return (int)Math.Max(0, presented - Math.Max(0, written - Capacity)); }
+    }
+
+    public static void Start()
+    {
+        if (samples != null) return;
+
+        samples = new Sample[Capacity];
+        sorted = new double[Capacity];
+        startTicks = Stopwatch.GetTimestamp();
+    }
+
+    public static void Stop()
+    {
+        samples = null;
+        sorted = null;
+        Clear();
+    }
+
+    public static void Clear()
+    {
+        written = painted = uploaded = presented = 0;
+    }
+
+
+    #region Stamps
+
+    // a pointer sample was read
+    public static void Input()
+    {
+        Input(Stopwatch.GetTimestamp());
+    }
+
+    public static void Input(long ticks)
+    {
+        if (samples == null) return;
+
+        // a buffer full of samples waiting for their frame, the stages are not marked (e.g. no graphics device)
+        if (written - presented >= Capacity) Clear();
+
+        samples[written % Capacity].input = ticks;
+        written++;
+    }
+
+    // the samples read so far are rasterized into the canvas
+    public static void Painted()
+    {
+        Painted(Stopwatch.GetTimestamp());
+    }
+
+    public static void Painted(long ticks)
+    {
+        if (samples == null) return;
+
+        for (long i = painted; i < written; i++)
+        {
+            samples[i % Capacity].painted = ticks;
+        }
+        painted = written;
+    }
+
+    // what the painted samples changed is on the GPU (or changed nothing)
+    public static void Uploaded()
+    {
+        Uploaded(Stopwatch.GetTimestamp());
+    }
+
+    public static void Uploaded(long ticks)
+    {
+        if (samples == null) return;
+
+        for (long i = uploaded; i < painted; i++)
+        {
+            samples[i % Capacity].uploaded = ticks;
+        }
+        uploaded = painted;
+    }
+
+    // the frame with the uploaded samples is submitted now and on screen displayMs later (an estimate)
+    public static void PresentedAfter(double displayMs)
+    {
+        Presented(Stopwatch.GetTimestamp() + (long)(displayMs * Stopwatch.Frequency / 1000));
+    }
+
+    public static void Presented(long ticks)
+    {
+        if (samples == null) return;
+
+        for (long i = presented; i < uploaded; i++)
+        {
+            samples[i % Capacity].presented = ticks;
+        }
+        presented = uploaded;
+    }
+
+    #endregion
+
+
+    #region Report
+
+    // milliseconds from input to stage below which fraction p (0..1) of the finished samples are
+    public static double Percentile(Stage stage, double p)
+    {
+        int count = Count;
+        if (count == 0) return 0;
+
+        long begin = presented - count;
+        for (int i = 0; i < count; i++)
+        {
+            sorted[i] = Milliseconds(samples[(begin + i) % Capacity], stage);
+        }
+        Array.Sort(sorted, 0, count);
+
+        int index = (int)Math.Ceiling(p * count) - 1;
+        return sorted[Math.Max(0, Math.Min(count - 1, index))];
+    }
+
+    private static double Milliseconds(Sample sample, Stage stage)
+    {
+        long end = stage == Stage.Paint ? sample.painted : stage == Stage.Upload ? sample.uploaded : sample.presented;
+        return (end - sample.input) * 1000.0 / Stopwatch.Frequency;
+    }
+
+    // one line, e.g. for the log
+    public static string Summary()
+    {
+        StringBuilder text = new StringBuilder();
+        text.Append("Stroke latency, ").Append(Count).Append(" samples: photon");
+        AppendPercentiles(text, Stage.Present);
+        text.Append(", paint");
+        AppendPercentiles(text, Stage.Paint);
+        text.Append(", upload");
+        AppendPercentiles(text, Stage.Upload);
+        return text.ToString();
+    }
+
+    private static void AppendPercentiles(StringBuilder text, Stage stage)
+    {
+        text.Append(" p50 ").Append(Percentile(stage, 0.5).ToString("F1", CultureInfo.InvariantCulture));
+        text.Append(" p95 ").Append(Percentile(stage, 0.95).ToString("F1", CultureInfo.InvariantCulture));
+        text.Append(" p99 ").Append(Percentile(stage, 0.99).ToString("F1", CultureInfo.InvariantCulture));
+        text.Append(" ms");
+    }
+
+    // header lines (device, summary) as # comments, then one CSV row per finished sample in ms since Start
+    public static void Write(TextWriter writer, string device)
+    {
+        writer.Write("# ");
+        writer.Write(device);
+        writer.Write("\n# ");
+        writer.Write(Summary());
+        writer.Write("\ninput,painted,uploaded,presented\n");
+
+        int count = Count;
+        long begin = presented - count;
+        double ms = 1000.0 / Stopwatch.Frequency;
+
+        for (int i = 0; i < count; i++)
+        {
+            Sample sample = samples[(begin + i) % Capacity];
+            writer.Write(((sample.input - startTicks) * ms).ToString("F2", CultureInfo.InvariantCulture));
+            writer.Write(',');
+            writer.Write(((sample.painted - startTicks) * ms).ToString("F2", CultureInfo.InvariantCulture));
+            writer.Write(',');
+            writer.Write(((sample.uploaded - startTicks) * ms).ToString("F2", CultureInfo.InvariantCulture));
+            writer.Write(',');
+            writer.Write(((sample.presented - startTicks) * ms).ToString("F2", CultureInfo.InvariantCulture));
+            writer.Write('\n');
+        }
+    }
+
+    public static void Save(string path, string device)
+    {
+        using (StreamWriter writer = new StreamWriter(path, false, new UTF8Encoding(false)))
+        {
+            Write(writer, device);
+        }
+    }
+
+    #endregion
+}
@@ -0,0 +1,969 @@
+﻿using System.Collections.Generic;
+
+// RGBA32 page split into fixed-size tiles.
+// Tiles are allocated on first write, untouched tiles share one solid-white sentinel,
+// so memory scales with the painted area instead of the page size.
+// With a palette set, tiles painted only with palette colors hold one index byte per pixel,
+// a tile is promoted to RGBA the first time it gets a color the palette does not have.
+// Tile buffers come from BufferPool and go back to it when a tile is replaced or an undo step is released.
+public class TiledCanvas
+{
+    public const int TileShift = 6;
+    public const int TileSize = 1 << TileShift; // 64x64 pixels
+    public const int TileMask = TileSize - 1;
+    public const int TilePixels = TileSize * TileSize; // length of an indexed tile
+    public const int TileBytes = TilePixels * 4; // length of an RGBA tile
+    public const int MaxPaletteSize = 256;
+
+    // shared content of every tile that has never been painted (read only!)
+    public static readonly byte[] WhiteTile = CreateWhiteTile();
+
+    public readonly int width;
+    public readonly int height;
+    public readonly int tilesX;
+    public readonly int tilesY;
+
+    private byte[][] tiles; // null means WhiteTile, TilePixels long means indexed
+
+    // RGBA per entry, entry 0 is white so a zeroed indexed tile is blank (null when not indexed)
+    private byte[] palette;
+    private int paletteCount;
+    private long lastColor = -1; // last PaletteIndex lookup, packed color (never -1)
+    private int lastIndex = -1;
+
+    // tiles modified since the last upload
+    private bool[] dirty;
+    private List<int> dirtyTiles = new List<int>();
+
+    // tiles replaced since the last CommitChange, with the content they had before
+    private bool[] inChange;
+    private List<int> changeTiles = new List<int>();
+    private List<byte[]> changeData = new List<byte[]>();
+
+    // one undo / redo step: the tiles it touched and the content to swap back in
+    public class Change
+    {
+        public int count;
+        public int[] tiles; // pooled, count entries are used
+        public byte[][] data;
+    }
+
+    private static readonly Stack<Change> freeChanges = new Stack<Change>(); // released steps, reused by CommitChange
+
+    public TiledCanvas(int width, int height)
+    {
+        this.width = width;
+        this.height = height;
+
+        tilesX = (width + TileMask) >> TileShift;
+        tilesY = (height + TileMask) >> TileShift;
+
+        tiles = new byte[tilesX * tilesY][];
+        dirty = new bool[tiles.Length];
+        inChange = new bool[tiles.Length];
+    }
+
+    private static byte[] CreateWhiteTile()
+    {
+        byte[] tile = new byte[TileBytes];
+        for (int i = 0; i < tile.Length; i++)
+        {
+            tile[i] = 255;
+        }
+        return tile;
+    }
+
+    #region Tiles
+
+    public int TileCount
+    {
+        get { return tiles.Length; }
+    }
+
+    public List<int> DirtyTiles
+    {
+        get { return dirtyTiles; }
+    }
+
+    public int AllocatedTileCount
+    {
+        get
+        {
+            int count = 0;
+            for (int i = 0; i < tiles.Length; i++)
+            {
+                if (tiles[i] != null) count++;
+            }
+            return count;
+        }
+    }
+
+    // bytes held by painted tiles
+    public long AllocatedBytes
+    {
+        get
+        {
+            long bytes = 0;
+            for (int i = 0; i < tiles.Length; i++)
+            {
+                if (tiles[i] != null) bytes += tiles[i].Length;
+            }
+            return bytes;
+        }
+    }
+
+    public bool IsAllocated(int index)
+    {
+        return tiles[index] != null;
+    }
+
+    public static bool IsIndexedTile(byte[] tile)
+    {
+        return tile.Length == TilePixels;
+    }
+
+    public int TileIndex(int x, int y)
+    {
+        return (y >> TileShift) * tilesX + (x >> TileShift);
+    }
+
+    // pixel number inside its tile, multiply by 4 for the byte offset in an RGBA tile
+    public static int TilePixel(int x, int y)
+    {
+        return ((y & TileMask) << TileShift) + (x & TileMask);
+    }
+
+    public static int TileOffset(int x, int y)
+    {
+        return TilePixel(x, y) << 2;
+    }
+
+    // read only access, may return the shared WhiteTile or an indexed tile
+    public byte[] GetTile(int index)
+    {
+        return tiles[index] ?? WhiteTile;
+    }
+
+    public void GetPixel(int x, int y, out byte r, out byte g, out byte b, out byte a)
+    {
+        byte[] tile = tiles[TileIndex(x, y)] ?? WhiteTile;
+        byte[] src = tile;
+        int offset = TilePixel(x, y);
+
+        if (tile.Length == TilePixels)
+        {
+            src = palette;
+            offset = tile[offset];
+        }
+
+        offset <<= 2;
+        r = src[offset];
+        g = src[offset + 1];
+        b = src[offset + 2];
+        a = src[offset + 3];
+    }
+
+    // writes the RGBA content of a tile to dst (TileBytes long)
+    public void ResolveTile(int index, byte[] dst)
+    {
+        byte[] tile = GetTile(index);
+
+        if (tile.Length == TilePixels)
+        {
+            Expand(tile, dst);
+        }
+        else
+        {
+            System.Buffer.BlockCopy(tile, 0, dst, 0, TileBytes);
+        }
+    }
+
+    // the first write of a change gives the tile a fresh buffer and keeps the old one for undo,
+    // rgba: the caller writes colors outside the palette, an indexed tile gets promoted
+    private byte[] Writable(int index, bool rgba)
+    {
+        byte[] tile = tiles[index];
+
+        if (!inChange[index])
+        {
+            inChange[index] = true;
+            changeTiles.Add(index);
+            changeData.Add(tile);
+
+            tile = tiles[index] = Copy(tile, rgba);
+        }
+        else if (tile == null || (rgba && tile.Length == TilePixels))
+        {
+            // cleared or promoted within this change, the content before the change is already kept,
+            // the indexed copy made for this change goes back to the pool
+            byte[] previous = tile;
+            tile = tiles[index] = Copy(previous, rgba);
+            BufferPool<byte>.Return(previous);
+        }
+
+        MarkDirty(index);
+        return tile;
+    }
+
+    private byte[] Copy(byte[] tile, bool rgba)
+    {
+        if (tile == null)
+        {
+            if (palette != null && !rgba)
+            {
+                byte[] blank = BufferPool<byte>.Rent(TilePixels);
+                System.Array.Clear(blank, 0, TilePixels);
+                return blank;
+            }
+
+            tile = WhiteTile;
+        }
+
+        byte[] copy = BufferPool<byte>.Rent(rgba ? TileBytes : tile.Length);
+
+        if (tile.Length == TilePixels && rgba)
+        {
+            Expand(tile, copy);
+        }
+        else
+        {
+            System.Buffer.BlockCopy(tile, 0, copy, 0, tile.Length);
+        }
+
+        return copy;
+    }
+
+    private void Expand(byte[] indices, byte[] rgba)
+    {
+        for (int i = 0, o = 0; i < TilePixels; i++, o += 4)
+        {
+            int p = indices[i] << 2;
+            rgba[o] = palette[p];
+            rgba[o + 1] = palette[p + 1];
+            rgba[o + 2] = palette[p + 2];
+            rgba[o + 3] = palette[p + 3];
+        }
+    }
+
+    public void MarkDirty(int index)
+    {
+        if (!dirty[index])
+        {
+            dirty[index] = true;
+            dirtyTiles.Add(index);
+        }
+    }
+
+    public void MarkAllDirty()
+    {
+        for (int i = 0; i < tiles.Length; i++)
+        {
+            MarkDirty(i);
+        }
+    }
+
+    public void ClearDirty()
+    {
+        for (int i = 0; i < dirtyTiles.Count; i++)
+        {
+            dirty[dirtyTiles[i]] = false;
+        }
+        dirtyTiles.Clear();
+    }
+
+    // moves the dirty tiles inside the tile rect [tx0, tx1) x [ty0, ty1) to taken, the others stay dirty
+    public void TakeDirtyTiles(int tx0, int ty0, int tx1, int ty1, List<int> taken)
+    {
+        int kept = 0;
+        for (int i = 0; i < dirtyTiles.Count; i++)
+        {
+            int index = dirtyTiles[i];
+            int tx = index % tilesX;
+            int ty = index / tilesX;
+
+            if (tx >= tx0 && tx < tx1 && ty >= ty0 && ty < ty1)
+            {
+                dirty[index] = false;
+                taken.Add(index);
+            }
+            else
+            {
+                dirtyTiles[kept++] = index;
+            }
+        }
+        dirtyTiles.RemoveRange(kept, dirtyTiles.Count - kept);
+    }
+
+    #endregion
+
+
+    #region Undo
+
+    // closes the current change, returns null if nothing was painted since the last commit
+    public Change CommitChange()
+    {
+        if (changeTiles.Count == 0) return null;
+
+        Change change;
+        lock (freeChanges)
+        {
+            change = freeChanges.Count > 0 ? freeChanges.Pop() : new Change();
+        }
+
+        change.count = changeTiles.Count;
+        change.tiles = BufferPool<int>.Rent(change.count);
+        change.data = BufferPool<byte[]>.Rent(change.count);
+
+        for (int i = 0; i < changeTiles.Count; i++)
+        {
+            change.tiles[i] = changeTiles[i];
+            change.data[i] = changeData[i];
+            inChange[changeTiles[i]] = false;
+        }
+        changeTiles.Clear();
+        changeData.Clear();
+
+        return change;
+    }
+
+    // swaps the stored tiles with the current ones, so the same call both undoes and redoes a change
+    public void SwapChange(Change change)
+    {
+        for (int i = 0; i < change.count; i++)
+        {
+            int index = change.tiles[i];
+            byte[] current = tiles[index];
+            tiles[index] = change.data[i];
+            change.data[i] = current;
+            MarkDirty(index);
+        }
+    }
+
+    public static long ChangeBytes(Change change)
+    {
+        long bytes = 0;
+        for (int i = 0; i < change.count; i++)
+        {
+            if (change.data[i] != null) bytes += change.data[i].Length;
+        }
+        return bytes;
+    }
+
+    // gives the tiles of a step that will never be swapped in again back to the pool, the change is reused
+    public static void ReleaseChange(Change change)
+    {
+        for (int i = 0; i < change.count; i++)
+        {
+            BufferPool<byte>.Return(change.data[i]);
+        }
+
+        BufferPool<int>.Return(change.tiles);
+        BufferPool<byte[]>.Return(change.data);
+        change.tiles = null;
+        change.data = null;
+        change.count = 0;
+
+        lock (freeChanges)
+        {
+            freeChanges.Push(change);
+        }
+    }
+
+    // gives every tile back to the pool, including the ones of the open change, the canvas is blank afterwards
+    public void Release()
+    {
+        for (int i = 0; i < tiles.Length; i++)
+        {
+            BufferPool<byte>.Return(tiles[i]);
+            tiles[i] = null;
+            inChange[i] = false;
+        }
+
+        for (int i = 0; i < changeData.Count; i++)
+        {
+            BufferPool<byte>.Return(changeData[i]);
+        }
+        changeTiles.Clear();
+        changeData.Clear();
+    }
+
+    #endregion
+
+
+    #region Palette
+
+    public bool Indexed
+    {
+        get { return palette != null; }
+    }
+
+    public byte[] Palette
+    {
+        get { return palette; }
+    }
+
+    public int PaletteCount
+    {
+        get { return paletteCount; }
+    }
+
+    // switches to indexed mode with count RGBA colors (entry 0 must be white), null goes back to RGBA only.
+    // painted tiles are converted, call it before painting: undo steps taken earlier keep the old format
+    public void SetPalette(byte[] rgba, int count)
+    {
+        if (rgba != null)
+        {
+            if (count < 1 || count > MaxPaletteSize || rgba.Length < count * 4) throw new System.ArgumentException("palette needs 1 to " + MaxPaletteSize + " colors");
+            if (rgba[0] != 255 || rgba[1] != 255 || rgba[2] != 255 || rgba[3] != 255) throw new System.ArgumentException("palette entry 0 must be white");
+
+            if (palette != null && count == paletteCount && SameBytes(rgba, palette, count * 4)) return;
+        }
+
+        // back to RGBA with the palette the indices refer to
+        for (int i = 0; i < tiles.Length; i++)
+        {
+            if (tiles[i] != null && tiles[i].Length == TilePixels)
+            {
+                byte[] indexed = tiles[i];
+                tiles[i] = Copy(indexed, true);
+                BufferPool<byte>.Return(indexed);
+                MarkDirty(i);
+            }
+        }
+
+        lastColor = -1;
+
+        if (rgba == null)
+        {
+            palette = null;
+            paletteCount = 0;
+            return;
+        }
+
+        palette = new byte[MaxPaletteSize * 4];
+        System.Buffer.BlockCopy(rgba, 0, palette, 0, count * 4);
+        paletteCount = count;
+
+        // then down to indices where the palette has every color of the tile
+        for (int i = 0; i < tiles.Length; i++)
+        {
+            if (tiles[i] == null) continue;
+
+            byte[] indexed = ToIndexed(tiles[i]);
+            if (indexed != null)
+            {
+                BufferPool<byte>.Return(tiles[i]);
+                tiles[i] = indexed;
+                MarkDirty(i);
+            }
+        }
+    }
+
+    // palette entry of the color, -1 when it is not in the palette (or the canvas is not indexed)
+    public int PaletteIndex(byte r, byte g, byte b, byte a)
+    {
+        if (palette == null) return -1;
+
+        long color = (uint)(r | (g << 8) | (b << 16) | (a << 24));
+        if (color == lastColor) return lastIndex;
+
+        lastColor = color;
+        lastIndex = -1;
+
+        for (int i = 0, p = 0; i < paletteCount; i++, p += 4)
+        {
+            if (palette[p] == r && palette[p + 1] == g && palette[p + 2] == b && palette[p + 3] == a)
+            {
+                lastIndex = i;
+                break;
+            }
+        }
+
+        return lastIndex;
+    }
+
+    private byte[] ToIndexed(byte[] tile)
+    {
+        byte[] indices = BufferPool<byte>.Rent(TilePixels);
+
+        for (int i = 0, o = 0; i < TilePixels; i++, o += 4)
+        {
+            int index = PaletteIndex(tile[o], tile[o + 1], tile[o + 2], tile[o + 3]);
+            if (index < 0)
+            {
+                BufferPool<byte>.Return(indices);
+                return null;
+            }
+
+            indices[i] = (byte)index;
+        }
+
+        return indices;
+    }
+
+    private static bool SameBytes(byte[] a, byte[] b, int count)
+    {
+        for (int i = 0; i < count; i++)
+        {
+            if (a[i] != b[i]) return false;
+        }
+        return true;
+    }
+
+    #endregion
+
+
+    #region Painting
+
+    // back to the white sentinel, the released tiles go into the current change
+    public void Clear()
+    {
+        for (int i = 0; i < tiles.Length; i++)
+        {
+            if (tiles[i] == null) continue;
+
+            if (!inChange[i])
+            {
+                inChange[i] = true;
+                changeTiles.Add(i);
+                changeData.Add(tiles[i]);
+            }
+            else
+            {
+                BufferPool<byte>.Return(tiles[i]);
+            }
+
+            tiles[i] = null;
+            MarkDirty(i);
+        }
+    }
+
+    public void SetPixel(int x, int y, byte r, byte g, byte b, byte a)
+    {
+        int index = PaletteIndex(r, g, b, a);
+        byte[] tile = Writable(TileIndex(x, y), index < 0);
+        int pixel = TilePixel(x, y);
+
+        if (tile.Length == TilePixels)
+        {
+            tile[pixel] = (byte)index;
+            return;
+        }
+
+        pixel <<= 2;
+        tile[pixel] = r;
+        tile[pixel + 1] = g;
+        tile[pixel + 2] = b;
+        tile[pixel + 3] = a;
+    }
+
+    // writes pixels [x0, x1) of row y, lockMask (one byte per page pixel) limits painting to pixels set to 1
+    public void FillSpan(int y, int x0, int x1, byte r, byte g, byte b, byte a, byte[] lockMask)
+    {
+        if (y < 0 || y >= height) return;
+        if (x0 < 0) x0 = 0;
+        if (x1 > width) x1 = width;
+
+        int rowStart = width * y;
+        int index = PaletteIndex(r, g, b, a);
+
+        while (x0 < x1)
+        {
+            int tileEnd = (x0 | TileMask) + 1;
+            int end = tileEnd < x1 ? tileEnd : x1;
+
+            if (lockMask == null || SpanHasLock(lockMask, rowStart, x0, end))
+            {
+                byte[] tile = Writable(TileIndex(x0, y), index < 0);
+                int pixel = TilePixel(x0, y);
+
+                if (tile.Length == TilePixels)
+                {
+                    PaintKernels.FillIndex(tile, pixel, end - x0, (byte)index, lockMask, rowStart + x0);
+                }
+                else
+                {
+                    PaintKernels.FillRgba(tile, pixel << 2, end - x0, r, g, b, a, lockMask, rowStart + x0);
+                }
+            }
+
+            x0 = end;
+        }
+    }
+
+    // marker blend of pixels [x0, x1) of row y towards the color, blended tiles are always RGBA
+    public void BlendSpan(int y, int x0, int x1, byte r, byte g, byte b, byte a, byte[] lockMask)
+    {
+        if (y < 0 || y >= height) return;
+        if (x0 < 0) x0 = 0;
+        if (x1 > width) x1 = width;
+
+        int rowStart = width * y;
+        float t = a / 255f * 0.1f;
+        float tAlpha = a / 255 * 0.1f;
+
+        while (x0 < x1)
+        {
+            int tileEnd = (x0 | TileMask) + 1;
+            int end = tileEnd < x1 ? tileEnd : x1;
+
+            if (lockMask == null || SpanHasLock(lockMask, rowStart, x0, end))
+            {
+                byte[] tile = Writable(TileIndex(x0, y), true);
+                PaintKernels.BlendRgba(tile, TileOffset(x0, y), end - x0, r, g, b, a, t, tAlpha, lockMask, rowStart + x0);
+            }
+
+            x0 = end;
+        }
+    }
+
+    // copies count RGBA pixels from src to row y starting at x, skipping transparent source pixels (promotes to RGBA)
+    public void BlitSpan(int y, int x, byte[] src, int srcOffset, int count)
+    {
+        if (y < 0 || y >= height) return;
+        if (x < 0)
+        {
+            srcOffset -= x * 4;
+            count += x;
+            x = 0;
+        }
+        if (x + count > width) count = width - x;
+
+        int x1 = x + count;
+
+        while (x < x1)
+        {
+            int tileEnd = (x | TileMask) + 1;
+            int end = tileEnd < x1 ? tileEnd : x1;
+
+            // fully transparent parts of the sticker leave the tile alone
+            if (HasOpaque(src, srcOffset, end - x))
+            {
+                byte[] tile = Writable(TileIndex(x, y), true);
+                PaintKernels.BlitRgba(tile, TileOffset(x, y), src, srcOffset, end - x);
+            }
+
+            srcOffset += (end - x) * 4;
+            x = end;
+        }
+    }
+
+    // brush stamp: every pixel with (x - cx)^2 + (y - cy)^2 < radius^2, tiles without a paintable pixel are not touched
+    public void StampCircle(int cx, int cy, int radius, byte r, byte g, byte b, byte a, byte[] lockMask)
+    {
+        if (radius <= 0) return;
+
+        int tx0 = System.Math.Max(cx - radius + 1, 0) >> TileShift;
+        int ty0 = System.Math.Max(cy - radius + 1, 0) >> TileShift;
+        int tx1 = System.Math.Min(cx + radius - 1, width - 1) >> TileShift;
+        int ty1 = System.Math.Min(cy + radius - 1, height - 1) >> TileShift;
+
+        int index = PaletteIndex(r, g, b, a);
+        uint color = PaintKernels.PackColor(r, g, b, a);
+
+        for (int ty = ty0; ty <= ty1; ty++)
+        {
+            for (int tx = tx0; tx <= tx1; tx++)
+            {
+                int ox = tx << TileShift;
+                int oy = ty << TileShift;
+
+                if (PaintKernels.StampCircle(null, TileSize, ox, oy, cx, cy, radius, color, lockMask, width, height) == 0) continue;
+
+                byte[] tile = Writable(ty * tilesX + tx, index < 0);
+                uint value = tile.Length == TilePixels ? (uint)index : color;
+
+                PaintKernels.StampCircle(tile, TileSize, ox, oy, cx, cy, radius, value, lockMask, width, height);
+            }
+        }
+    }
+
+    // StampCircle at the first count centers of xs, ys in one pass over the tiles they touch, each tile made
+    // writable once; paints what stamping them one after the other paints
+    public void StampCircles(int[] xs, int[] ys, int count, int radius, byte r, byte g, byte b, byte a, byte[] lockMask)
+    {
+        int tx0, ty0, tx1, ty1;
+        if (!CirclesTileRect(xs, ys, count, radius, out tx0, out ty0, out tx1, out ty1)) return;
+
+        int index = PaletteIndex(r, g, b, a);
+        uint color = PaintKernels.PackColor(r, g, b, a);
+
+        for (int ty = ty0; ty <= ty1; ty++)
+        {
+            for (int tx = tx0; tx <= tx1; tx++)
+            {
+                int ox = tx << TileShift;
+                int oy = ty << TileShift;
+                byte[] tile = null;
+                uint value = color;
+
+                for (int i = 0; i < count; i++)
+                {
+                    if (!CircleTouchesTile(xs[i], ys[i], radius, ox, oy)) continue;
+
+                    if (tile == null)
+                    {
+                        if (PaintKernels.StampCircle(null, TileSize, ox, oy, xs[i], ys[i], radius, color, lockMask, width, height) == 0) continue;
+
+                        tile = Writable(ty * tilesX + tx, index < 0);
+                        if (tile.Length == TilePixels) value = (uint)index;
+                    }
+
+                    PaintKernels.StampCircle(tile, TileSize, ox, oy, xs[i], ys[i], radius, value, lockMask, width, height);
+                }
+            }
+        }
+    }
+
+    // marker blend of the circles (the pixels StampCircle paints) at the first count centers of xs, ys, in one pass
+    // over the tiles they touch; a pixel under several circles is blended once per circle, as BlendSpan would
+    public void BlendCircles(int[] xs, int[] ys, int count, int radius, byte r, byte g, byte b, byte a, byte[] lockMask)
+    {
+        int tx0, ty0, tx1, ty1;
+        if (!CirclesTileRect(xs, ys, count, radius, out tx0, out ty0, out tx1, out ty1)) return;
+
+        float t = a / 255f * 0.1f;
+        float tAlpha = a / 255 * 0.1f;
+        int r2 = radius * radius;
+
+        for (int ty = ty0; ty <= ty1; ty++)
+        {
+            for (int tx = tx0; tx <= tx1; tx++)
+            {
+                int ox = tx << TileShift;
+                int oy = ty << TileShift;
+                byte[] tile = null;
+
+                for (int i = 0; i < count; i++)
+                {
+                    int cx = xs[i];
+                    int cy = ys[i];
+                    if (!CircleTouchesTile(cx, cy, radius, ox, oy)) continue;
+
+                    int y0 = System.Math.Max(System.Math.Max(cy - radius + 1, oy), 0);
+                    int y1 = System.Math.Min(System.Math.Min(cy + radius, oy + TileSize), height);
+
+                    for (int y = y0; y < y1; y++)
+                    {
+                        int half = PaintKernels.HalfWidth(r2 - (y - cy) * (y - cy));
+                        int x0 = System.Math.Max(System.Math.Max(cx - half, ox), 0);
+                        int x1 = System.Math.Min(System.Math.Min(cx + half + 1, ox + TileSize), width);
+                        if (x0 >= x1) continue;
+
+                        int rowStart = width * y;
+                        if (lockMask != null && !SpanHasLock(lockMask, rowStart, x0, x1)) continue;
+
+                        if (tile == null) tile = Writable(ty * tilesX + tx, true);
+                        PaintKernels.BlendRgba(tile, TileOffset(x0, y), x1 - x0, r, g, b, a, t, tAlpha, lockMask, rowStart + x0);
+                    }
+                }
+            }
+        }
+    }
+
+    // tiles the circles can paint, false if none is on the page
+    private bool CirclesTileRect(int[] xs, int[] ys, int count, int radius, out int tx0, out int ty0, out int tx1, out int ty1)
+    {
+        tx0 = ty0 = tx1 = ty1 = 0;
+        if (count == 0 || radius <= 0) return false;
+
+        int minX = xs[0], maxX = xs[0], minY = ys[0], maxY = ys[0];
+        for (int i = 1; i < count; i++)
+        {
+            minX = System.Math.Min(minX, xs[i]);
+            maxX = System.Math.Max(maxX, xs[i]);
+            minY = System.Math.Min(minY, ys[i]);
+            maxY = System.Math.Max(maxY, ys[i]);
+        }
+
+        int x0 = System.Math.Max(minX - radius + 1, 0);
+        int y0 = System.Math.Max(minY - radius + 1, 0);
+        int x1 = System.Math.Min(maxX + radius - 1, width - 1);
+        int y1 = System.Math.Min(maxY + radius - 1, height - 1);
+        if (x0 > x1 || y0 > y1) return false;
+
+        tx0 = x0 >> TileShift;
+        ty0 = y0 >> TileShift;
+        tx1 = x1 >> TileShift;
+        ty1 = y1 >> TileShift;
+        return true;
+    }
+
+    private static bool CircleTouchesTile(int cx, int cy, int radius, int ox, int oy)
+    {
+        return cx - radius < ox + TileSize && cx + radius > ox && cy - radius < oy + TileSize && cy + radius > oy;
+    }
+
+    private static bool HasOpaque(byte[] rgba, int offset, int count)
+    {
+        for (int i = offset + 3; i < offset + count * 4; i += 4)
+        {
+            if (rgba[i] != 0) return true;
+        }
+        return false;
+    }
+
+    private static bool SpanHasLock(byte[] lockMask, int rowStart, int x0, int x1)
+    {
+        for (int x = x0; x < x1; x++)
+        {
+            if (lockMask[rowStart + x] == 1) return true;
+        }
+        return false;
+    }
+
+    #endregion
+
+
+    #region Raw Pixels
+
+    // replaces the whole canvas from a flat RGBA32 page, all-white tiles stay on the sentinel
+    public void LoadRaw(byte[] raw)
+    {
+        int rowBytes = width * 4;
+
+        for (int ty = 0; ty < tilesY; ty++)
+        {
+            for (int tx = 0; tx < tilesX; tx++)
+            {
+                int x0 = tx << TileShift;
+                int y0 = ty << TileShift;
+                int w = System.Math.Min(TileSize, width - x0);
+                int h = System.Math.Min(TileSize, height - y0);
+                int index = ty * tilesX + tx;
+
+                byte[] tile = null;
+
+                for (int row = 0; row < h; row++)
+                {
+                    int src = (y0 + row) * rowBytes + x0 * 4;
+
+                    if (tile == null)
+                    {
+                        if (IsWhite(raw, src, w * 4)) continue;
+
+                        tile = BufferPool<byte>.Rent(TileBytes);
+                        System.Buffer.BlockCopy(WhiteTile, 0, tile, 0, TileBytes);
+                    }
+
+                    System.Buffer.BlockCopy(raw, src, tile, (row << TileShift) * 4, w * 4);
+                }
+
+                BufferPool<byte>.Return(tiles[index]);
+                tiles[index] = tile;
+                MarkDirty(index);
+            }
+        }
+    }
+
+    // writes the page as flat RGBA32, taking every step-th pixel in both directions
+    public void ReadRaw(byte[] dst, int step)
+    {
+        int dstWidth = (width + step - 1) / step;
+        int dstHeight = (height + step - 1) / step;
+
+        int pixel = 0;
+        for (int y = 0; y < dstHeight; y++)
+        {
+            int py = y * step;
+            for (int x = 0; x < dstWidth; x++)
+            {
+                GetPixel(x * step, py, out dst[pixel], out dst[pixel + 1], out dst[pixel + 2], out dst[pixel + 3]);
+                pixel += 4;
+            }
+        }
+    }
+
+    // writes row y as flat RGBA32 (width * 4 bytes) to dst at offset
+    public void ReadRow(int y, byte[] dst, int offset)
+    {
+        int ty = y >> TileShift;
+        int rowStart = (y & TileMask) << TileShift;
+
+        for (int tx = 0; tx < tilesX; tx++)
+        {
+            byte[] tile = tiles[ty * tilesX + tx] ?? WhiteTile;
+            int count = System.Math.Min(TileSize, width - (tx << TileShift));
+
+            if (tile.Length == TilePixels)
+            {
+                for (int i = 0; i < count; i++, offset += 4)
+                {
+                    int p = tile[rowStart + i] << 2;
+                    dst[offset] = palette[p];
+                    dst[offset + 1] = palette[p + 1];
+                    dst[offset + 2] = palette[p + 2];
+                    dst[offset + 3] = palette[p + 3];
+                }
+            }
+            else
+            {
+                System.Buffer.BlockCopy(tile, rowStart * 4, dst, offset, count * 4);
+                offset += count * 4;
+            }
+        }
+    }
+
+    // a copy of the page content (tiles and palette, no undo state) that can be read on another thread
+    // while this one is painted, Release it when done
+    public TiledCanvas Clone()
+    {
+        TiledCanvas copy = new TiledCanvas(width, height);
+
+        if (palette != null)
+        {
+            copy.palette = (byte[])palette.Clone();
+            copy.paletteCount = paletteCount;
+        }
+
+        for (int i = 0; i < tiles.Length; i++)
+        {
+            if (tiles[i] == null) continue;
+
+            copy.tiles[i] = BufferPool<byte>.Rent(tiles[i].Length);
+            System.Buffer.BlockCopy(tiles[i], 0, copy.tiles[i], 0, tiles[i].Length);
+        }
+
+        return copy;
+    }
+
+    // FNV-1a of the page as flat RGBA32, the same for indexed and RGBA tiles of the same colors
+    public uint Checksum()
+    {
+        uint hash = 2166136261;
+        byte r, g, b, a;
+
+        for (int y = 0; y < height; y++)
+        {
+            for (int x = 0; x < width; x++)
+            {
+                GetPixel(x, y, out r, out g, out b, out a);
+                hash = (hash ^ r) * 16777619;
+                hash = (hash ^ g) * 16777619;
+                hash = (hash ^ b) * 16777619;
+                hash = (hash ^ a) * 16777619;
+            }
+        }
+
+        return hash;
+    }
+
+    // used by the page encoder, takes ownership of data (TileBytes, or TilePixels when indexed)
+    public void SetTile(int index, byte[] data)
+    {
+        BufferPool<byte>.Return(tiles[index]);
+        tiles[index] = data;
+        MarkDirty(index);
+    }
+
+    private static bool IsWhite(byte[] data, int start, int count)
+    {
+        for (int i = start; i < start + count; i++)
+        {
+            if (data[i] != 255) return false;
+        }
+        return true;
+    }
+
+    #endregion
+}
@@ -0,0 +1,160 @@
+﻿using System;
+using System.Diagnostics;
+using System.IO;
+using System.Text;
+using System.Threading;
+
+// Begin / end events with thread IDs in a preallocated ring buffer, written out as Chrome trace_event JSON
+// (chrome://tracing, ui.perfetto.dev). Recording only stores a name, a timestamp and the thread, names must be
+// literals or other strings that live on, nothing is allocated per event.
+// Off until Start, the buffer keeps the last Capacity events.
+public static class TraceLog
+{
+    public const int Capacity = 1 << 14;
+
+    private struct Event
+    {
+        public string name;
+        public char phase; // B begin, E end, i instant
+        public long ticks; // Stopwatch ticks
+        public int thread;
+    }
+
+    // ends the event it was started with, use with using (TraceLog.Auto("name"))
+    public struct Scope : IDisposable
+    {
+        private string name;
+
+        public Scope(string name)
+        {
+            this.name = name;
+        }
+
+        public void Dispose()
+        {
+            End(name);
+        }
+    }
+
+    private static Event[] events;
+    private static long written = 0; // events ever recorded, the ring index is written % Capacity
+    private static long startTicks;
+    private static int mainThread;
+
+    public static bool Enabled
+    {
+        get { return events != null; }
+    }
+
+    // allocates the buffer, call it on the main thread, as early as possible
+    public static void Start()
+    {
+        if (events != null) return;
+
+        events = new Event[Capacity];
+        startTicks = Stopwatch.GetTimestamp();
+        mainThread = Thread.CurrentThread.ManagedThreadId;
+    }
+
+    public static void Begin(string name)
+    {
+        Add(name, 'B');
+    }
+
+    public static void End(string name)
+    {
+        Add(name, 'E');
+    }
+
+    // a point in time, e.g. a scene change
+    public static void Instant(string name)
+    {
+        Add(name, 'i');
+    }
+
+    public static Scope Auto(string name)
+    {
+        Begin(name);
+        return new Scope(name);
+    }
+
+    private static void Add(string name, char phase)
+    {
+        Event[] buffer = events;
+        if (buffer == null) return;
+
+        long index = Interlocked.Increment(ref written) - 1;
+
+        Event e;
+        e.name = name;
+        e.phase = phase;
+        e.ticks = Stopwatch.GetTimestamp();
+        e.thread = Thread.CurrentThread.ManagedThreadId;
+
+        buffer[index % Capacity] = e;
+    }
+
+    public static void Clear()
+    {
+        Interlocked.Exchange(ref written, 0);
+    }
+
+
+    #region Export
+
+    // the buffered events as a trace_event JSON object, oldest first
+    public static void Write(TextWriter writer)
+    {
+        writer.Write("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+        writer.Write("{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":");
+        writer.Write(mainThread);
+        writer.Write(",\"args\":{\"name\":\"Main Thread\"}}");
+
+        if (events != null)
+        {
+            long end = Interlocked.Read(ref written);
+            long begin = Math.Max(0, end - Capacity);
+            double microseconds = 1000000.0 / Stopwatch.Frequency;
+
+            for (long i = begin; i < end; i++)
+            {
+                Event e = events[i % Capacity];
+                if (e.name == null) continue;
+
+                writer.Write(",\n{\"name\":\"");
+                WriteEscaped(writer, e.name);
+                writer.Write("\",\"ph\":\"");
+                writer.Write(e.phase);
+                writer.Write("\",\"ts\":");
+                writer.Write(((e.ticks - startTicks) * microseconds).ToString("F1", System.Globalization.CultureInfo.InvariantCulture));
+                writer.Write(",\"pid\":1,\"tid\":");
+                writer.Write(e.thread);
+                if (e.phase == 'i') writer.Write(",\"s\":\"p\"");
+                writer.Write('}');
+            }
+        }
+
+        writer.Write("\n]}\n");
+    }
+
+    public static void Save(string path)
+    {
+        using (StreamWriter writer = new StreamWriter(path, false, new UTF8Encoding(false)))
+        {
+            Write(writer);
+        }
+    }
+
+    private static void WriteEscaped(TextWriter writer, string text)
+    {
+        for (int i = 0; i < text.Length; i++)
+        {
+            char c = text[i];
+            if (c == '"' || c == '\\') writer.Write('\\');
+            if (c < ' ') continue;
+            writer.Write(c);
+        }
+    }
+
+    #endregion
+}
@@ -0,0 +1,115 @@
+﻿using System.Collections.Generic;
+
+// Undo / redo steps of one page, each step is the tiles one stroke changed (TiledCanvas.Change).
+// Undoing a step swaps its tiles back in, painting after an undo drops the undone steps.
+public class UndoHistory
+{
+    private List<TiledCanvas.Change> steps = new List<TiledCanvas.Change>();
+    private int redoIndex = 0; // steps undone, counted from the end
+
+    public int UndoCount
+    {
+        get { return steps.Count - redoIndex; }
+    }
+
+    public int RedoCount
+    {
+        get { return redoIndex; }
+    }
+
+    public bool CanUndo
+    {
+        get { return UndoCount > 0; }
+    }
+
+    public bool CanRedo
+    {
+        get { return redoIndex > 0; }
+    }
+
+    // stores what was painted since the last commit as one step, false if nothing was
+    public bool Commit(TiledCanvas canvas)
+    {
+        TiledCanvas.Change change = canvas.CommitChange();
+        if (change == null) return false;
+
+        if (redoIndex > 0)
+        {
+            Release(steps.Count - redoIndex, redoIndex);
+            steps.RemoveRange(steps.Count - redoIndex, redoIndex);
+        }
+
+        steps.Add(change);
+        redoIndex = 0;
+        return true;
+    }
+
+    // returns true if the canvas changed
+    public bool Undo(TiledCanvas canvas)
+    {
+        // anything painted after the last stroke ended becomes its own step first
+        Commit(canvas);
+
+        if (!CanUndo) return false;
+
+        canvas.SwapChange(steps[steps.Count - redoIndex - 1]);
+        redoIndex++;
+        return true;
+    }
+
+    public bool Redo(TiledCanvas canvas)
+    {
+        if (!CanRedo) return false;
+
+        canvas.SwapChange(steps[steps.Count - redoIndex]);
+        redoIndex--;
+        return true;
+    }
+
+    // drops the oldest steps until at most maxUndoSteps can be undone, redo steps stay, returns the bytes released
+    public long TrimTo(int maxUndoSteps)
+    {
+        int count = UndoCount - System.Math.Max(0, maxUndoSteps);
+        if (count <= 0) return 0;
+
+        long bytes = 0;
+        for (int i = 0; i < count; i++)
+        {
+            bytes += TiledCanvas.ChangeBytes(steps[i]);
+        }
+
+        Release(0, count);
+        steps.RemoveRange(0, count);
+        return bytes;
+    }
+
+    public void Clear()
+    {
+        Release(0, steps.Count);
+        steps.Clear();
+        redoIndex = 0;
+    }
+
+    // the tiles of dropped steps go back to the pool
+    private void Release(int start, int count)
+    {
+        for (int i = start; i < start + count; i++)
+        {
+            TiledCanvas.ReleaseChange(steps[i]);
+        }
+    }
+
+    // tile memory held by all steps
+    public long Bytes
+    {
+        get
+        {
+            long bytes = 0;
+            for (int i = 0; i < steps.Count; i++)
+            {
+                bytes += TiledCanvas.ChangeBytes(steps[i]);
+            }
+            return bytes;
+        }
+    }
+}
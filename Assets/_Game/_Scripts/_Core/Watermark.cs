@@ -0,0 +1,113 @@
+﻿// Small image blended into exported pages by PageCompositor, in place of the overlay the screenshot used to capture.
+// It sits in a rect given in fractions of the page (like UI anchors), keeping its aspect ratio, centered.
+// The image is premultiplied and scaled to that rect once per page size, exports of pages of the same size reuse it.
+// Safe to use from any thread.
+public class Watermark
+{
+    private readonly byte[] source; // straight alpha RGBA, bottom row first
+    private readonly int sourceWidth;
+    private readonly int sourceHeight;
+    private readonly float left, bottom, right, top;
+
+    // the image as it lands on the page: premultiplied RGBA of width x height at x, y
+    private byte[] scaled;
+    private int pageWidth = -1;
+    private int pageHeight = -1;
+    private int x, y, width, height;
+    private readonly object sync = new object();
+
+    public Watermark(byte[] rgba, int sourceWidth, int sourceHeight, float left, float bottom, float right, float top)
+    {
+        source = rgba;
+        this.sourceWidth = sourceWidth;
+        this.sourceHeight = sourceHeight;
+        this.left = left;
+        this.bottom = bottom;
+        this.right = right;
+        this.top = top;
+    }
+
+    // blends the watermark into rows [y0, y0 + rows) of a page (RGBA32, pageWidth * 4 bytes per row, bottom row first)
+    public void BlendRows(int pageWidth, int pageHeight, int y0, int rows, byte[] dst)
+    {
+        lock (sync)
+        {
+            if (pageWidth != this.pageWidth || pageHeight != this.pageHeight)
+            {
+                Prepare(pageWidth, pageHeight);
+            }
+
+            int from = System.Math.Max(y0, y);
+            int to = System.Math.Min(y0 + rows, y + height);
+
+            for (int py = from; py < to; py++)
+            {
+                int s = (py - y) * width * 4;
+                int d = ((py - y0) * pageWidth + x) * 4;
+
+                for (int i = 0; i < width * 4; i += 4)
+                {
+                    int inv = 255 - scaled[s + i + 3];
+                    if (inv == 255) continue;
+
+                    dst[d + i] = (byte)(scaled[s + i] + (dst[d + i] * inv + 127) / 255);
+                    dst[d + i + 1] = (byte)(scaled[s + i + 1] + (dst[d + i + 1] * inv + 127) / 255);
+                    dst[d + i + 2] = (byte)(scaled[s + i + 2] + (dst[d + i + 2] * inv + 127) / 255);
+                }
+            }
+        }
+    }
+
+    // bilinear scale of the source into its rect on a page of this size
+    private void Prepare(int pageWidth, int pageHeight)
+    {
+        this.pageWidth = pageWidth;
+        this.pageHeight = pageHeight;
+
+        float rectWidth = (right - left) * pageWidth;
+        float rectHeight = (top - bottom) * pageHeight;
+        float scale = System.Math.Min(rectWidth / sourceWidth, rectHeight / sourceHeight);
+
+        width = System.Math.Max(1, (int)(sourceWidth * scale));
+        height = System.Math.Max(1, (int)(sourceHeight * scale));
+        x = System.Math.Max(0, System.Math.Min(pageWidth - width, (int)(left * pageWidth + (rectWidth - width) / 2)));
+        y = System.Math.Max(0, System.Math.Min(pageHeight - height, (int)(bottom * pageHeight + (rectHeight - height) / 2)));
+        width = System.Math.Min(width, pageWidth);
+        height = System.Math.Min(height, pageHeight);
+
+        scaled = new byte[width * height * 4];
+
+        for (int ty = 0; ty < height; ty++)
+        {
+            float sy = System.Math.Max(0f, (ty + 0.5f) / scale - 0.5f);
+            int y0 = System.Math.Min((int)sy, sourceHeight - 1);
+            int y1 = System.Math.Min(y0 + 1, sourceHeight - 1);
+            float fy = System.Math.Min(1f, sy - y0);
+
+            for (int tx = 0; tx < width; tx++)
+            {
+                float sx = System.Math.Max(0f, (tx + 0.5f) / scale - 0.5f);
+                int x0 = System.Math.Min((int)sx, sourceWidth - 1);
+                int x1 = System.Math.Min(x0 + 1, sourceWidth - 1);
+                float fx = System.Math.Min(1f, sx - x0);
+
+                // premultiply before filtering, so transparent texels don't bleed their color into the edge
+                float a00 = source[(y0 * sourceWidth + x0) * 4 + 3];
+                float a10 = source[(y0 * sourceWidth + x1) * 4 + 3];
+                float a01 = source[(y1 * sourceWidth + x0) * 4 + 3];
+                float a11 = source[(y1 * sourceWidth + x1) * 4 + 3];
+
+                int o = (ty * width + tx) * 4;
+                for (int c = 0; c < 3; c++)
+                {
+                    float top0 = source[(y0 * sourceWidth + x0) * 4 + c] * a00 * (1 - fx) + source[(y0 * sourceWidth + x1) * 4 + c] * a10 * fx;
+                    float top1 = source[(y1 * sourceWidth + x0) * 4 + c] * a01 * (1 - fx) + source[(y1 * sourceWidth + x1) * 4 + c] * a11 * fx;
+                    scaled[o + c] = (byte)((top0 * (1 - fy) + top1 * fy) / 255 + 0.5f);
+                }
+
+                float alpha = (a00 * (1 - fx) + a10 * fx) * (1 - fy) + (a01 * (1 - fx) + a11 * fx) * fy;
+                scaled[o + 3] = (byte)(alpha + 0.5f);
+            }
+        }
+    }
+}
@@ -0,0 +1,99 @@
+﻿using UnityEngine;
+using UnityEngine.Rendering;
+using System.Collections;
+using System.IO;
+
+// Marks the frames that reach the screen for StrokeLatency and writes its samples to persistentDataPath/Latency,
+// one CSV per device and session, when the page is left, the app goes to the background or quits, F3 at once.
+// Presenting is estimated at the end of a rendered frame: the GPU time of the last measured frame (FrameTimingManager,
+// needs Frame Timing Stats in the player settings, 0 without) and one refresh for scan out.
+// ColoringBookManager.traceLatency starts StrokeLatency, the performance tests start it for scripted strokes.
+// Editor and development builds only.
+public class LatencyTracer : MonoBehaviour
+{
+    public static LatencyTracer USE;
+
+    private FrameTiming[] timings = new FrameTiming[1];
+    private string file;
+
+
+#if UNITY_EDITOR || DEVELOPMENT_BUILD
+    [RuntimeInitializeOnLoadMethod(RuntimeInitializeLoadType.AfterSceneLoad)]
+    private static void Create()
+    {
+        Services.Add<LatencyTracer>();
+    }
+#endif
+
+    private void Awake()
+    {
+        USE = this;
+    }
+
+    private IEnumerator Start()
+    {
+        WaitForEndOfFrame endOfFrame = new WaitForEndOfFrame();
+
+        while (true)
+        {
+            yield return endOfFrame;
+
+            if (StrokeLatency.Enabled && OnDemandRendering.willCurrentFrameRender)
+            {
+                StrokeLatency.PresentedAfter(DisplayDelay());
+            }
+        }
+    }
+
+    private double DisplayDelay()
+    {
+        double gpu = 0;
+        FrameTimingManager.CaptureFrameTimings();
+        if (FrameTimingManager.GetLatestTimings(1, timings) > 0)
+        {
+            gpu = timings[0].gpuFrameTime;
+        }
+
+        double refresh = Screen.currentResolution.refreshRateRatio.value;
+        return gpu + 1000.0 / (refresh > 0 ? refresh : 60);
+    }
+
+    private void Update()
+    {
+        if (Input.GetKeyDown(KeyCode.F3))
+        {
+            Save();
+        }
+    }
+
+    private void OnApplicationPause(bool pause)
+    {
+        if (pause) Save();
+    }
+
+    private void OnApplicationQuit()
+    {
+        Save();
+    }
+
+    // saving again in the same session overwrites the file
+    public string Save()
+    {
+        if (!StrokeLatency.Enabled || StrokeLatency.Count == 0) return null;
+
+        if (file == null)
+        {
+            string folder = Application.persistentDataPath + "/Latency";
+            Directory.CreateDirectory(folder);
+
+            string model = System.Text.RegularExpressions.Regex.Replace(SystemInfo.deviceModel, "[^A-Za-z0-9]+", "_");
+            file = folder + "/latency_" + model + "_" + System.DateTime.Now.ToString("yyyyMMdd_HHmmss") + ".csv";
+        }
+
+        string device = SystemInfo.deviceModel + ", " + SystemInfo.graphicsDeviceName + ", " + Screen.width + "x" + Screen.height + " " + Mathf.RoundToInt((float)Screen.currentResolution.refreshRateRatio.value) + " Hz";
+        StrokeLatency.Save(file, device);
+
+        Debug.Log(StrokeLatency.Summary() + " (" + file + ")");
+        return file;
+    }
+}
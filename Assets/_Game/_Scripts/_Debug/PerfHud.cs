@@ -0,0 +1,399 @@
+﻿using UnityEngine;
+using UnityEngine.Rendering;
+using UnityEngine.SceneManagement;
+using Unity.Profiling;
+
+// Developer overlay with the painting counters: frame time, time in MousePaint, the last fill, bytes uploaded to the
+// page texture, undo memory, GC allocations per frame and the managed heap.
+// Times come from ProfilerRecorders on the markers the Unity Profiler shows, the text is drawn with GL quads
+// from the built-in font into a fixed char buffer, so the overlay allocates nothing while it runs.
+// Editor and development builds only, F1 or a three finger tap toggles it.
+public class PerfHud : MonoBehaviour
+{
+    public static PerfHud USE;
+
+    public bool visible = false;
+    public int refreshFrames = 10; // counters are averaged over this many frames, the text changes at the same rate
+
+    private const int Lines = 8;
+    private const int Columns = 28;
+    private const string Glyphs = "0123456789.-/ abcdefghijklmnopqrstuvwxyzKMB";
+
+    private static readonly ProfilerMarker hudMarker = new ProfilerMarker(ProfilerCategory.Scripts, "ColoringBook.PerfHud");
+
+    private ProfilerRecorder mainThread;
+    private ProfilerRecorder mousePaint;
+    private ProfilerRecorder floodFill;
+    private ProfilerRecorder hud;
+    private ProfilerRecorder gcAllocCount;
+    private ProfilerRecorder gcAllocBytes;
+    private ProfilerRecorder gcUsed;
+
+    private ColoringBookManager paint; // null outside the paint scene
+
+    private long lastFill = 0; // ns, the recorder only has a value in frames with a fill
+    private long uploadMax = 0; // largest upload of the current window
+    private long uploadShown = 0;
+    private int frame = 0;
+
+    private char[] text = new char[Lines * Columns];
+    private int length = 0;
+
+    private Font font;
+    private int fontSize;
+    private Material textMaterial;
+    private Material backgroundMaterial;
+
+
+    #region Init
+
+#if UNITY_EDITOR || DEVELOPMENT_BUILD
+    [RuntimeInitializeOnLoadMethod(RuntimeInitializeLoadType.AfterSceneLoad)]
+    private static void Create()
+    {
+        Services.Add<PerfHud>();
+    }
+#endif
+
+    private void Awake()
+    {
+        USE = this;
+
+        font = Resources.GetBuiltinResource<Font>("LegacyRuntime.ttf");
+        fontSize = Mathf.Max(14, Screen.height / 60);
+
+        textMaterial = new Material(font.material);
+        textMaterial.SetFloat("unity_GUIZTestMode", (float)CompareFunction.Always);
+
+        backgroundMaterial = new Material(Shader.Find("Hidden/Internal-Colored"));
+        backgroundMaterial.SetInt("_SrcBlend", (int)BlendMode.SrcAlpha);
+        backgroundMaterial.SetInt("_DstBlend", (int)BlendMode.OneMinusSrcAlpha);
+        backgroundMaterial.SetInt("_Cull", (int)CullMode.Off);
+        backgroundMaterial.SetInt("_ZWrite", 0);
+        backgroundMaterial.SetInt("_ZTest", (int)CompareFunction.Always);
+
+        SceneManager.sceneLoaded += OnSceneLoaded;
+        Camera.onPostRender += OnCameraPostRender;
+
+        FindPaintScene();
+    }
+
+    private void OnDestroy()
+    {
+        SceneManager.sceneLoaded -= OnSceneLoaded;
+        Camera.onPostRender -= OnCameraPostRender;
+
+        StopRecorders();
+
+        Destroy(textMaterial);
+        Destroy(backgroundMaterial);
+    }
+
+    private void OnSceneLoaded(Scene scene, LoadSceneMode mode)
+    {
+        FindPaintScene();
+    }
+
+    private void FindPaintScene()
+    {
+        paint = FindFirstObjectByType<ColoringBookManager>();
+    }
+
+    // recorders only run while the overlay is shown
+    private void StartRecorders()
+    {
+        mainThread = ProfilerRecorder.StartNew(ProfilerCategory.Internal, "Main Thread", refreshFrames);
+        mousePaint = ProfilerRecorder.StartNew(ProfilerCategory.Scripts, ColoringBookManager.MousePaintMarkerName, refreshFrames);
+        floodFill = ProfilerRecorder.StartNew(ProfilerCategory.Scripts, ColoringBookManager.FloodFillMarkerName);
+        hud = ProfilerRecorder.StartNew(ProfilerCategory.Scripts, "ColoringBook.PerfHud", refreshFrames);
+        gcAllocCount = ProfilerRecorder.StartNew(ProfilerCategory.Memory, "GC Allocation In Frame Count", refreshFrames);
+        gcAllocBytes = ProfilerRecorder.StartNew(ProfilerCategory.Memory, "GC Allocated In Frame", refreshFrames);
+        gcUsed = ProfilerRecorder.StartNew(ProfilerCategory.Memory, "GC Used Memory");
+    }
+
+    private void StopRecorders()
+    {
+        mainThread.Dispose();
+        mousePaint.Dispose();
+        floodFill.Dispose();
+        hud.Dispose();
+        gcAllocCount.Dispose();
+        gcAllocBytes.Dispose();
+        gcUsed.Dispose();
+    }
+
+    #endregion
+
+
+    #region Counters
+
+    private void Update()
+    {
+        if (Input.GetKeyDown(KeyCode.F1) || (Input.touchCount == 3 && Input.GetTouch(2).phase == TouchPhase.Began))
+        {
+            visible = !visible;
+
+            if (visible)
+            {
+                StartRecorders();
+                frame = 0;
+            }
+            else
+            {
+                StopRecorders();
+            }
+        }
+
+        // the paint scene adds to it during the last frame, count it even while hidden so it starts from zero
+        long uploaded = CanvasTexture.uploadedBytes;
+        CanvasTexture.uploadedBytes = 0;
+
+        if (!visible) return;
+
+        using (hudMarker.Auto())
+        {
+            if (uploaded > uploadMax) uploadMax = uploaded;
+
+            if (floodFill.Valid && floodFill.LastValue > 0)
+            {
+                lastFill = floodFill.LastValue;
+            }
+
+            if (++frame >= refreshFrames)
+            {
+                frame = 0;
+                uploadShown = uploadMax;
+                uploadMax = 0;
+
+                Format();
+            }
+        }
+    }
+
+    private void Format()
+    {
+        length = 0;
+
+        Label("frame");
+        Milliseconds(Average(mainThread));
+        NewLine();
+
+        Label("mousepaint");
+        Milliseconds(Average(mousePaint));
+        NewLine();
+
+        Label("last fill");
+        Milliseconds(lastFill);
+        NewLine();
+
+        Label("upload");
+        Bytes(uploadShown);
+        NewLine();
+
+        Label("undo");
+        Bytes(paint != null ? paint.UndoBytes : 0);
+        NewLine();
+
+        Label("gc alloc");
+        Number(Max(gcAllocCount));
+        Append(' ');
+        Append('/');
+        Append(' ');
+        Bytes(Max(gcAllocBytes));
+        NewLine();
+
+        Label("heap");
+        Bytes(gcUsed.Valid ? gcUsed.LastValue : 0);
+        NewLine();
+
+        Label("hud");
+        Milliseconds(Average(hud));
+    }
+
+    private static long Average(ProfilerRecorder recorder)
+    {
+        if (!recorder.Valid || recorder.Count == 0) return 0;
+
+        long sum = 0;
+        for (int i = 0; i < recorder.Count; i++)
+        {
+            sum += recorder.GetSample(i).Value;
+        }
+        return sum / recorder.Count;
+    }
+
+    private static long Max(ProfilerRecorder recorder)
+    {
+        if (!recorder.Valid) return 0;
+
+        long max = 0;
+        for (int i = 0; i < recorder.Count; i++)
+        {
+            long value = recorder.GetSample(i).Value;
+            if (value > max) max = value;
+        }
+        return max;
+    }
+
+    #endregion
+
+
+    #region Text
+
+    private void Append(char c)
+    {
+        if (length < text.Length) text[length++] = c;
+    }
+
+    private void NewLine()
+    {
+        Append('\n');
+    }
+
+    // label padded to a column, so the values line up
+    private void Label(string label)
+    {
+        for (int i = 0; i < label.Length; i++)
+        {
+            Append(label[i]);
+        }
+
+        for (int i = label.Length; i < 11; i++)
+        {
+            Append(' ');
+        }
+    }
+
+    private void Number(long value)
+    {
+        if (value < 0)
+        {
+            Append('-');
+            value = -value;
+        }
+
+        long divisor = 1;
+        while (value / divisor >= 10) divisor *= 10;
+
+        for (; divisor > 0; divisor /= 10)
+        {
+            Append((char)('0' + value / divisor % 10));
+        }
+    }
+
+    // value in hundredths, printed with two decimals
+    private void Fixed(long hundredths)
+    {
+        Number(hundredths / 100);
+        Append('.');
+        Append((char)('0' + hundredths / 10 % 10));
+        Append((char)('0' + hundredths % 10));
+    }
+
+    private void Milliseconds(long nanoseconds)
+    {
+        Fixed(nanoseconds / 10000);
+        Append(' ');
+        Append('m');
+        Append('s');
+    }
+
+    private void Bytes(long bytes)
+    {
+        if (bytes < 1024)
+        {
+            Number(bytes);
+            Append(' ');
+        }
+        else if (bytes < 1024 * 1024)
+        {
+            Fixed(bytes * 100 / 1024);
+            Append(' ');
+            Append('K');
+        }
+        else
+        {
+            Fixed(bytes * 100 / (1024 * 1024));
+            Append(' ');
+            Append('M');
+        }
+
+        Append('B');
+    }
+
+    #endregion
+
+
+    #region Drawing
+
+    private void OnCameraPostRender(Camera cam)
+    {
+        if (!visible || length == 0 || cam != Camera.main) return;
+
+        using (hudMarker.Auto())
+        {
+            // no-op while the glyphs are in the font texture, rebuilds it after the texture was dropped
+            font.RequestCharactersInTexture(Glyphs, fontSize);
+            textMaterial.mainTexture = font.material.mainTexture;
+
+            float lineHeight = fontSize * 1.2f;
+            float left = fontSize * 0.5f;
+            float top = cam.pixelHeight - fontSize * 0.5f;
+
+            GL.PushMatrix();
+            GL.LoadPixelMatrix(0, cam.pixelWidth, 0, cam.pixelHeight);
+
+            backgroundMaterial.SetPass(0);
+            GL.Begin(GL.QUADS);
+            GL.Color(new Color(0f, 0f, 0f, 0.6f));
+            Quad(0, top - lineHeight * Lines - fontSize * 0.5f, left * 2 + fontSize * 0.6f * Columns, cam.pixelHeight);
+            GL.End();
+
+            textMaterial.SetPass(0);
+            GL.Begin(GL.QUADS);
+            GL.Color(Color.white);
+
+            float x = left;
+            float baseline = top - fontSize;
+            CharacterInfo glyph;
+
+            for (int i = 0; i < length; i++)
+            {
+                char c = text[i];
+
+                if (c == '\n')
+                {
+                    x = left;
+                    baseline -= lineHeight;
+                    continue;
+                }
+
+                if (!font.GetCharacterInfo(c, out glyph, fontSize)) continue;
+
+                GL.TexCoord(glyph.uvBottomLeft);
+                GL.Vertex3(x + glyph.minX, baseline + glyph.minY, 0);
+                GL.TexCoord(glyph.uvTopLeft);
+                GL.Vertex3(x + glyph.minX, baseline + glyph.maxY, 0);
+                GL.TexCoord(glyph.uvTopRight);
+                GL.Vertex3(x + glyph.maxX, baseline + glyph.maxY, 0);
+                GL.TexCoord(glyph.uvBottomRight);
+                GL.Vertex3(x + glyph.maxX, baseline + glyph.minY, 0);
+
+                x += glyph.advance;
+            }
+
+            GL.End();
+            GL.PopMatrix();
+        }
+    }
+
+    private static void Quad(float x0, float y0, float x1, float y1)
+    {
+        GL.Vertex3(x0, y0, 0);
+        GL.Vertex3(x0, y1, 0);
+        GL.Vertex3(x1, y1, 0);
+        GL.Vertex3(x1, y0, 0);
+    }
+
+    #endregion
+}
@@ -0,0 +1,82 @@
+﻿using UnityEngine;
+using UnityEngine.SceneManagement;
+using System.IO;
+
+// Starts TraceLog before the first scene and writes it to persistentDataPath/Traces when the app goes to the
+// background or quits, F2 writes it at once. Open the files in ui.perfetto.dev or chrome://tracing.
+// Editor and development builds only.
+public class TraceExport : MonoBehaviour
+{
+    public static TraceExport USE;
+
+
+#if UNITY_EDITOR || DEVELOPMENT_BUILD
+    [RuntimeInitializeOnLoadMethod(RuntimeInitializeLoadType.BeforeSceneLoad)]
+    private static void StartTrace()
+    {
+        TraceLog.Start();
+        TraceLog.Instant("App Start");
+    }
+
+    [RuntimeInitializeOnLoadMethod(RuntimeInitializeLoadType.AfterSceneLoad)]
+    private static void Create()
+    {
+        Services.Add<TraceExport>();
+    }
+#endif
+
+    private void Awake()
+    {
+        USE = this;
+
+        SceneManager.sceneLoaded += OnSceneLoaded;
+        SceneManager.sceneUnloaded += OnSceneUnloaded;
+    }
+
+    private void OnDestroy()
+    {
+        SceneManager.sceneLoaded -= OnSceneLoaded;
+        SceneManager.sceneUnloaded -= OnSceneUnloaded;
+    }
+
+    private void OnSceneLoaded(Scene scene, LoadSceneMode mode)
+    {
+        TraceLog.Instant(scene.name == "PaintScene" ? "PaintScene Loaded" : "Scene Loaded");
+    }
+
+    private void OnSceneUnloaded(Scene scene)
+    {
+        TraceLog.Instant("Scene Unloaded");
+    }
+
+    private void Update()
+    {
+        if (Input.GetKeyDown(KeyCode.F2))
+        {
+            Save();
+        }
+    }
+
+    private void OnApplicationPause(bool pause)
+    {
+        if (pause) Save();
+    }
+
+    private void OnApplicationQuit()
+    {
+        Save();
+    }
+
+    public string Save()
+    {
+        if (!TraceLog.Enabled) return null;
+
+        string folder = Application.persistentDataPath + "/Traces";
+        Directory.CreateDirectory(folder);
+        string file = folder + "/trace_" + System.DateTime.Now.ToString("yyyyMMdd_HHmmss") + ".json";
+        TraceLog.Save(file);
+
+        Debug.Log("Trace: " + file);
+        return file;
+    }
+}
@@ -6,6 +6,10 @@ public class MainManager : MonoBehaviour
     public Camera cameraObj;
     public MenuObject coloringMenu, paintingMenu;
 
+    [Space]
+    public PageImageWriter.Format exportFormat;
+    public Text exportProgress; // optional
+
     [System.Serializable]
     public class MenuObject
     {
@@ -18,18 +22,24 @@ public class MainManager : MonoBehaviour
 
     void Awake()
     {
+        TraceLog.Instant("MainManager.Awake");
+
         Camera.main.aspect = 9 / 16f;
     }
 
     void Start()
     {
-        OnMenuButtonClicked(PlayerPrefs.GetInt("isPainting", 0) == 1);
+        using (TraceLog.Auto("MainManager.Start"))
+        {
+            OnMenuButtonClicked(GameSettings.GetInt("isPainting", 0) == 1);
+        }
     }
 
     public void OnMenuButtonClicked(bool isPainting)
     {
-        PlayerPrefs.SetInt("isPainting", isPainting ? 1 : 0);
-        PlayerPrefs.Save();
+        TraceLog.Begin("MainManager.OnMenuButtonClicked");
+
+        GameSettings.SetInt("isPainting", isPainting ? 1 : 0);
 
         paintingMenu.menu.SetActive(isPainting);
         coloringMenu.menu.SetActive(!isPainting);
@@ -37,6 +47,38 @@ public class MainManager : MonoBehaviour
         cameraObj.backgroundColor = isPainting ? paintingMenu.color : coloringMenu.color;
         paintingMenu.image.sprite = isPainting ? paintingMenu.onEnableSprite : paintingMenu.onDisableSprite;
         coloringMenu.image.sprite = !isPainting ? coloringMenu.onEnableSprite : coloringMenu.onDisableSprite;
+
+        TraceLog.End("MainManager.OnMenuButtonClicked");
+    }
+
+    // all saved pages in one zip for the share sheet, exportProgress shows how far it is; it runs on Services,
+    // opening a page meanwhile hides this scene
+    public void OnExportAllButtonClicked()
+    {
+        if (PageArchive.Exporting) return;
+
+        Services.Run(PageArchive.ExportAll("MyPictures", exportFormat, ShowExportProgress));
+    }
+
+    private void ShowExportProgress(int done, int total)
+    {
+        if (exportProgress == null) return;
+
+        exportProgress.text = done < total ? done + " / " + total : "";
+    }
+
+    public void OnBackupButtonClicked()
+    {
+        if (ProgressBackup.Busy) return;
+
+        Services.Run(ProgressBackup.Backup());
+    }
+
+    public void OnRestoreButtonClicked()
+    {
+        if (ProgressBackup.Busy) return;
+
+        Services.Run(ProgressBackup.Restore());
     }
 
     public void PlaySoundClick()
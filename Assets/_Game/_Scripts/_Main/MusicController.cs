@@ -28,15 +28,14 @@ public class MusicController : MonoBehaviour
     private void LoadSetting()
     {
         // Music
-        AudioListener.volume = PlayerPrefs.GetInt("MusicSetting", 1);
+        AudioListener.volume = GameSettings.GetInt("MusicSetting", 1);
     }
 
     public void ChangeMusicSetting()
     {
         AudioListener.volume = AudioListener.volume == 1 ? 0 : 1;
 
-        PlayerPrefs.SetInt("MusicSetting", (int)AudioListener.volume);
-        PlayerPrefs.Save();
+        GameSettings.SetInt("MusicSetting", (int)AudioListener.volume);
     }
 
     public void PlaySound(AudioClip clip)
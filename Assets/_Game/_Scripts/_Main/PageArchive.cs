@@ -0,0 +1,280 @@
+﻿using UnityEngine;
+using System.Collections;
+using System.Collections.Generic;
+using System.IO;
+using System.Threading.Tasks;
+using ICSharpCode.SharpZipLib.Checksums;
+using ICSharpCode.SharpZipLib.Zip;
+
+// Exports every saved page of the menu lists into one zip file, each page composited with its mask and encoded
+// like PageExport does it. The saved text and the mask are read on the main thread, one page a frame; decode,
+// composite and encode run on workers, at most one page per encoding core, and the finished pages go into the
+// zip in list order on one writer task. A page is held until it is written, so memory stays at a few pages
+// however many there are. The zip goes to the share sheet (ScreenshotManager.Share) once it is complete.
+public static class PageArchive
+{
+    // pages saved before they carried their size are the menu's page size
+    private const int LegacyWidth = 576;
+    private const int LegacyHeight = 1024;
+
+    private static bool exporting = false;
+
+
+    #region Export All
+
+    public static bool Exporting
+    {
+        get { return exporting; }
+    }
+
+    // progress gets pages done and pages in the lists, unsaved pages count as done; one export at a time.
+    // Start it with Services.Run: the menu scene is hidden while a page is open, which would stop it halfway
+    public static IEnumerator ExportAll(string fileName, PageImageWriter.Format format, System.Action<int, int> progress = null)
+    {
+        if (exporting) yield break;
+        exporting = true;
+
+        TraceLog.Begin("PageArchive.ExportAll");
+
+        List<ScrollListManager> lists = ScrollListManager.AllLists();
+
+        int total = 0;
+        foreach (ScrollListManager list in lists)
+        {
+            total += list.PageCount;
+        }
+
+        string zipFilename = ScreenshotManager.NextFileName(fileName, ".zip");
+        string path = ScreenshotManager.FilePath(zipFilename);
+        string extension = format == PageImageWriter.Format.Png ? ".png" : ".jpg";
+
+        Debug.Log("Export " + total + " pages to " + zipFilename);
+
+        ZipOutputStream zip = null;
+        bool finished = false; // the zip is complete and closed
+        bool failed = false;
+        int done = 0;
+
+#if UNITY_WEBGL
+        MemoryStream output = new MemoryStream();
+#else
+        Task writer = Task.CompletedTask;
+#endif
+
+        try
+        {
+#if UNITY_WEBGL
+            zip = new ZipOutputStream(output);
+            zip.UseZip64 = UseZip64.Off; // every entry's size is known before it is written
+
+            // no threads, a page a frame
+            foreach (ScrollListManager list in lists)
+            {
+                for (int i = 0; i < list.PageCount; i++)
+                {
+                    int width, height;
+                    PageStore.Page saved = PageStore.Read(list.saveIndexString + i.ToString());
+                    byte[] maskPixels = ReadMask(list.PageMask(i), out width, out height);
+
+                    if (saved != null)
+                    {
+                        AddEntry(zip, list.saveIndexString + i.ToString() + extension, Encode(saved, maskPixels, width, height, format));
+                    }
+
+                    done++;
+                    if (progress != null) progress(done, total);
+
+                    yield return null;
+                }
+            }
+
+            zip.Finish();
+            zip.Close();
+            finished = true;
+#else
+            zip = new ZipOutputStream(new FileStream(path, FileMode.Create, FileAccess.Write, FileShare.None, 1 << 16));
+            zip.UseZip64 = UseZip64.Off; // every entry's size is known before it is written
+
+            int workers = Mathf.Clamp(SystemInfo.processorCount - 1, 1, 4);
+            Queue<Task> pages = new Queue<Task>(); // written in order, each one after the one before
+
+            foreach (ScrollListManager list in lists)
+            {
+                for (int i = 0; i < list.PageCount && !failed; i++)
+                {
+                    while (pages.Count >= workers && !pages.Peek().IsCompleted)
+                    {
+                        yield return null;
+                    }
+
+                    while (pages.Count > 0 && pages.Peek().IsCompleted)
+                    {
+                        failed |= pages.Dequeue().IsFaulted;
+                        done++;
+                    }
+
+                    string key = list.saveIndexString + i.ToString();
+                    PageStore.Page saved = PageStore.Read(key);
+
+                    if (saved == null)
+                    {
+                        done++;
+                    }
+                    else
+                    {
+                        int width, height;
+                        byte[] maskPixels = ReadMask(list.PageMask(i), out width, out height);
+
+                        Task<byte[]> encode = Task.Run(() => Encode(saved, maskPixels, width, height, format));
+                        Task previous = writer;
+                        writer = Task.WhenAll(previous, encode).ContinueWith(t =>
+                        {
+                            previous.Wait();
+                            AddEntry(zip, key + extension, encode.Result);
+                        });
+                        pages.Enqueue(writer);
+
+                        // one mask read a frame
+                        yield return null;
+                    }
+
+                    if (progress != null) progress(done, total);
+                }
+            }
+
+            Task finish = writer.ContinueWith(t =>
+            {
+                try
+                {
+                    t.Wait();
+                    zip.Finish();
+                }
+                finally
+                {
+                    zip.Close();
+                }
+            });
+            writer = finish;
+
+            while (!finish.IsCompleted)
+            {
+                while (pages.Count > 0 && pages.Peek().IsCompleted)
+                {
+                    pages.Dequeue();
+                    done++;
+                    if (progress != null) progress(done, total);
+                }
+
+                yield return null;
+            }
+
+            finished = true;
+
+            if (finish.IsFaulted)
+            {
+                Debug.LogException(finish.Exception);
+                failed = true;
+            }
+
+            if (failed && File.Exists(path))
+            {
+                File.Delete(path);
+            }
+#endif
+
+            TraceLog.End("PageArchive.ExportAll");
+
+            if (!failed)
+            {
+                if (progress != null) progress(total, total);
+
+#if UNITY_WEBGL
+                yield return ScreenshotManager.Share(path, zipFilename, "ColoringBook", output.ToArray());
+#else
+                yield return ScreenshotManager.Share(path, zipFilename, "ColoringBook");
+#endif
+            }
+        }
+        finally
+        {
+            // stopped or thrown before the zip was complete: close it (after the pages still being written to it)
+            // and drop the partial file
+            if (!finished && zip != null)
+            {
+                TraceLog.End("PageArchive.ExportAll");
+
+#if UNITY_WEBGL
+                zip.Close();
+#else
+                writer.ContinueWith(t =>
+                {
+                    zip.Close();
+                    if (File.Exists(path)) File.Delete(path);
+                });
+#endif
+            }
+
+            exporting = false;
+        }
+    }
+
+    // the mask's pixels and size, the legacy page size without one, main thread
+    private static byte[] ReadMask(Sprite mask, out int width, out int height)
+    {
+        width = LegacyWidth;
+        height = LegacyHeight;
+        if (mask == null) return null;
+
+        using (TraceLog.Auto("PageArchive Mask"))
+        {
+            Texture2D copy = ColoringBookManager.DuplicateTexture(mask.texture);
+            width = copy.width;
+            height = copy.height;
+
+            byte[] pixels = copy.GetPixelData<byte>(0).ToArray();
+            Object.Destroy(copy);
+            return pixels;
+        }
+    }
+
+    // any thread, null for a page that does not decode
+    private static byte[] Encode(PageStore.Page saved, byte[] maskPixels, int width, int height, PageImageWriter.Format format)
+    {
+        TiledCanvas canvas;
+        using (TraceLog.Auto("PageArchive Decode"))
+        {
+            canvas = saved.Decode(width, height);
+        }
+        if (canvas == null) return null;
+
+        // a page saved at another size than its mask is exported without it
+        if (maskPixels != null && maskPixels.Length != canvas.width * canvas.height * 4) maskPixels = null;
+
+        return PageExport.Encode(canvas, maskPixels, null, format);
+    }
+
+    // JPEG and PNG are compressed already, the pages are stored as they are
+    private static void AddEntry(ZipOutputStream zip, string name, byte[] bytes)
+    {
+        if (bytes == null) return;
+
+        using (TraceLog.Auto("PageArchive Write"))
+        {
+            Crc32 crc = new Crc32();
+            crc.Update(bytes);
+
+            ZipEntry entry = new ZipEntry(name);
+            entry.DateTime = System.DateTime.Now;
+            entry.CompressionMethod = CompressionMethod.Stored;
+            entry.Size = bytes.Length;
+            entry.Crc = crc.Value;
+            entry.IsUnicodeText = true; // UTF-8 names, the players have no code page 437 for the default ones
+
+            zip.PutNextEntry(entry);
+            zip.Write(bytes, 0, bytes.Length);
+            zip.CloseEntry();
+        }
+    }
+
+    #endregion
+}
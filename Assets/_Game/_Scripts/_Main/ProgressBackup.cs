@@ -0,0 +1,338 @@
+﻿using UnityEngine;
+using System.Collections;
+using System.Collections.Concurrent;
+using System.Collections.Generic;
+using System.IO;
+using System.Threading;
+using System.Threading.Tasks;
+
+// Backs up and restores the player's progress as a ProgressArchive: theme, music, the menu state and every saved
+// page of the menu lists. The backup is kept at BackupPath and handed to the share sheet, a restore reads
+// BackupPath, e.g. a backup copied over from the old phone. Backup reads a page on the main thread while a
+// worker compresses the one before; restore inflates on a worker, a few pages ahead of the main thread that
+// stores them, so neither holds more than a few pages whatever the backup size. Both run on Services, the menu
+// scene that starts them is hidden when a page opens.
+public static class ProgressBackup
+{
+    public const string BackupName = "ColoringBook.backup";
+
+    private static readonly string[] settingKeys = { "Theme", "MusicSetting", "isPainting" }; // and the index of every list
+    private const int QueuedPages = 4; // pages inflated ahead of the main thread on restore
+
+    private static bool busy = false;
+
+    // a setting or a page of a backup, pages ready for the store
+    private struct Entry
+    {
+        public string key;
+        public PageStore.Page page; // null for a setting
+        public int value;
+    }
+
+    public static string BackupPath
+    {
+        get { return Application.persistentDataPath + "/" + BackupName; }
+    }
+
+    public static bool Busy
+    {
+        get { return busy; }
+    }
+
+
+    #region Backup
+
+    public static IEnumerator Backup()
+    {
+        if (busy) yield break;
+        busy = true;
+
+        TraceLog.Begin("ProgressBackup.Backup");
+
+        List<ScrollListManager> lists = ScrollListManager.AllLists();
+
+        // written next to the backup and moved over it once complete, a failed backup leaves the last one
+        string temp = BackupPath + ".tmp";
+        FileStream output = null;
+        Task write = Task.CompletedTask;
+        bool closed = false; // output is closed and temp moved or deleted
+
+        try
+        {
+            output = new FileStream(temp, FileMode.Create, FileAccess.Write, FileShare.None, 1 << 16);
+            ProgressArchive.Writer writer = new ProgressArchive.Writer(output);
+
+            foreach (string key in settingKeys)
+            {
+                if (GameSettings.Has(key)) writer.WriteSetting(key, GameSettings.GetInt(key));
+            }
+            foreach (ScrollListManager list in lists)
+            {
+                if (GameSettings.Has(list.saveIndexString)) writer.WriteSetting(list.saveIndexString, GameSettings.GetInt(list.saveIndexString));
+            }
+
+            int pages = 0;
+
+            foreach (ScrollListManager list in lists)
+            {
+                for (int i = 0; i < list.PageCount && !write.IsFaulted; i++)
+                {
+                    string key = list.saveIndexString + i.ToString();
+                    PageStore.Page saved = PageStore.Read(key);
+                    if (saved == null) continue;
+
+#if UNITY_WEBGL
+                    // no threads, a page a frame
+                    WritePage(writer, key, saved);
+                    yield return null;
+#else
+                    while (!write.IsCompleted)
+                    {
+                        yield return null;
+                    }
+
+                    write = Task.Run(() => WritePage(writer, key, saved));
+#endif
+                    pages++;
+                }
+            }
+
+            while (!write.IsCompleted)
+            {
+                yield return null;
+            }
+
+            bool failed = write.IsFaulted;
+            if (failed)
+            {
+                Debug.LogException(write.Exception);
+            }
+            else
+            {
+                writer.Finish();
+            }
+            output.Close();
+
+            if (failed)
+            {
+                File.Delete(temp);
+            }
+            else
+            {
+                if (File.Exists(BackupPath)) File.Delete(BackupPath);
+                File.Move(temp, BackupPath);
+            }
+            closed = true;
+
+            TraceLog.End("ProgressBackup.Backup");
+
+            if (!failed)
+            {
+                Debug.Log("Backup of " + pages + " pages, " + new FileInfo(BackupPath).Length / 1024 + " KB");
+
+#if UNITY_WEBGL
+                yield return ScreenshotManager.Share(BackupPath, BackupName, "ColoringBook", File.ReadAllBytes(BackupPath));
+#else
+                // Android shares from the cache
+                string shared = ScreenshotManager.FilePath(BackupName);
+                if (shared != BackupPath) File.Copy(BackupPath, shared, true);
+
+                yield return ScreenshotManager.Share(shared, BackupName, "ColoringBook");
+#endif
+            }
+        }
+        finally
+        {
+            // stopped or thrown halfway: the page being compressed finishes, then the partial backup goes
+            if (!closed)
+            {
+                TraceLog.End("ProgressBackup.Backup");
+
+                FileStream file = output;
+                write.ContinueWith(t =>
+                {
+                    if (file != null) file.Close();
+                    if (File.Exists(temp)) File.Delete(temp);
+                });
+            }
+
+            busy = false;
+        }
+    }
+
+    // any thread, one page at a time
+    private static void WritePage(ProgressArchive.Writer writer, string key, PageStore.Page saved)
+    {
+        int length;
+        byte[] buffer = saved.Rent(out length);
+
+        if (buffer == null)
+        {
+            Debug.LogWarning("Page " + key + " is broken, left out of the backup");
+            return;
+        }
+
+        writer.WritePage(key, buffer, length);
+        BufferPool<byte>.Return(buffer);
+    }
+
+    #endregion
+
+
+    #region Restore
+
+    // pages of the backup replace the saved ones, pages missing from it stay; progress gets the pages stored so far
+    public static IEnumerator Restore(System.Action<int> progress = null)
+    {
+        if (busy) yield break;
+
+        if (!File.Exists(BackupPath))
+        {
+            Debug.LogWarning("No backup at " + BackupPath);
+            yield break;
+        }
+
+        busy = true;
+
+        TraceLog.Begin("ProgressBackup.Restore");
+        float startTime = Time.realtimeSinceStartup;
+
+        int pages = 0;
+        bool archive = false;
+        bool done = false;
+        System.Exception error = null;
+
+#if !UNITY_WEBGL
+        BlockingCollection<Entry> queue = null;
+        CancellationTokenSource cancel = null;
+        Task read = null;
+#endif
+
+        try
+        {
+#if UNITY_WEBGL
+            // no threads, the whole restore in this frame
+            try
+            {
+                using (FileStream input = new FileStream(BackupPath, FileMode.Open, FileAccess.Read, FileShare.Read, 1 << 16))
+                {
+                    archive = ProgressArchive.Read(input, (key, value) => GameSettings.SetInt(key, value), (key, page, length) =>
+                    {
+                        PageStore.Write(key, page, length);
+                        pages++;
+                    });
+                }
+            }
+            catch (System.Exception e)
+            {
+                error = e;
+            }
+#else
+            queue = new BlockingCollection<Entry>(QueuedPages);
+            cancel = new CancellationTokenSource();
+            CancellationToken token = cancel.Token;
+
+            // the worker blocks while the queue is full, cancelling it ends the read if the main thread stops taking
+            read = Task.Run(() =>
+            {
+                try
+                {
+                    using (FileStream input = new FileStream(BackupPath, FileMode.Open, FileAccess.Read, FileShare.Read, 1 << 16))
+                    {
+                        archive = ProgressArchive.Read(input,
+                            (key, value) => queue.Add(new Entry { key = key, value = value }, token),
+                            (key, page, length) => queue.Add(new Entry { key = key, page = PageStore.Page.FromBytes(page, length) }, token));
+                    }
+                }
+                finally
+                {
+                    queue.CompleteAdding();
+                }
+            });
+
+            // PlayerPrefs only on the main thread
+            while (!queue.IsCompleted)
+            {
+                Entry entry;
+                while (queue.TryTake(out entry))
+                {
+                    if (entry.page == null)
+                    {
+                        GameSettings.SetInt(entry.key, entry.value);
+                        continue;
+                    }
+
+                    PageStore.Write(entry.key, entry.page);
+                    pages++;
+                    if (progress != null) progress(pages);
+                }
+
+                yield return null;
+            }
+
+            while (!read.IsCompleted)
+            {
+                yield return null;
+            }
+
+            if (read.IsFaulted) error = read.Exception;
+#endif
+            done = true;
+        }
+        finally
+        {
+#if !UNITY_WEBGL
+            // stopped or thrown halfway: the worker gives up at its next page, then the queue goes
+            if (read != null)
+            {
+                if (!read.IsCompleted) cancel.Cancel();
+
+                BlockingCollection<Entry> entries = queue;
+                CancellationTokenSource source = cancel;
+                read.ContinueWith(t =>
+                {
+                    entries.Dispose();
+                    source.Dispose();
+                });
+            }
+            else if (queue != null)
+            {
+                queue.Dispose();
+                cancel.Dispose();
+            }
+#endif
+            if (!done) TraceLog.End("ProgressBackup.Restore");
+
+            busy = false;
+        }
+
+        GameSettings.Flush(false);
+        PageStore.Save(true);
+
+        TraceLog.End("ProgressBackup.Restore");
+
+        if (error != null)
+        {
+            Debug.LogException(error);
+        }
+        else if (!archive)
+        {
+            Debug.LogError(BackupPath + " is no backup of this game version");
+        }
+        else
+        {
+            Debug.Log("Restored " + pages + " pages in " + ((Time.realtimeSinceStartup - startTime) * 1000).ToString("0") + " ms");
+        }
+
+        // theme and the list positions are read when the scenes start, music applies now
+        AudioListener.volume = GameSettings.GetInt("MusicSetting", 1);
+
+        if (pages > 0)
+        {
+            ColoringBookManager.ForgetPages();
+            ScrollListManager.ReloadThumbnails();
+        }
+    }
+
+    #endregion
+}
@@ -0,0 +1,90 @@
+﻿using UnityEngine;
+using UnityEngine.SceneManagement;
+using System.Collections.Generic;
+
+// MainScene and PaintScene stay loaded side by side after the first switch, only the shown one has its root objects
+// active. Show loads a scene additively the first time and afterwards only swaps the active roots, so going from the
+// menu to a page and back keeps everything both scenes built.
+public static class ResidentScenes
+{
+    private static Dictionary<string, List<GameObject>> hiddenRoots = new Dictionary<string, List<GameObject>>(); // enabled again by Activate
+    private static string loading = null; // asked for by Show, activated once it is loaded
+
+    public static void Show(string name)
+    {
+        Scene scene = SceneManager.GetSceneByName(name);
+        if (scene.isLoaded)
+        {
+            Activate(scene);
+            return;
+        }
+
+        if (loading == null)
+        {
+            SceneManager.sceneLoaded += OnSceneLoaded;
+        }
+
+        loading = name;
+        SceneManager.LoadScene(name, LoadSceneMode.Additive);
+    }
+
+    // enables the roots of scene and hides every other loaded scene, scenes that need Camera.main to be their own
+    // camera in Awake call it from there (sceneLoaded comes after Awake)
+    public static void Activate(Scene scene)
+    {
+        for (int i = 0; i < SceneManager.sceneCount; i++)
+        {
+            Scene other = SceneManager.GetSceneAt(i);
+            if (other != scene && other.isLoaded)
+            {
+                Hide(other);
+            }
+        }
+
+        List<GameObject> roots;
+        if (hiddenRoots.TryGetValue(scene.name, out roots))
+        {
+            hiddenRoots.Remove(scene.name);
+
+            for (int i = 0; i < roots.Count; i++)
+            {
+                // roots of a scene that was unloaded and loaded again in between are gone
+                if (roots[i] != null) roots[i].SetActive(true);
+            }
+        }
+
+        if (scene.isLoaded)
+        {
+            SceneManager.SetActiveScene(scene);
+        }
+    }
+
+    private static void Hide(Scene scene)
+    {
+        List<GameObject> roots;
+        if (!hiddenRoots.TryGetValue(scene.name, out roots))
+        {
+            roots = new List<GameObject>();
+            hiddenRoots.Add(scene.name, roots);
+        }
+
+        // roots that were already inactive stay that way
+        foreach (GameObject root in scene.GetRootGameObjects())
+        {
+            if (!root.activeSelf) continue;
+
+            root.SetActive(false);
+            roots.Add(root);
+        }
+    }
+
+    private static void OnSceneLoaded(Scene scene, LoadSceneMode mode)
+    {
+        if (scene.name != loading) return;
+
+        SceneManager.sceneLoaded -= OnSceneLoaded;
+        loading = null;
+
+        Activate(scene);
+    }
+}
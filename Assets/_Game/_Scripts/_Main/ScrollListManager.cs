@@ -3,10 +3,7 @@ using UnityEngine.SceneManagement;
 using System.Collections;
 using UnityEngine.UI;
 using System.Collections.Generic;
-
-#if UNITY_WEBGL
-using System.IO;
-#endif
+using Unity.Collections;
 
 public class ScrollListManager : MonoBehaviour
 {
@@ -34,6 +31,12 @@ public class ScrollListManager : MonoBehaviour
     private float unfocusedElementsScale = 0.7f;
     private List<GameObject> listOfCharacters;
     private bool buttonPressed;
+    private bool wasHidden; // the menu was hidden behind the paint scene (ResidentScenes)
+
+    // the focused page is loaded into ColoringBookManager's page cache once the list stands still
+    private int prefetchIndex = -1; // the page wanted, -1 while scrolling
+    private int prefetchedIndex = -1; // the page last prefetched
+    private bool prefetching = false; // one page at a time
     private int currentCharacter;
     private int firstPos = 0;
 
@@ -41,15 +44,22 @@ public class ScrollListManager : MonoBehaviour
     private int texHeight = 1024;
 
     private static Dictionary<string, Sprite> allTexturesDic;
+    private static List<ScrollListManager> activeLists = new List<ScrollListManager>(); // lists whose thumbnails are on screen
+    private int thumbnailCharacter = -1; // currentCharacter the thumbnails around were last checked for
 
     private void Awake()
     {
+        TraceLog.Begin("ScrollListManager.Awake");
+
         if (allTexturesDic == null)
         {
             allTexturesDic = new Dictionary<string, Sprite>();
+
+            MemoryGovernor.Register("thumbnails", MemoryGovernor.Tier.Thumbnails, ThumbnailBytes, ReleaseThumbnails);
+            IdleRendering.Register("menu lists", AnyListMoving);
         }
 
-        firstPos = PlayerPrefs.GetInt(saveIndexString, 0);
+        firstPos = GameSettings.GetInt(saveIndexString, 0);
 
         lerping = false;
         buttonPressed = false;
@@ -165,6 +175,30 @@ public class ScrollListManager : MonoBehaviour
         SetNewPos(firstPos);
 
         LoadAllTexture();
+
+        TraceLog.End("ScrollListManager.Awake");
+    }
+
+    private void OnEnable()
+    {
+        activeLists.Add(this);
+
+        // back from a page: its thumbnail changed and hidden thumbnails may have been released meanwhile
+        if (wasHidden)
+        {
+            wasHidden = false;
+            LoadAllTexture();
+        }
+    }
+
+    private void OnDisable()
+    {
+        activeLists.Remove(this);
+        wasHidden = true;
+
+        // coroutines stop with the menu
+        prefetching = false;
+        prefetchedIndex = -1;
     }
 
     private void SetNewPos(int num)
@@ -186,10 +220,14 @@ public class ScrollListManager : MonoBehaviour
 
     private void LoadAllTexture()
     {
+        TraceLog.Begin("ScrollListManager.LoadAllTexture");
+
         for (int i = 0; i < transform.childCount; i++)
         {
             transform.GetChild(i).GetComponent<Image>().sprite = LoadImage(saveIndexString + i.ToString(), saveIndexString + i.ToString() == ColoringBookManager.ID);
         }
+
+        TraceLog.End("ScrollListManager.LoadAllTexture");
     }
 
     private Sprite LoadImage(string key, bool update = false)
@@ -200,38 +238,42 @@ public class ScrollListManager : MonoBehaviour
         }
         else
         {
-            byte[] loadPixels = new byte[texWidth * texHeight * 4];
-
-#if UNITY_WEBGL
-            string file = Application.persistentDataPath + "/Portrait" + key + ".sav";
-            if (File.Exists(file))
-            {
-                loadPixels = System.Convert.FromBase64String(File.ReadAllText(file));
-            }
-            else
+            PageStore.Page saved = PageStore.Read(key);
+            if (saved == null)
             {
                 return null;
             }
-#else
-            if (PlayerPrefs.HasKey(key))
-            {
-                loadPixels = System.Convert.FromBase64String(PlayerPrefs.GetString(key));
-            }
-            else
+
+            TiledCanvas canvas;
+            using (TraceLog.Auto("CanvasPageEncoder.Decode"))
             {
-                return null;
+                canvas = saved.Decode(texWidth, texHeight);
             }
-#endif
 
-            if (loadPixels != null)
+            if (canvas != null)
             {
-                Texture2D tex = new Texture2D(texWidth, texHeight, TextureFormat.RGBA32, false);
+                TraceLog.Begin("Thumbnail Create");
+
+                // thumbnails never need more than the default page resolution
+                int step = Mathf.Max(1, canvas.width / texWidth);
+                int width = (canvas.width + step - 1) / step;
+                int height = (canvas.height + step - 1) / step;
+
+                byte[] thumbPixels = BufferPool<byte>.Rent(width * height * 4);
+                canvas.ReadRaw(thumbPixels, step);
+                canvas.Release();
+
+                Texture2D tex = new Texture2D(width, height, TextureFormat.RGBA32, false);
                 tex.filterMode = FilterMode.Point;
                 tex.wrapMode = TextureWrapMode.Clamp;
-                tex.LoadRawTextureData(loadPixels);
+                NativeArray<byte>.Copy(thumbPixels, tex.GetPixelData<byte>(0), width * height * 4);
                 tex.Apply(false);
 
-                Sprite sp = Sprite.Create(tex, new Rect(0, 0, texWidth, texHeight), Vector2.zero, 100);
+                BufferPool<byte>.Return(thumbPixels);
+
+                Sprite sp = Sprite.Create(tex, new Rect(0, 0, width, height), Vector2.zero, 100);
+
+                TraceLog.End("Thumbnail Create");
 
                 if (allTexturesDic.ContainsKey(key))
                 {
@@ -251,6 +293,131 @@ public class ScrollListManager : MonoBehaviour
         }
     }
 
+    private static long ThumbnailBytes()
+    {
+        long bytes = 0;
+        foreach (Sprite sp in allTexturesDic.Values)
+        {
+            bytes += (long)sp.texture.width * sp.texture.height * 4;
+        }
+        return bytes;
+    }
+
+    // drops the thumbnails of every page that is not the focused one or next to it in an active list,
+    // they are decoded again when the list scrolls back to them
+    private static long ReleaseThumbnails(bool lowMemory)
+    {
+        List<string> release = new List<string>();
+        foreach (string key in allTexturesDic.Keys)
+        {
+            if (!IsThumbnailShown(key)) release.Add(key);
+        }
+
+        long bytes = 0;
+        for (int i = 0; i < release.Count; i++)
+        {
+            Sprite sp = allTexturesDic[release[i]];
+            bytes += (long)sp.texture.width * sp.texture.height * 4;
+
+            for (int l = 0; l < activeLists.Count; l++)
+            {
+                activeLists[l].ClearThumbnail(sp);
+            }
+
+            allTexturesDic.Remove(release[i]);
+            Destroy(sp.texture);
+            Destroy(sp);
+        }
+
+        return bytes;
+    }
+
+    private static bool IsThumbnailShown(string key)
+    {
+        for (int l = 0; l < activeLists.Count; l++)
+        {
+            ScrollListManager list = activeLists[l];
+
+            for (int i = list.currentCharacter - 1; i <= list.currentCharacter + 1; i++)
+            {
+                if (i >= 0 && i < list.transform.childCount && list.saveIndexString + i.ToString() == key) return true;
+            }
+        }
+
+        return false;
+    }
+
+    // the saved pages were replaced (ProgressBackup), shown lists make their thumbnails again, hidden ones when shown
+    public static void ReloadThumbnails()
+    {
+        if (allTexturesDic == null) return;
+
+        foreach (Sprite sp in allTexturesDic.Values)
+        {
+            Destroy(sp.texture);
+            Destroy(sp);
+        }
+        allTexturesDic.Clear();
+
+        for (int l = 0; l < activeLists.Count; l++)
+        {
+            activeLists[l].prefetchedIndex = -1;
+            activeLists[l].LoadAllTexture();
+        }
+    }
+
+    private void ClearThumbnail(Sprite sp)
+    {
+        for (int i = 0; i < transform.childCount; i++)
+        {
+            Image image = transform.GetChild(i).GetComponent<Image>();
+            if (image.sprite == sp) image.sprite = null;
+        }
+    }
+
+    // brings back released thumbnails of the focused page and its neighbours
+    private void RestoreThumbnails()
+    {
+        if (thumbnailCharacter == currentCharacter) return;
+        thumbnailCharacter = currentCharacter;
+
+        for (int i = currentCharacter - 1; i <= currentCharacter + 1; i++)
+        {
+            if (i < 0 || i >= transform.childCount) continue;
+
+            Image image = transform.GetChild(i).GetComponent<Image>();
+            if (image.sprite == null)
+            {
+                image.sprite = LoadImage(saveIndexString + i.ToString());
+            }
+        }
+    }
+
+    // the paint scene can prefetch once it was loaded, until then every page opens through its staged load
+    private void UpdatePrefetch()
+    {
+        bool settled = !lerping && !Input.GetMouseButton(0);
+        prefetchIndex = settled ? currentCharacter : -1;
+
+        if (prefetchIndex < 0 || prefetching || prefetchIndex == prefetchedIndex) return;
+        if (ColoringBookManager.USE == null) return;
+
+        prefetchedIndex = prefetchIndex;
+        StartCoroutine(Prefetch(prefetchIndex));
+    }
+
+    private IEnumerator Prefetch(int index)
+    {
+        prefetching = true;
+
+        yield return ColoringBookManager.USE.PrefetchPage(saveIndexString + index.ToString(), MaskIndex(index), () => prefetchIndex == index);
+
+        prefetching = false;
+
+        // focus moved on before it was done, prefetch it again when it comes back
+        if (prefetchIndex != index) prefetchedIndex = -1;
+    }
+
     // Determining closesst snap point -349 is half distance - 1 and 350 is half distance
     private void SetLerpPositionToClosestSnapPoint()
     {
@@ -397,6 +564,17 @@ public class ScrollListManager : MonoBehaviour
         button.GetComponent<Button>().interactable = false;
     }
 
+    // a list snapping into place or still gliding after a swipe
+    private static bool AnyListMoving()
+    {
+        for (int i = 0; i < activeLists.Count; i++)
+        {
+            ScrollListManager list = activeLists[i];
+            if (list.lerping || list.transform.parent.GetComponent<ScrollRect>().velocity.sqrMagnitude > 1f) return true;
+        }
+        return false;
+    }
+
     private void LateUpdate()
     {
         // If we are holding button than do not lerp
@@ -533,6 +711,9 @@ public class ScrollListManager : MonoBehaviour
             }
         }
 
+        RestoreThumbnails();
+        UpdatePrefetch();
+
         // If we let the mouse button and velocity small enough
         if (lerping)
         {
@@ -599,21 +780,50 @@ public class ScrollListManager : MonoBehaviour
 
     public void LoadGame(int index)
     {
+        // ends when the paint scene draws its first frame
+        TraceLog.Begin("Open Page");
+
         MusicController.USE.PlaySound(MusicController.USE.clickSound);
 
-        PlayerPrefs.SetInt(saveIndexString, index);
-        PlayerPrefs.Save();
+        GameSettings.SetInt(saveIndexString, index);
 
-        if (transform.GetChild(index).childCount > 0)
-        {
-            ColoringBookManager.maskTexIndex = index;
-        }
-        else
+        ColoringBookManager.maskTexIndex = MaskIndex(index);
+        ColoringBookManager.ID = saveIndexString + index.ToString();
+
+        // the first time the paint scene loads and opens the page itself, afterwards it is only shown again
+        using (TraceLog.Auto("Show PaintScene"))
         {
-            ColoringBookManager.maskTexIndex = -1;
+            ResidentScenes.Show("PaintScene");
+
+            if (ColoringBookManager.USE != null)
+            {
+                ColoringBookManager.USE.OpenPage();
+            }
         }
+    }
 
-        ColoringBookManager.ID = saveIndexString + index.ToString();
-        SceneManager.LoadScene("PaintScene");
+    // pages with a mask image as child use the mask of the same index, the others are free paint pages
+    private int MaskIndex(int index)
+    {
+        return transform.GetChild(index).childCount > 0 ? index : -1;
+    }
+
+    // every list of the loaded scenes, hidden ones too, in saveIndexString order
+    public static List<ScrollListManager> AllLists()
+    {
+        List<ScrollListManager> lists = new List<ScrollListManager>(FindObjectsByType<ScrollListManager>(FindObjectsInactive.Include, FindObjectsSortMode.None));
+        lists.Sort((a, b) => string.CompareOrdinal(a.saveIndexString, b.saveIndexString));
+        return lists;
+    }
+
+    public int PageCount
+    {
+        get { return transform.childCount; }
+    }
+
+    // the outline the menu shows over a page, null for free paint pages
+    public Sprite PageMask(int index)
+    {
+        return MaskIndex(index) >= 0 ? transform.GetChild(index).GetChild(0).GetComponent<Image>().sprite : null;
     }
-}
\ No newline at end of file
+}
@@ -0,0 +1,110 @@
+﻿using System;
+using NUnit.Framework;
+
+// A frame's stroke stamped in one pass over its tiles (QueueCircle, QueueLine, DrawQueued) paints the same pixels
+// as stamping its points one after the other, for the pencil and the marker, inside a lock area and on an
+// indexed mask page.
+public class CanvasPainterTests
+{
+    private const int Width = 333;
+    private const int Height = 251;
+
+
+    #region Queued Stamps
+
+    [Test]
+    public void QueuedPencilPaintsLikeSingleStamps([Values(false, true)] bool lockArea, [Values(false, true)] bool indexed)
+    {
+        CheckQueued(false, lockArea, indexed);
+    }
+
+    [Test]
+    public void QueuedMarkerPaintsLikeSingleStamps([Values(false, true)] bool lockArea, [Values(false, true)] bool indexed)
+    {
+        CheckQueued(true, lockArea, indexed);
+    }
+
+    #endregion
+
+
+    #region Helpers
+
+    private static void CheckQueued(bool additive, bool lockArea, bool indexed)
+    {
+        Random random = new Random(3);
+
+        for (int stroke = 0; stroke < 10; stroke++)
+        {
+            CanvasPainter single = Painter(lockArea, indexed);
+            CanvasPainter queued = Painter(lockArea, indexed);
+            single.brushSize = queued.brushSize = 4 + random.Next(30);
+
+            int lastX = random.Next(Width);
+            int lastY = random.Next(Height);
+            if (lockArea)
+            {
+                single.CreateAreaLockMask(lastX, lastY);
+                queued.CreateAreaLockMask(lastX, lastY);
+            }
+
+            uint blank = single.canvas.Checksum();
+
+            for (int i = 0; i < 25; i++)
+            {
+                // now and then off the page
+                int x = i % 9 == 4 ? -20 : lastX + random.Next(-60, 61);
+                int y = lastY + random.Next(-60, 61);
+
+                if (additive) single.DrawAdditiveCircle(x, y);
+                else single.DrawCircle(x, y);
+                queued.QueueCircle(x, y);
+
+                if (Math.Abs(x - lastX) + Math.Abs(y - lastY) > single.brushSize)
+                {
+                    if (additive) single.DrawAdditiveLine(lastX, lastY, x, y);
+                    else single.DrawLine(lastX, lastY, x, y);
+                    queued.QueueLine(lastX, lastY, x, y);
+                }
+
+                // a few frames per stroke
+                if (i % 8 == 7) queued.DrawQueued(additive);
+
+                lastX = x;
+                lastY = y;
+            }
+            queued.DrawQueued(additive);
+
+            Assert.AreNotEqual(blank, single.canvas.Checksum(), "stroke " + stroke + " painted nothing");
+            Assert.AreEqual(single.canvas.Checksum(), queued.canvas.Checksum(), "stroke " + stroke);
+        }
+    }
+
+    // the mask page is a checkerboard of areas with outlines, the indexed one has the paint color in its palette
+    private static CanvasPainter Painter(bool lockArea, bool indexed)
+    {
+        TiledCanvas canvas = new TiledCanvas(Width, Height);
+        if (indexed) canvas.SetPalette(new byte[] { 255, 255, 255, 255, 10, 20, 30, 255, 0, 0, 0, 255 }, 3);
+
+        byte[] mask = null;
+        if (lockArea)
+        {
+            mask = new byte[Width * Height * 4];
+            for (int y = 0; y < Height; y++)
+            {
+                for (int x = 0; x < Width; x++)
+                {
+                    byte value = (x / 37 + y / 29) % 2 == 0 && x % 50 != 7 ? (byte)255 : (byte)0;
+                    int offset = (y * Width + x) * 4;
+                    mask[offset] = mask[offset + 1] = mask[offset + 2] = value;
+                    mask[offset + 3] = 255;
+                }
+            }
+        }
+
+        CanvasPainter painter = new CanvasPainter(canvas, mask);
+        painter.SetColor(10, 20, 30, 255);
+        return painter;
+    }
+
+    #endregion
+}
@@ -0,0 +1,118 @@
+﻿using System.IO;
+using NUnit.Framework;
+using UnityEngine;
+
+// PageImageWriter output read back with Texture2D.LoadImage and compared to the composited page:
+// PNG has to give it back exactly, JPEG close to it. Odd page sizes, so bands, MCUs and tiles don't line up.
+public class PageImageWriterTests
+{
+    private const int Width = 203;
+    private const int Height = 131;
+
+    private TiledCanvas canvas;
+    private byte[] maskPixels;
+
+
+    #region Round Trips
+
+    [Test]
+    public void PngMatchesComposite([Values(1, 3)] int scale)
+    {
+        Color32[] decoded = WriteAndLoad(PageImageWriter.Format.Png, scale);
+        byte[] expected = Composite(scale);
+
+        for (int i = 0; i < decoded.Length; i++)
+        {
+            if (decoded[i].r != expected[i * 4] || decoded[i].g != expected[i * 4 + 1] || decoded[i].b != expected[i * 4 + 2])
+            {
+                Assert.Fail("pixel " + (i % (Width * scale)) + ", " + (i / (Width * scale)) + " differs");
+            }
+        }
+    }
+
+    [Test]
+    public void JpgIsCloseToComposite([Values(1, 3)] int scale)
+    {
+        Color32[] decoded = WriteAndLoad(PageImageWriter.Format.Jpg, scale);
+        byte[] expected = Composite(scale);
+
+        // luma only, the chroma of the random colors is subsampled
+        double error = 0;
+        for (int i = 0; i < decoded.Length; i++)
+        {
+            double y = 0.299 * decoded[i].r + 0.587 * decoded[i].g + 0.114 * decoded[i].b;
+            double e = 0.299 * expected[i * 4] + 0.587 * expected[i * 4 + 1] + 0.114 * expected[i * 4 + 2];
+            error += (y - e) * (y - e);
+        }
+
+        double psnr = 10 * System.Math.Log10(255.0 * 255.0 / (error / decoded.Length));
+        Assert.Greater(psnr, 32.0, "luma PSNR");
+    }
+
+    #endregion
+
+
+    #region Helpers
+
+    [SetUp]
+    public void SetUp()
+    {
+        System.Random random = new System.Random(5);
+
+        canvas = new TiledCanvas(Width, Height);
+        for (int i = 0; i < 40; i++)
+        {
+            canvas.StampCircle(random.Next(Width), random.Next(Height), random.Next(3, 20), (byte)random.Next(256), (byte)random.Next(256), (byte)random.Next(256), 255, null);
+        }
+
+        // an outline grid
+        maskPixels = new byte[Width * Height * 4];
+        for (int y = 0; y < Height; y++)
+        {
+            for (int x = 0; x < Width; x++)
+            {
+                if (x % 37 < 2 || y % 29 < 2) maskPixels[(y * Width + x) * 4 + 3] = 255;
+            }
+        }
+    }
+
+    [TearDown]
+    public void TearDown()
+    {
+        canvas.Release();
+    }
+
+    // bottom row first like the decoded texture
+    private byte[] Composite(int scale)
+    {
+        byte[] rows = new byte[Width * scale * Height * scale * 4];
+        PageCompositor.CompositeScaledRows(canvas, maskPixels, null, scale, 0, Height * scale, rows);
+        return rows;
+    }
+
+    private Color32[] WriteAndLoad(PageImageWriter.Format format, int scale)
+    {
+        byte[] file;
+        using (MemoryStream stream = new MemoryStream())
+        {
+            PageImageWriter.Write(canvas, maskPixels, null, scale, format, 90, stream);
+            file = stream.ToArray();
+        }
+
+        Texture2D texture = new Texture2D(2, 2);
+        try
+        {
+            Assert.IsTrue(texture.LoadImage(file), "file loads");
+            Assert.AreEqual(Width * scale, texture.width, "width");
+            Assert.AreEqual(Height * scale, texture.height, "height");
+
+            return texture.GetPixels32();
+        }
+        finally
+        {
+            Object.Destroy(texture);
+        }
+    }
+
+    #endregion
+}
@@ -0,0 +1,148 @@
+﻿using System;
+using NUnit.Framework;
+
+// A packed page unpacks to the same bytes, and a file that is cut short or damaged unpacks to null instead of
+// a page with zeros at the end.
+public class PagePackerTests
+{
+    private byte[] page;
+
+
+    #region Round Trip
+
+    [Test]
+    public void UnpackGivesBackWhatWasPacked()
+    {
+        byte[] packed = PagePacker.Pack(page, page.Length);
+        Assert.Less(packed.Length, page.Length, "deflated");
+
+        int length;
+        byte[] data = PagePacker.Unpack(packed, out length);
+
+        Assert.IsNotNull(data);
+        Assert.AreEqual(page.Length, length);
+        for (int i = 0; i < length; i++)
+        {
+            if (data[i] != page[i]) Assert.Fail("byte " + i);
+        }
+
+        BufferPool<byte>.Return(data);
+    }
+
+    [Test]
+    public void PackTakesTheLengthNotTheBuffer()
+    {
+        // a pooled buffer is longer than the data in it
+        byte[] pooled = new byte[page.Length + 100];
+        Buffer.BlockCopy(page, 0, pooled, 0, page.Length);
+
+        int length;
+        byte[] data = PagePacker.Unpack(PagePacker.Pack(pooled, page.Length), out length);
+
+        Assert.AreEqual(page.Length, length);
+        BufferPool<byte>.Return(data);
+    }
+
+    [Test]
+    public void EmptyPageRoundTrips()
+    {
+        int length;
+        byte[] data = PagePacker.Unpack(PagePacker.Pack(page, 0), out length);
+
+        Assert.IsNotNull(data);
+        Assert.AreEqual(0, length);
+        BufferPool<byte>.Return(data);
+    }
+
+    #endregion
+
+
+    #region Broken Files
+
+    [Test]
+    public void TruncatedFileIsNull()
+    {
+        byte[] packed = PagePacker.Pack(page, page.Length);
+        Array.Resize(ref packed, packed.Length / 2);
+
+        int length;
+        Assert.IsNull(PagePacker.Unpack(packed, out length));
+        Assert.AreEqual(0, length);
+    }
+
+    [Test]
+    public void DamagedFileIsNull()
+    {
+        byte[] packed = PagePacker.Pack(page, page.Length);
+        for (int i = 4; i < packed.Length; i += 3)
+        {
+            packed[i] ^= 0x5A;
+        }
+
+        int length;
+        Assert.IsNull(PagePacker.Unpack(packed, out length));
+        Assert.AreEqual(0, length);
+    }
+
+    [Test]
+    public void ShortFileIsNull()
+    {
+        int length;
+        Assert.IsNull(PagePacker.Unpack(new byte[] { 16, 0 }, out length));
+        Assert.IsNull(PagePacker.Unpack(new byte[] { 0, 0, 0, 128 }, out length), "negative length");
+    }
+
+    [Test]
+    public void DamagedLengthIsNull()
+    {
+        byte[] packed = PagePacker.Pack(page, page.Length);
+
+        // past any page, and past what the file can hold, refused before renting a buffer that size
+        foreach (int size in new[] { int.MaxValue, 0x70000000, page.Length * 2000 })
+        {
+            int length;
+            Assert.IsNull(PagePacker.Unpack(WithLength(packed, size), out length), "length " + size);
+            Assert.AreEqual(0, length);
+        }
+    }
+
+    [Test]
+    public void WrongLengthIsNull()
+    {
+        byte[] packed = PagePacker.Pack(page, page.Length);
+
+        int length;
+        Assert.IsNull(PagePacker.Unpack(WithLength(packed, page.Length - 1), out length), "one byte short");
+        Assert.IsNull(PagePacker.Unpack(WithLength(packed, page.Length + 1), out length), "one byte more");
+        Assert.IsNull(PagePacker.Unpack(WithLength(packed, 0), out length), "empty");
+    }
+
+    #endregion
+
+
+    #region Helpers
+
+    // a page like the encoder writes: long runs of one colour with some painted bytes in between
+    [SetUp]
+    public void SetUp()
+    {
+        page = new byte[64 * 64 * 4 * 3 + 21];
+        Random random = new Random(7);
+        for (int i = 0; i < page.Length; i++)
+        {
+            page[i] = i % 97 < 60 ? (byte)255 : (byte)random.Next(256);
+        }
+    }
+
+    private static byte[] WithLength(byte[] packed, int size)
+    {
+        byte[] copy = (byte[])packed.Clone();
+        copy[0] = (byte)size;
+        copy[1] = (byte)(size >> 8);
+        copy[2] = (byte)(size >> 16);
+        copy[3] = (byte)(size >> 24);
+        return copy;
+    }
+
+    #endregion
+}
@@ -0,0 +1,141 @@
+﻿using System.Collections;
+using NUnit.Framework;
+using UnityEngine;
+using UnityEngine.TestTools;
+using Is = UnityEngine.TestTools.Constraints.Is;
+
+// Once a stroke, fill or undo has run a few times, running it again must not allocate managed memory:
+// canvas sized buffers, tiles and undo steps all come from BufferPool.
+// The first cycles fill the pools, the checked cycle is the same input again.
+public class PaintAllocationTests
+{
+    private const string PageID = "AllocationTest"; // save key, never one of the real pages
+
+    // -1 is the free page, the others index ColoringBookManager.maskTexList
+    private static readonly int[] Masks = { -1, 0, 7 };
+
+    private const int Pencil = 0;
+    private const int Marker = 1;
+    private const int PaintBucket = 2;
+
+    private const int WarmupCycles = 3;
+
+    private IPaintController paint;
+    private int width;
+    private int height;
+
+
+    #region Cycles
+
+    [UnityTest]
+    public IEnumerator StrokeAndUndo([ValueSource(nameof(Masks))] int mask, [Values(Pencil, Marker)] int drawMode)
+    {
+        yield return OpenPage(mask);
+
+        paint.SelectDrawMode(drawMode);
+        paint.SelectBrushSize(16);
+        paint.SelectColor(1);
+
+        yield return CheckSteadyState(() =>
+        {
+            paint.PointerDown(width / 4, height / 3);
+            for (int i = 1; i <= 8; i++)
+            {
+                paint.PointerMove(width / 4 + i * width / 16, height / 3 + i * height / 32);
+            }
+            paint.PointerUp(width * 3 / 4, height / 2);
+            paint.Undo();
+        });
+    }
+
+    [UnityTest]
+    public IEnumerator FillAndUndo([ValueSource(nameof(Masks))] int mask)
+    {
+        yield return OpenPage(mask);
+
+        paint.SelectDrawMode(PaintBucket);
+        paint.SelectColor(2);
+
+        yield return CheckSteadyState(() =>
+        {
+            paint.PointerDown(width / 3, height / 3);
+            paint.PointerUp(width / 3, height / 3);
+            paint.Undo();
+        });
+    }
+
+    [UnityTest]
+    public IEnumerator UndoAndRedo([ValueSource(nameof(Masks))] int mask)
+    {
+        yield return OpenPage(mask);
+
+        // a few steps to go back and forth over
+        paint.SelectDrawMode(Pencil);
+        paint.SelectBrushSize(24);
+        for (int i = 0; i < 3; i++)
+        {
+            paint.SelectColor(i);
+            paint.PointerDown(width / 5, height * (i + 1) / 5);
+            paint.PointerMove(width * 4 / 5, height * (i + 1) / 5);
+            paint.PointerUp(width * 4 / 5, height * (i + 1) / 5);
+            yield return null;
+        }
+
+        paint.SelectDrawMode(PaintBucket);
+        paint.SelectColor(4);
+        paint.PointerDown(width / 2, height / 2);
+        paint.PointerUp(width / 2, height / 2);
+        yield return null;
+
+        yield return CheckSteadyState(() =>
+        {
+            for (int i = 0; i < 4; i++)
+            {
+                paint.Undo();
+            }
+            for (int i = 0; i < 4; i++)
+            {
+                paint.Redo();
+            }
+        });
+    }
+
+    #endregion
+
+
+    #region Helpers
+
+    [TearDown]
+    public void TearDown()
+    {
+        PlayerPrefs.DeleteKey(PageID);
+    }
+
+    private IEnumerator OpenPage(int mask)
+    {
+        yield return PaintSceneFixture.OpenPage(mask, PageID, opened => paint = opened);
+
+        width = paint.Canvas.width;
+        height = paint.Canvas.height;
+    }
+
+    // runs cycle until the pools hold what it needs, a frame after each so the texture upload happens as well,
+    // then checks one more run of it
+    private IEnumerator CheckSteadyState(TestDelegate cycle)
+    {
+        for (int i = 0; i < WarmupCycles; i++)
+        {
+            cycle();
+            yield return null;
+        }
+
+        uint before = paint.Canvas.Checksum();
+
+        Assert.That(cycle, Is.Not.AllocatingGCMemory());
+
+        // the cycle leaves the page as it found it, so every run does the same work
+        Assert.AreEqual(before, paint.Canvas.Checksum(), "page after the cycle");
+    }
+
+    #endregion
+}
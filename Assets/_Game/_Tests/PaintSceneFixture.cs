@@ -0,0 +1,41 @@
+﻿using System;
+using System.Collections;
+using System.Linq;
+using UnityEngine;
+using UnityEngine.SceneManagement;
+
+// Opens PaintScene on a test page for the tests that paint through IPaintController.
+public static class PaintSceneFixture
+{
+    // mask -1 is the free page, the others index ColoringBookManager.maskTexList; pageID is the save key, emptied
+    // first so every test starts on a blank page. opened gets the controller once the page takes input
+    public static IEnumerator OpenPage(int mask, string pageID, Action<IPaintController> opened)
+    {
+        PlayerPrefs.DeleteKey(pageID);
+
+        // test assemblies can not reference Assembly-CSharp, the page is picked like ScrollListManager does, through the statics
+        Type manager = Type.GetType("ColoringBookManager, Assembly-CSharp");
+        manager.GetField("maskTexIndex").SetValue(null, mask);
+        manager.GetField("ID").SetValue(null, pageID);
+
+        yield return SceneManager.LoadSceneAsync("PaintScene");
+
+        IPaintController paint = FindController();
+        yield return WaitUntilReady(paint);
+        opened(paint);
+    }
+
+    public static IPaintController FindController()
+    {
+        return UnityEngine.Object.FindObjectsByType<MonoBehaviour>(FindObjectsSortMode.None).OfType<IPaintController>().Single();
+    }
+
+    // Start picks the default tools, the saved page loads over the next frames
+    public static IEnumerator WaitUntilReady(IPaintController paint)
+    {
+        while (!paint.Ready)
+        {
+            yield return null;
+        }
+    }
+}
@@ -0,0 +1,532 @@
+﻿using System;
+using System.Collections;
+using System.Collections.Generic;
+using System.IO;
+using NUnit.Framework;
+using Unity.PerformanceTesting;
+using Unity.Profiling;
+using UnityEngine;
+using UnityEngine.SceneManagement;
+using UnityEngine.TestTools;
+
+// PaintScene driven by scripted input: frame times (Measure.Frames), single operations (Measure.Method)
+// and GC allocations per frame, on the free page and a few mask pages.
+// Every scenario ends with the page checksum, compared with PaintSceneChecksums.txt, so a faster version has to
+// paint exactly the same pixels. A scenario without an entry there fails; with RecordChecksumsVariable set to 1 the
+// missing entries are written instead, run that once on the code to pin and commit the file.
+//
+// headless on Linux:
+// Unity -batchmode -nographics -projectPath . -runTests -testPlatform PlayMode -testResults results.xml -perfTestResults perf.json
+public class PaintScenePerformanceTests
+{
+    private const string PageID = "PerformanceTest"; // save key, never one of the real pages
+    private const string ChecksumFile = "_Game/_Tests/PaintSceneChecksums.txt";
+    private const string RecordChecksumsVariable = "PAINTSCENE_RECORD_CHECKSUMS";
+
+    // -1 is the free page, the others index ColoringBookManager.maskTexList
+    private static readonly int[] Masks = { -1, 0, 7, 15 };
+
+    private const int Pencil = 0;
+    private const int Marker = 1;
+    private const int PaintBucket = 2;
+    private const int Sticker = 3;
+
+    private const string UploadMarker = "CanvasTexture.Upload"; // CanvasTexture.UploadMarkerName
+    private const int UploadFrameCount = 4; // a test page is staged in up to three frames of 64 tiles, and one shows it
+
+    private static readonly SampleGroup GcAllocations = new SampleGroup("GC.Alloc.Count", SampleUnit.Undefined);
+    private static readonly SampleGroup ChecksumSample = new SampleGroup("Checksum", SampleUnit.Undefined, false);
+    private static readonly SampleGroup FirstFrame = new SampleGroup("First Frame", SampleUnit.Millisecond);
+    private static readonly SampleGroup PageReady = new SampleGroup("Page Ready", SampleUnit.Millisecond);
+
+    private IPaintController paint;
+    private ProfilerRecorder gcAllocCount;
+    private ProfilerRecorder uploadTime;
+    private int width;
+    private int height;
+
+
+    #region Scenarios
+
+    [UnityTest, Performance]
+    public IEnumerator Strokes([ValueSource(nameof(Masks))] int mask)
+    {
+        yield return OpenPage(mask);
+
+        using (Measure.Frames().Scope())
+        {
+            int color = 0;
+            foreach (int drawMode in new[] { Pencil, Marker })
+            {
+                paint.SelectDrawMode(drawMode);
+
+                foreach (int brushSize in new[] { 8, 16, 24 })
+                {
+                    paint.SelectBrushSize(brushSize);
+                    paint.SelectColor(color++ % 8);
+
+                    // one stroke across the page, one inside an area
+                    yield return Stroke(0.1f, 0.1f + brushSize * 0.01f, 0.9f, 0.8f - brushSize * 0.01f, 40);
+                    yield return Stroke(0.45f, 0.45f, 0.55f, 0.5f, 10);
+                }
+            }
+        }
+
+        paint.SelectDrawMode(Pencil);
+        paint.SelectBrushSize(16);
+        Measure.Method(() =>
+        {
+            paint.PointerDown(width / 2, height / 2);
+            paint.PointerMove(width / 2 + 40, height / 2 + 20);
+            paint.PointerUp(width / 2 + 40, height / 2 + 20);
+        }).SampleGroup("Stroke").WarmupCount(5).MeasurementCount(20).GC().Run();
+
+        CheckOutput("Strokes", mask);
+    }
+
+    [UnityTest, Performance]
+    public IEnumerator Fills([ValueSource(nameof(Masks))] int mask)
+    {
+        yield return OpenPage(mask);
+
+        paint.SelectDrawMode(PaintBucket);
+
+        using (Measure.Frames().Scope())
+        {
+            for (int i = 0; i < 12; i++)
+            {
+                paint.SelectColor(i % 8);
+                yield return Tap(0.15f + 0.7f * (i % 3) / 2f, 0.15f + 0.7f * (i / 3) / 3f);
+            }
+        }
+
+        int color = 0;
+        Measure.Method(() =>
+        {
+            // a different color every time, filling with the color under the point does nothing
+            paint.SelectColor(color++ % 2);
+            paint.PointerDown(width / 3, height / 3);
+            paint.PointerUp(width / 3, height / 3);
+        }).SampleGroup("Fill").WarmupCount(2).MeasurementCount(10).GC().Run();
+
+        CheckOutput("Fills", mask);
+    }
+
+    [UnityTest, Performance]
+    public IEnumerator Stickers([ValueSource(nameof(Masks))] int mask)
+    {
+        yield return OpenPage(mask);
+
+        paint.SelectDrawMode(Sticker);
+
+        using (Measure.Frames().Scope())
+        {
+            for (int i = 0; i < 10; i++)
+            {
+                paint.SelectSticker(i);
+                yield return Tap(0.1f + 0.2f * (i % 5), 0.25f + 0.5f * (i / 5));
+            }
+        }
+
+        paint.SelectSticker(0);
+        Measure.Method(() =>
+        {
+            paint.PointerDown(width / 2, height / 2);
+            paint.PointerUp(width / 2, height / 2);
+        }).SampleGroup("Sticker").WarmupCount(5).MeasurementCount(20).GC().Run();
+
+        CheckOutput("Stickers", mask);
+    }
+
+    [UnityTest, Performance]
+    public IEnumerator UndoRedo([ValueSource(nameof(Masks))] int mask)
+    {
+        yield return OpenPage(mask);
+
+        yield return PaintSomething();
+        uint painted = paint.Canvas.Checksum();
+
+        using (Measure.Frames().Scope())
+        {
+            for (int i = 0; i < 6; i++)
+            {
+                paint.Undo();
+                yield return Frame();
+            }
+
+            for (int i = 0; i < 6; i++)
+            {
+                paint.Redo();
+                yield return Frame();
+            }
+        }
+
+        Assert.AreEqual(painted, paint.Canvas.Checksum(), "undo all, redo all");
+
+        Measure.Method(() =>
+        {
+            paint.Undo();
+            paint.Redo();
+        }).SampleGroup("Undo Redo").WarmupCount(5).MeasurementCount(20).GC().Run();
+
+        CheckOutput("UndoRedo", mask);
+    }
+
+    [UnityTest, Performance]
+    public IEnumerator Clear([ValueSource(nameof(Masks))] int mask)
+    {
+        yield return OpenPage(mask);
+
+        uint blank = paint.Canvas.Checksum();
+        yield return PaintSomething();
+
+        using (Measure.Frames().Scope())
+        {
+            paint.Clear();
+            yield return Frame();
+            yield return Frame();
+        }
+
+        Assert.AreEqual(blank, paint.Canvas.Checksum(), "cleared page");
+
+        // undo brings the painting back, the checksum is that of the painted page
+        paint.Undo();
+        yield return Frame();
+
+        Measure.Method(() =>
+        {
+            paint.Clear();
+            paint.Undo();
+        }).SampleGroup("Clear Undo").WarmupCount(2).MeasurementCount(10).GC().Run();
+
+        CheckOutput("Clear", mask);
+    }
+
+    [UnityTest, Performance]
+    public IEnumerator SaveLoad([ValueSource(nameof(Masks))] int mask)
+    {
+        yield return OpenPage(mask);
+
+        yield return PaintSomething();
+        uint painted = paint.Canvas.Checksum();
+
+        Measure.Method(() => paint.Save()).SampleGroup("Save").WarmupCount(2).MeasurementCount(10).GC().Run();
+        Measure.Method(() => paint.Reload()).SampleGroup("Load").WarmupCount(2).MeasurementCount(10).GC().Run();
+
+        using (Measure.Frames().Scope())
+        {
+            yield return Frame();
+            yield return Frame();
+        }
+
+        Assert.AreEqual(painted, paint.Canvas.Checksum(), "reloaded page");
+
+        CheckOutput("SaveLoad", mask);
+    }
+
+    [UnityTest, Performance]
+    public IEnumerator Replay([ValueSource(nameof(Masks))] int mask)
+    {
+        yield return OpenPage(mask);
+
+        paint.Recording = InputLog.Begin(paint.Canvas, mask);
+        yield return PaintSomething();
+        paint.Undo();
+        yield return Stroke(0.3f, 0.5f, 0.6f, 0.55f, 10);
+
+        InputLog recorded = paint.Recording;
+        paint.Recording = null;
+        recorded.Finish(paint.Canvas);
+
+        // replayed from the file format, as fast as possible
+        InputLog log = InputLog.Decode(recorded.Encode());
+        Assert.IsNotNull(log, "decoded log");
+        Assert.AreEqual(recorded.events.Count, log.events.Count, "decoded events");
+
+        Measure.Method(() => log.Replay(paint)).SampleGroup("Replay").WarmupCount(1).MeasurementCount(5).GC().Run();
+
+        Assert.AreEqual(recorded.checksum, paint.Canvas.Checksum(), "replayed page");
+
+        CheckOutput("Replay", mask);
+    }
+
+    // pointer sample to the frame that shows it (StrokeLatency), strokes at one sample per frame and fills;
+    // compare the percentiles between changes. Needs a graphics device, without one no frame is presented.
+    [UnityTest, Performance]
+    public IEnumerator Latency([ValueSource(nameof(Masks))] int mask)
+    {
+        yield return OpenPage(mask);
+
+        StrokeLatency.Start();
+        StrokeLatency.Clear();
+
+        paint.SelectDrawMode(Pencil);
+        paint.SelectBrushSize(16);
+        paint.SelectColor(1);
+        yield return Stroke(0.1f, 0.2f, 0.9f, 0.7f, 40);
+        yield return Stroke(0.5f, 0.1f, 0.4f, 0.9f, 40);
+
+        paint.SelectDrawMode(PaintBucket);
+        for (int i = 0; i < 6; i++)
+        {
+            paint.SelectColor(i % 8);
+            yield return Tap(0.2f + 0.3f * (i % 3), 0.3f + 0.4f * (i / 3));
+        }
+
+        // the last samples reach the screen
+        yield return null;
+        yield return null;
+
+        if (StrokeLatency.Count == 0)
+        {
+            Assert.Ignore("no frame was presented");
+        }
+
+        foreach (StrokeLatency.Stage stage in new[] { StrokeLatency.Stage.Paint, StrokeLatency.Stage.Upload, StrokeLatency.Stage.Present })
+        {
+            foreach (int percentile in new[] { 50, 95, 99 })
+            {
+                SampleGroup group = new SampleGroup("Latency " + stage + " p" + percentile, SampleUnit.Millisecond);
+                Measure.Custom(group, StrokeLatency.Percentile(stage, percentile / 100.0));
+            }
+        }
+
+        Debug.Log(StrokeLatency.Summary());
+    }
+
+    // scene load to the first frame (toolbar and mask) and to the saved page taking input, the first should stay under 100 ms
+    [UnityTest, Performance]
+    public IEnumerator Open([ValueSource(nameof(Masks))] int mask)
+    {
+        yield return OpenPage(mask);
+
+        // a painted page, so the decode stage has work
+        yield return PaintSomething();
+        paint.Save();
+        uint painted = paint.Canvas.Checksum();
+
+        for (int i = 0; i < 5; i++)
+        {
+            float start = Time.realtimeSinceStartup;
+            yield return SceneManager.LoadSceneAsync("PaintScene");
+            yield return null;
+            Measure.Custom(FirstFrame, (Time.realtimeSinceStartup - start) * 1000);
+
+            paint = PaintSceneFixture.FindController();
+            yield return PaintSceneFixture.WaitUntilReady(paint);
+            Measure.Custom(PageReady, (Time.realtimeSinceStartup - start) * 1000);
+        }
+
+        Assert.AreEqual(painted, paint.Canvas.Checksum(), "opened page");
+    }
+
+    // the page upload of a page open and of undoing a fill, through GPU copies (copyTexture) and the way devices
+    // without CopyTexture upload. "Upload" is the CanvasTexture.Upload marker (CPU, staging writes included), "Frames"
+    // the time of the frames the upload takes, where the GPU waits show. Run on the device before and after a change
+    // of CanvasTexture and compare; the editor only shows the CPU side.
+    [UnityTest, Performance]
+    public IEnumerator Upload([ValueSource(nameof(Masks))] int mask, [Values(true, false)] bool copyTexture)
+    {
+        SetCopyTexture(copyTexture);
+        yield return OpenPage(mask);
+
+        uploadTime = ProfilerRecorder.StartNew(ProfilerCategory.Render, UploadMarker);
+
+        yield return PaintSomething();
+        paint.Save();
+
+        // every tile of the page goes up
+        for (int i = 0; i < 5; i++)
+        {
+            paint.Reload();
+            yield return UploadFrames("Open");
+        }
+
+        // the tiles of the filled area; a color PaintSomething does not use, so every fill changes the page
+        paint.SelectDrawMode(PaintBucket);
+        paint.SelectColor(5);
+        for (int i = 0; i < 5; i++)
+        {
+            yield return Tap(0.5f, 0.5f);
+
+            paint.Undo();
+            yield return UploadFrames("Undo Fill");
+        }
+
+        CheckOutput("Upload", mask);
+    }
+
+    #endregion
+
+
+    #region Scripted Input
+
+    [TearDown]
+    public void TearDown()
+    {
+        gcAllocCount.Dispose();
+        uploadTime.Dispose();
+        SetCopyTexture(true);
+        StrokeLatency.Stop();
+        PlayerPrefs.DeleteKey(PageID);
+    }
+
+    private IEnumerator OpenPage(int mask)
+    {
+        yield return PaintSceneFixture.OpenPage(mask, PageID, opened => paint = opened);
+
+        width = paint.Canvas.width;
+        height = paint.Canvas.height;
+
+        gcAllocCount = ProfilerRecorder.StartNew(ProfilerCategory.Memory, "GC Allocation In Frame Count");
+    }
+
+    private IEnumerator Frame()
+    {
+        yield return null;
+
+        if (gcAllocCount.Valid)
+        {
+            Measure.Custom(GcAllocations, gcAllocCount.LastValue);
+        }
+    }
+
+    // upload marker and frame times over the frames an upload started this frame takes
+    private IEnumerator UploadFrames(string operation)
+    {
+        double upload = 0;
+        double frames = 0;
+
+        for (int i = 0; i < UploadFrameCount; i++)
+        {
+            float start = Time.realtimeSinceStartup;
+            yield return null;
+            frames += (Time.realtimeSinceStartup - start) * 1000;
+
+            // the marker of the frame that just ended
+            if (uploadTime.Valid) upload += uploadTime.LastValue / 1e6;
+        }
+
+        Measure.Custom(new SampleGroup(operation + " Upload", SampleUnit.Millisecond), upload);
+        Measure.Custom(new SampleGroup(operation + " Frames", SampleUnit.Millisecond), frames);
+    }
+
+    // the next PaintScene makes its page texture with or without GPU copies (CanvasTexture.useCopyTexture)
+    private static void SetCopyTexture(bool value)
+    {
+        Type.GetType("CanvasTexture, Assembly-CSharp").GetField("useCopyTexture").SetValue(null, value);
+    }
+
+    // page position from 0..1
+    private int X(float u)
+    {
+        return Mathf.Clamp((int)(u * width), 0, width - 1);
+    }
+
+    private int Y(float v)
+    {
+        return Mathf.Clamp((int)(v * height), 0, height - 1);
+    }
+
+    // one pointer move per frame, like a finger
+    private IEnumerator Stroke(float u0, float v0, float u1, float v1, int steps)
+    {
+        paint.PointerDown(X(u0), Y(v0));
+        yield return Frame();
+
+        for (int i = 1; i <= steps; i++)
+        {
+            float t = i / (float)steps;
+            paint.PointerMove(X(Mathf.Lerp(u0, u1, t)), Y(Mathf.Lerp(v0, v1, t)));
+            yield return Frame();
+        }
+
+        paint.PointerUp(X(u1), Y(v1));
+        yield return Frame();
+    }
+
+    private IEnumerator Tap(float u, float v)
+    {
+        paint.PointerDown(X(u), Y(v));
+        yield return Frame();
+
+        paint.PointerUp(X(u), Y(v));
+        yield return Frame();
+    }
+
+    // six undo steps: pencil, marker, fill and sticker
+    private IEnumerator PaintSomething()
+    {
+        paint.SelectDrawMode(Pencil);
+        paint.SelectBrushSize(16);
+        paint.SelectColor(1);
+        yield return Stroke(0.2f, 0.2f, 0.8f, 0.3f, 20);
+        yield return Stroke(0.5f, 0.1f, 0.5f, 0.9f, 20);
+
+        paint.SelectDrawMode(Marker);
+        paint.SelectColor(4);
+        yield return Stroke(0.1f, 0.6f, 0.9f, 0.6f, 20);
+
+        paint.SelectDrawMode(PaintBucket);
+        paint.SelectColor(2);
+        yield return Tap(0.3f, 0.7f);
+        yield return Tap(0.7f, 0.4f);
+
+        paint.SelectDrawMode(Sticker);
+        paint.SelectSticker(3);
+        yield return Tap(0.6f, 0.8f);
+    }
+
+    #endregion
+
+
+    #region Checksums
+
+    private void CheckOutput(string scenario, int mask)
+    {
+        uint checksum = paint.Canvas.Checksum();
+        Measure.Custom(ChecksumSample, checksum);
+
+        string key = scenario + " " + mask;
+        string path = Path.Combine(Application.dataPath, ChecksumFile);
+        Dictionary<string, string> expected = ReadChecksums(path);
+        string actual = checksum.ToString("X8");
+
+        string stored;
+        if (expected.TryGetValue(key, out stored))
+        {
+            Assert.AreEqual(stored, actual, key + ": painted pixels changed");
+        }
+        else if (Environment.GetEnvironmentVariable(RecordChecksumsVariable) == "1")
+        {
+            File.AppendAllText(path, key + " " + actual + "\n");
+            Debug.Log("Recorded checksum " + key + " " + actual);
+        }
+        else
+        {
+            Assert.Fail(key + ": no checksum in " + ChecksumFile + " (" + actual + "), record it with " + RecordChecksumsVariable + "=1 on the code to compare with");
+        }
+    }
+
+    private static Dictionary<string, string> ReadChecksums(string path)
+    {
+        Dictionary<string, string> checksums = new Dictionary<string, string>();
+        if (!File.Exists(path)) return checksums;
+
+        foreach (string line in File.ReadAllLines(path))
+        {
+            if (line.Length == 0 || line[0] == '#') continue;
+
+            // scenario, mask index, checksum
+            string[] parts = line.Split(' ');
+            if (parts.Length == 3)
+            {
+                checksums[parts[0] + " " + parts[1]] = parts[2];
+            }
+        }
+
+        return checksums;
+    }
+
+    #endregion
+}
@@ -0,0 +1,98 @@
+﻿using System.Collections.Generic;
+using System.IO;
+using NUnit.Framework;
+
+// A backup read back gives the same settings and pages in the same order, and a file that is no backup
+// or ends early is refused instead of restoring part of it as pages.
+public class ProgressArchiveTests
+{
+    private List<byte[]> pages;
+
+
+    #region Round Trip
+
+    [Test]
+    public void ReadGivesBackWhatWasWritten()
+    {
+        byte[] archive = Write();
+
+        List<string> settings = new List<string>();
+        List<string> keys = new List<string>();
+        List<byte[]> read = new List<byte[]>();
+
+        bool ok = ProgressArchive.Read(new MemoryStream(archive), (key, value) => settings.Add(key + "=" + value), (key, page, length) =>
+        {
+            // the buffer is pooled, it has to be copied
+            byte[] copy = new byte[length];
+            System.Buffer.BlockCopy(page, 0, copy, 0, length);
+            keys.Add(key);
+            read.Add(copy);
+        });
+
+        Assert.IsTrue(ok, "archive");
+        CollectionAssert.AreEqual(new[] { "Theme=2", "ColoringList=5" }, settings);
+        Assert.AreEqual(pages.Count, read.Count, "pages");
+
+        for (int i = 0; i < pages.Count; i++)
+        {
+            Assert.AreEqual("ColoringList" + i, keys[i]);
+            CollectionAssert.AreEqual(pages[i], read[i], "page " + i);
+        }
+    }
+
+    [Test]
+    public void OtherFilesAreNoArchive()
+    {
+        byte[] saved = pages[0];
+        Assert.IsFalse(ProgressArchive.Read(new MemoryStream(saved), (key, value) => Assert.Fail(), (key, page, length) => Assert.Fail()));
+    }
+
+    [Test]
+    public void TruncatedArchiveThrows()
+    {
+        byte[] archive = Write();
+
+        Assert.Catch(() => ProgressArchive.Read(new MemoryStream(archive, 0, archive.Length / 2), (key, value) => { }, (key, page, length) => { }));
+    }
+
+    #endregion
+
+
+    #region Helpers
+
+    [SetUp]
+    public void SetUp()
+    {
+        System.Random random = new System.Random(7);
+        TiledCanvas canvas = new TiledCanvas(300, 200);
+
+        // each page a few more circles than the one before, the first one blank
+        pages = new List<byte[]>();
+        for (int i = 0; i < 6; i++)
+        {
+            pages.Add(CanvasPageEncoder.Encode(canvas));
+            canvas.StampCircle(random.Next(300), random.Next(200), random.Next(5, 40), (byte)random.Next(256), (byte)random.Next(256), (byte)random.Next(256), 255, null);
+        }
+
+        canvas.Release();
+    }
+
+    private byte[] Write()
+    {
+        using (MemoryStream stream = new MemoryStream())
+        {
+            ProgressArchive.Writer writer = new ProgressArchive.Writer(stream);
+            writer.WriteSetting("Theme", 2);
+            writer.WriteSetting("ColoringList", 5);
+            for (int i = 0; i < pages.Count; i++)
+            {
+                writer.WritePage("ColoringList" + i, pages[i], pages[i].Length);
+            }
+            writer.Finish();
+
+            return stream.ToArray();
+        }
+    }
+
+    #endregion
+}
@@ -0,0 +1,154 @@
+﻿using System;
+using NUnit.Framework;
+
+// A stroke read once per frame along a circle: without spacing the batch is the samples, with it the filled
+// points follow the circle much closer than the straight lines between the samples, and the gaps stay small.
+public class StrokeBatchTests
+{
+    private const float Radius = 200f;
+    private const int SamplesPerTurn = 12; // a fast circle at a low frame rate
+    private const float Spacing = 8f;
+
+    private StrokeBatch batch;
+
+
+    #region Samples
+
+    [Test]
+    public void WithoutSpacingTheBatchIsTheSamples()
+    {
+        batch.Add(110f, 100f);
+        batch.Add(110.5f, 100.5f); // less than a pixel, merged
+        batch.Add(130f, 100f);
+
+        Assert.AreEqual(2, batch.Count);
+        Assert.AreEqual(110f, batch.X(0));
+        Assert.AreEqual(130f, batch.X(1));
+
+        batch.Clear();
+        Assert.AreEqual(0, batch.Count);
+    }
+
+    [Test]
+    public void RepeatedSamplesArePaintedAgain()
+    {
+        batch.repeatSamples = true;
+        batch.spacing = Spacing;
+
+        // a marker resting on the start of the stroke for two frames
+        batch.Add(X(0), Y(0));
+        batch.Add(X(0) + 0.5f, Y(0));
+        Assert.AreEqual(2, batch.Count);
+        Assert.AreEqual(X(0), batch.X(0));
+
+        // the rest does not bend the stroke after it
+        StrokeBatch moved = new StrokeBatch();
+        moved.spacing = Spacing;
+        moved.Begin(X(0), Y(0));
+
+        batch.Clear();
+        batch.Add(X(1), Y(1));
+        moved.Add(X(1), Y(1));
+
+        Assert.AreEqual(moved.Count, batch.Count);
+        for (int i = 0; i < batch.Count; i++)
+        {
+            Assert.AreEqual(moved.X(i), batch.X(i), 0.001);
+            Assert.AreEqual(moved.Y(i), batch.Y(i), 0.001);
+        }
+    }
+
+    [Test]
+    public void FilledPointsFollowTheCurve()
+    {
+        batch.spacing = Spacing;
+
+        double chordError = Radius * (1 - Math.Cos(Math.PI / SamplesPerTurn));
+        double worst = 0;
+
+        for (int i = 1; i <= SamplesPerTurn; i++)
+        {
+            batch.Add(X(i), Y(i));
+
+            // the first segment has no sample before it to bend with
+            if (i == 1)
+            {
+                batch.Clear();
+                continue;
+            }
+
+            Assert.AreEqual(X(i), batch.X(batch.Count - 1), 0.001, "the batch ends at the sample");
+
+            for (int j = 0; j < batch.Count; j++)
+            {
+                double distance = Math.Sqrt((batch.X(j) - 500) * (batch.X(j) - 500) + (batch.Y(j) - 500) * (batch.Y(j) - 500));
+                worst = Math.Max(worst, Math.Abs(distance - Radius));
+            }
+
+            batch.Clear();
+        }
+
+        Assert.Less(worst, chordError / 4, "off the circle");
+    }
+
+    [Test]
+    public void GapsStayNearTheSpacing()
+    {
+        batch.spacing = Spacing;
+
+        float lastX = X(0), lastY = Y(0);
+        for (int i = 1; i <= SamplesPerTurn; i++)
+        {
+            batch.Add(X(i), Y(i));
+
+            for (int j = 0; j < batch.Count; j++)
+            {
+                float dx = batch.X(j) - lastX;
+                float dy = batch.Y(j) - lastY;
+                Assert.Less(Math.Sqrt(dx * dx + dy * dy), Spacing * 1.5, "gap before point " + j + " of sample " + i);
+
+                lastX = batch.X(j);
+                lastY = batch.Y(j);
+            }
+
+            batch.Clear();
+        }
+    }
+
+    [Test]
+    public void BreakDoesNotFillAcrossTheGap()
+    {
+        batch.spacing = Spacing;
+        batch.Begin(195f, 100f);
+
+        batch.Add(200f, 100f);
+        batch.Break();
+        batch.Add(400f, 100f);
+
+        Assert.AreEqual(2, batch.Count);
+    }
+
+    #endregion
+
+
+    #region Helpers
+
+    [SetUp]
+    public void SetUp()
+    {
+        batch = new StrokeBatch();
+        batch.Begin(X(0), Y(0));
+    }
+
+    private static float X(int sample)
+    {
+        return 500 + Radius * (float)Math.Cos(2 * Math.PI * sample / SamplesPerTurn);
+    }
+
+    private static float Y(int sample)
+    {
+        return 500 + Radius * (float)Math.Sin(2 * Math.PI * sample / SamplesPerTurn);
+    }
+
+    #endregion
+}
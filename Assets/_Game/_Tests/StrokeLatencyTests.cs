@@ -0,0 +1,113 @@
+﻿using System.Diagnostics;
+using System.IO;
+using NUnit.Framework;
+
+// Samples take the stamps of the stage they wait for, the samples of one frame share them, and the percentiles
+// are read from the finished samples only. Stamps are made up in milliseconds, converted to Stopwatch ticks.
+public class StrokeLatencyTests
+{
+    #region Stages
+
+    [Test]
+    public void SamplesOfAFrameShareTheirStages()
+    {
+        // two samples read in the frame, painted at 12, uploaded at 14, on screen at 30
+        StrokeLatency.Input(Ticks(0));
+        StrokeLatency.Input(Ticks(4));
+        StrokeLatency.Painted(Ticks(12));
+        StrokeLatency.Uploaded(Ticks(14));
+        StrokeLatency.Presented(Ticks(30));
+
+        Assert.AreEqual(2, StrokeLatency.Count);
+        Assert.AreEqual(26, StrokeLatency.Percentile(StrokeLatency.Stage.Present, 0.5), 0.01);
+        Assert.AreEqual(30, StrokeLatency.Percentile(StrokeLatency.Stage.Present, 1), 0.01);
+        Assert.AreEqual(8, StrokeLatency.Percentile(StrokeLatency.Stage.Paint, 0.5), 0.01);
+        Assert.AreEqual(10, StrokeLatency.Percentile(StrokeLatency.Stage.Upload, 0.5), 0.01);
+    }
+
+    [Test]
+    public void UnfinishedSamplesAreNotCounted()
+    {
+        StrokeLatency.Input(Ticks(0));
+        StrokeLatency.Painted(Ticks(5));
+        StrokeLatency.Uploaded(Ticks(6));
+        StrokeLatency.Presented(Ticks(20));
+
+        // painted, the upload waits for the next frame
+        StrokeLatency.Input(Ticks(16));
+        StrokeLatency.Painted(Ticks(20));
+        StrokeLatency.Presented(Ticks(36));
+
+        Assert.AreEqual(1, StrokeLatency.Count);
+        Assert.AreEqual(20, StrokeLatency.Percentile(StrokeLatency.Stage.Present, 0.99), 0.01);
+
+        StrokeLatency.Uploaded(Ticks(40));
+        StrokeLatency.Presented(Ticks(52));
+
+        Assert.AreEqual(2, StrokeLatency.Count);
+        Assert.AreEqual(36, StrokeLatency.Percentile(StrokeLatency.Stage.Present, 0.99), 0.01);
+    }
+
+    [Test]
+    public void PercentilesOfAHundredFrames()
+    {
+        // frame i takes i + 1 ms from input to screen
+        for (int i = 0; i < 100; i++)
+        {
+            double start = i * 200;
+            StrokeLatency.Input(Ticks(start));
+            StrokeLatency.Painted(Ticks(start));
+            StrokeLatency.Uploaded(Ticks(start));
+            StrokeLatency.Presented(Ticks(start + i + 1));
+        }
+
+        Assert.AreEqual(50, StrokeLatency.Percentile(StrokeLatency.Stage.Present, 0.5), 0.01);
+        Assert.AreEqual(95, StrokeLatency.Percentile(StrokeLatency.Stage.Present, 0.95), 0.01);
+        Assert.AreEqual(99, StrokeLatency.Percentile(StrokeLatency.Stage.Present, 0.99), 0.01);
+    }
+
+    [Test]
+    public void WriteHasARowPerSample()
+    {
+        for (int i = 0; i < 3; i++)
+        {
+            StrokeLatency.Input(Ticks(i * 16));
+            StrokeLatency.Painted(Ticks(i * 16 + 2));
+            StrokeLatency.Uploaded(Ticks(i * 16 + 3));
+            StrokeLatency.Presented(Ticks(i * 16 + 20));
+        }
+
+        StringWriter writer = new StringWriter();
+        StrokeLatency.Write(writer, "Test Device");
+        string[] lines = writer.ToString().TrimEnd('\n').Split('\n');
+
+        Assert.AreEqual("# Test Device", lines[0]);
+        Assert.AreEqual("input,painted,uploaded,presented", lines[2]);
+        Assert.AreEqual(3 + 3, lines.Length);
+    }
+
+    #endregion
+
+
+    #region Helpers
+
+    [SetUp]
+    public void SetUp()
+    {
+        StrokeLatency.Start();
+        StrokeLatency.Clear();
+    }
+
+    [TearDown]
+    public void TearDown()
+    {
+        StrokeLatency.Stop();
+    }
+
+    private static long Ticks(double ms)
+    {
+        return (long)(ms * Stopwatch.Frequency / 1000);
+    }
+
+    #endregion
+}
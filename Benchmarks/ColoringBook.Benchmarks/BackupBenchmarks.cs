@@ -0,0 +1,76 @@
+using System;
+using System.Collections.Generic;
+using System.IO;
+using BenchmarkDotNet.Attributes;
+
+// Backup and restore (ProgressArchive) of 100 saved mask pages, from a few filled cells to all of them.
+// Restore stores the pages as Base64 text like PlayerPrefs, which is most of its time and memory.
+[MemoryDiagnoser]
+public class BackupBenchmarks
+{
+    public const int Pages = 100;
+
+    private const int Width = 576;
+    private const int Height = 1024;
+
+    private List<byte[]> pages = new List<byte[]>();
+    private byte[] archive;
+    private Dictionary<string, string> store = new Dictionary<string, string>();
+
+    [GlobalSetup]
+    public void Setup()
+    {
+        PaintKernels.DisableNative();
+
+        TiledCanvas canvas = new TiledCanvas(Width, Height);
+        canvas.SetPalette(PageBenchmark.Palette, PageBenchmark.Palette.Length / 4);
+        CanvasPainter painter = new CanvasPainter(canvas, PageBenchmark.CreateOutlines(Width, Height));
+
+        // one more cell filled on every page
+        int cells = PageBenchmark.CellsX * PageBenchmark.CellsY;
+        for (int i = 0; i < Pages; i++)
+        {
+            int cell = i % cells;
+            int x = (cell % PageBenchmark.CellsX * 2 + 1) * Width / (PageBenchmark.CellsX * 2);
+            int y = (cell / PageBenchmark.CellsX * 2 + 1) * Height / (PageBenchmark.CellsY * 2);
+
+            painter.SetColor(PageBenchmark.Palette[i % 4 * 4 + 4], PageBenchmark.Palette[i % 4 * 4 + 5], PageBenchmark.Palette[i % 4 * 4 + 6], 255);
+            painter.FloodFill(x, y);
+            canvas.CommitChange();
+
+            pages.Add(CanvasPageEncoder.Encode(canvas));
+        }
+
+        archive = Backup();
+    }
+
+    [Benchmark]
+    public byte[] Backup()
+    {
+        using (MemoryStream stream = new MemoryStream())
+        {
+            ProgressArchive.Writer writer = new ProgressArchive.Writer(stream);
+            writer.WriteSetting("Theme", 1);
+            for (int i = 0; i < pages.Count; i++)
+            {
+                writer.WritePage("ColoringList" + i, pages[i], pages[i].Length);
+            }
+            writer.Finish();
+
+            return stream.ToArray();
+        }
+    }
+
+    [Benchmark]
+    public int Restore()
+    {
+        store.Clear();
+
+        ProgressArchive.Read(new MemoryStream(archive), (key, value) => { }, (key, page, length) =>
+        {
+            store[key] = Convert.ToBase64String(page, 0, length);
+        });
+
+        return store.Count;
+    }
+}
@@ -0,0 +1,55 @@
+using BenchmarkDotNet.Attributes;
+
+// Pencil and marker, one stamp and one stroke, inside the lock area on mask pages.
+// A stroke ends with CommitChange like at touch up, so the undo copies of its tiles are part of the cost.
+[MemoryDiagnoser]
+public class BrushBenchmarks : PageBenchmark
+{
+    [Params(8, 16, 24)]
+    public int BrushSize;
+
+    private int x0, y0, x1, y1;
+
+    [GlobalSetup]
+    public void Setup()
+    {
+        SetupPage();
+        painter.brushSize = BrushSize;
+
+        // a diagonal through one outline cell, the lock area is that cell
+        int cx, cy;
+        CellCenter(2, 3, out cx, out cy);
+        painter.CreateAreaLockMask(cx, cy);
+
+        x0 = cx - width / (CellsX * 3);
+        y0 = cy - height / (CellsY * 3);
+        x1 = cx + width / (CellsX * 3);
+        y1 = cy + height / (CellsY * 3);
+    }
+
+    [Benchmark]
+    public void PencilStamp()
+    {
+        painter.DrawCircle(x0, y0);
+    }
+
+    [Benchmark]
+    public void MarkerStamp()
+    {
+        painter.DrawAdditiveCircle(x0, y0);
+    }
+
+    [Benchmark]
+    public TiledCanvas.Change PencilStroke()
+    {
+        painter.DrawLine(x0, y0, x1, y1);
+        return canvas.CommitChange();
+    }
+
+    [Benchmark]
+    public TiledCanvas.Change MarkerStroke()
+    {
+        painter.DrawAdditiveLine(x0, y0, x1, y1);
+        return canvas.CommitChange();
+    }
+}
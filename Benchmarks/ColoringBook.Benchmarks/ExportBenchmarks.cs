@@ -0,0 +1,42 @@
+using System.IO;
+using BenchmarkDotNet.Attributes;
+
+// Streaming a painted page to PNG and JPEG at page and print (4x) resolution, the memory column stays
+// at a few bands whatever the output size.
+[MemoryDiagnoser]
+public class ExportBenchmarks : PageBenchmark
+{
+    [Params(1, 4)]
+    public int Scale;
+
+    [GlobalSetup]
+    public void Setup()
+    {
+        SetupPage();
+
+        // filled cells, like a finished page
+        for (int cy = 0; cy < CellsY; cy++)
+        {
+            for (int cx = (cy & 1); cx < CellsX; cx += 2)
+            {
+                int x, y;
+                CellCenter(cx, cy, out x, out y);
+                painter.SetColor(0, 160, 0, 255);
+                painter.FloodFill(x, y);
+            }
+        }
+        canvas.CommitChange();
+    }
+
+    [Benchmark]
+    public void Png()
+    {
+        PageImageWriter.Write(canvas, painter.maskPixels, null, Scale, PageImageWriter.Format.Png, 90, Stream.Null);
+    }
+
+    [Benchmark]
+    public void Jpg()
+    {
+        PageImageWriter.Write(canvas, painter.maskPixels, null, Scale, PageImageWriter.Format.Jpg, 90, Stream.Null);
+    }
+}
@@ -0,0 +1,34 @@
+using BenchmarkDotNet.Attributes;
+
+// Paint bucket and the lock area of a stroke start, both on one outline cell.
+// Mask pages label the cell in the mask image, free pages flood the canvas itself.
+[MemoryDiagnoser]
+public class FillBenchmarks : PageBenchmark
+{
+    private int x, y;
+    private bool red;
+
+    [GlobalSetup]
+    public void Setup()
+    {
+        SetupPage();
+        CellCenter(2, 3, out x, out y);
+    }
+
+    [Benchmark]
+    public TiledCanvas.Change FloodFill()
+    {
+        // the other color every time, filling with the color under the point does nothing
+        red = !red;
+        painter.SetColor(red ? (byte)255 : (byte)0, 0, red ? (byte)0 : (byte)255, 255);
+        painter.FloodFill(x, y);
+        return canvas.CommitChange();
+    }
+
+    [Benchmark]
+    public byte[] LockArea()
+    {
+        painter.CreateAreaLockMask(x, y);
+        return painter.LockMask;
+    }
+}
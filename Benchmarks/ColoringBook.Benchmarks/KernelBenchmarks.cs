@@ -0,0 +1,99 @@
+using System.Collections.Generic;
+using BenchmarkDotNet.Attributes;
+
+// The PaintKernels loops on their own, one brush wide, into a single tile.
+[MemoryDiagnoser]
+public class KernelBenchmarks
+{
+    [Params(8, 16, 24)]
+    public int BrushSize;
+
+    [ParamsSource(nameof(Backends))]
+    public string Backend;
+
+    private byte[] tile;
+    private byte[] indexTile;
+    private byte[] sticker;
+    private byte[] mask; // lock mask of one tile, every third pixel set
+    private int count;
+
+    public static IEnumerable<string> Backends()
+    {
+        return PageBenchmark.Backends();
+    }
+
+    [GlobalSetup]
+    public void Setup()
+    {
+        if (Backend == "native") PaintKernels.EnableNative();
+        else PaintKernels.DisableNative();
+
+        tile = new byte[TiledCanvas.TileBytes];
+        indexTile = new byte[TiledCanvas.TilePixels];
+        sticker = PageBenchmark.CreateSticker(TiledCanvas.TileSize);
+        mask = new byte[TiledCanvas.TilePixels];
+        for (int i = 0; i < mask.Length; i += 3)
+        {
+            mask[i] = 1;
+        }
+
+        count = BrushSize * 2;
+    }
+
+    [Benchmark]
+    public void FillRgba()
+    {
+        PaintKernels.FillRgba(tile, 0, count, 255, 0, 0, 255, null, 0);
+    }
+
+    [Benchmark]
+    public void FillRgbaLocked()
+    {
+        PaintKernels.FillRgba(tile, 0, count, 255, 0, 0, 255, mask, 0);
+    }
+
+    [Benchmark]
+    public void FillIndexLocked()
+    {
+        PaintKernels.FillIndex(indexTile, 0, count, 3, mask, 0);
+    }
+
+    [Benchmark]
+    public void BlendRgba()
+    {
+        PaintKernels.BlendRgba(tile, 0, count, 255, 0, 0, 255, 0.1f, 0.1f, null, 0);
+    }
+
+    [Benchmark]
+    public void BlitRgba()
+    {
+        PaintKernels.BlitRgba(tile, 0, sticker, 0, count);
+    }
+
+    [Benchmark]
+    public int StampCircle()
+    {
+        return PaintKernels.StampCircle(tile, TiledCanvas.TileSize, 0, 0, 32, 32, BrushSize, PaintKernels.PackColor(255, 0, 0, 255), null, TiledCanvas.TileSize, TiledCanvas.TileSize);
+    }
+
+    [Benchmark]
+    public int StampCircleIndexLocked()
+    {
+        return PaintKernels.StampCircle(indexTile, TiledCanvas.TileSize, 0, 0, 32, 32, BrushSize, 3, mask, TiledCanvas.TileSize, TiledCanvas.TileSize);
+    }
+
+    // every pair of channel values, as the fills compare them
+    [Benchmark(OperationsPerInvoke = 256 * 256)]
+    public int CompareThreshold()
+    {
+        int matches = 0;
+        for (int a = 0; a < 256; a++)
+        {
+            for (int b = 0; b < 256; b++)
+            {
+                if (CanvasPainter.CompareThreshold((byte)a, (byte)b)) matches++;
+            }
+        }
+        return matches;
+    }
+}
@@ -0,0 +1,67 @@
+using BenchmarkDotNet.Attributes;
+
+// Undo / redo of a stroke and saving / loading a painted page.
+[MemoryDiagnoser]
+public class PageStoreBenchmarks : PageBenchmark
+{
+    private UndoHistory undoHistory;
+    private byte[] saved;
+    private int x0, y0, x1, y1;
+
+    [GlobalSetup]
+    public void Setup()
+    {
+        SetupPage();
+        undoHistory = new UndoHistory();
+        painter.brushSize = 16;
+
+        // a few filled cells and strokes, like a page someone worked on
+        for (int cy = 0; cy < CellsY; cy += 2)
+        {
+            for (int cx = cy % 4 / 2; cx < CellsX; cx += 2)
+            {
+                int x, y;
+                CellCenter(cx, cy, out x, out y);
+                painter.SetColor(0, 160, 0, 255);
+                painter.FloodFill(x, y);
+            }
+        }
+
+        painter.useLockArea = false;
+        painter.SetColor(0, 0, 255, 255);
+        for (int i = 0; i < 8; i++)
+        {
+            painter.DrawLine(0, height * i / 8, width - 1, height * (i + 1) / 8);
+        }
+        canvas.CommitChange();
+
+        saved = CanvasPageEncoder.Encode(canvas);
+
+        CellCenter(3, 4, out x0, out y0);
+        x1 = x0 + width / CellsX;
+        y1 = y0 + height / CellsY;
+    }
+
+    [Benchmark]
+    public bool StrokeUndoRedo()
+    {
+        // painting after the undo drops the undone step again, so the history stays one step long
+        painter.DrawLine(x0, y0, x1, y1);
+        undoHistory.Commit(canvas);
+        undoHistory.Undo(canvas);
+        undoHistory.Redo(canvas);
+        return undoHistory.Undo(canvas);
+    }
+
+    [Benchmark]
+    public byte[] Encode()
+    {
+        return CanvasPageEncoder.Encode(canvas);
+    }
+
+    [Benchmark]
+    public TiledCanvas Decode()
+    {
+        return CanvasPageEncoder.Decode(saved, width, height);
+    }
+}
@@ -0,0 +1,142 @@
+using System;
+using System.Collections.Generic;
+using BenchmarkDotNet.Attributes;
+
+// Pages the game paints on: free pages at the default and the print size, and mask pages.
+// Mask outlines are generated (a grid of dark lines with antialiasing noise) so no image decoder is needed.
+public abstract class PageBenchmark
+{
+    public const string Free = "Free576x1024";
+    public const string FreePrint = "Free2048x3640";
+    public const string Mask = "Mask576x1024";
+
+    public const int CellsX = 6; // outline grid
+    public const int CellsY = 8;
+
+    [Params(Free, FreePrint, Mask)]
+    public string Page;
+
+    [ParamsSource(nameof(Backends))]
+    public string Backend;
+
+    protected TiledCanvas canvas;
+    protected CanvasPainter painter;
+    protected int width;
+    protected int height;
+
+    // native only when the coloringcore library is next to the benchmark
+    public static IEnumerable<string> Backends()
+    {
+        yield return "managed";
+
+        if (PaintKernels.EnableNative())
+        {
+            PaintKernels.DisableNative();
+            yield return "native";
+        }
+    }
+
+    protected void SetupPage()
+    {
+        if (Backend == "native")
+        {
+            if (!PaintKernels.EnableNative()) throw new InvalidOperationException("coloringcore library not found");
+        }
+        else
+        {
+            PaintKernels.DisableNative();
+        }
+
+        bool mask = Page.StartsWith("Mask");
+        string[] size = Page.Substring(4).Split('x');
+        width = int.Parse(size[0]);
+        height = int.Parse(size[1]);
+
+        canvas = new TiledCanvas(width, height);
+
+        byte[] maskPixels = null;
+        if (mask)
+        {
+            maskPixels = CreateOutlines(width, height);
+            canvas.SetPalette(Palette, Palette.Length / 4);
+        }
+        else
+        {
+            // free pages get the same outlines painted in, so fills stop at them
+            byte[] outlines = CreateOutlines(width, height);
+            for (int y = 0; y < height; y++)
+            {
+                canvas.BlitSpan(y, 0, outlines, y * width * 4, width);
+            }
+            canvas.CommitChange();
+        }
+
+        painter = new CanvasPainter(canvas, maskPixels);
+        painter.SetColor(255, 0, 0, 255);
+    }
+
+    // center of the outline cell at column cx, row cy
+    protected void CellCenter(int cx, int cy, out int x, out int y)
+    {
+        x = (cx * 2 + 1) * width / (CellsX * 2);
+        y = (cy * 2 + 1) * height / (CellsY * 2);
+    }
+
+    // white, then the panel colors the benchmarks paint with
+    public static readonly byte[] Palette =
+    {
+        255, 255, 255, 255,
+        255, 0, 0, 255,
+        0, 0, 255, 255,
+        0, 160, 0, 255,
+        0, 0, 0, 255,
+    };
+
+    public static byte[] CreateOutlines(int width, int height)
+    {
+        byte[] rgba = new byte[width * height * 4];
+        int line = Math.Max(3, width / 192);
+        uint state = 12345;
+
+        for (int y = 0; y < height; y++)
+        {
+            for (int x = 0; x < width; x++)
+            {
+                int pixel = (y * width + x) * 4;
+                bool outline = x * CellsX % width < line * CellsX || y * CellsY % height < line * CellsY;
+
+                state = state * 1664525u + 1013904223u;
+                byte gray = outline ? (byte)0 : (byte)(200 + (state >> 8) % 56);
+
+                rgba[pixel] = rgba[pixel + 1] = rgba[pixel + 2] = gray;
+                rgba[pixel + 3] = 255;
+            }
+        }
+
+        return rgba;
+    }
+
+    // opaque disc with transparent corners, like the sticker images
+    public static byte[] CreateSticker(int size)
+    {
+        byte[] rgba = new byte[size * size * 4];
+        int r2 = size * size / 4;
+
+        for (int y = 0; y < size; y++)
+        {
+            for (int x = 0; x < size; x++)
+            {
+                int pixel = (y * size + x) * 4;
+                int dx = x - size / 2;
+                int dy = y - size / 2;
+
+                rgba[pixel] = (byte)(x * 255 / size);
+                rgba[pixel + 1] = (byte)(y * 255 / size);
+                rgba[pixel + 2] = 128;
+                rgba[pixel + 3] = dx * dx + dy * dy < r2 ? (byte)255 : (byte)0;
+            }
+        }
+
+        return rgba;
+    }
+}
@@ -0,0 +1,13 @@
+using BenchmarkDotNet.Running;
+
+// dotnet run -c Release                        all benchmarks
+// dotnet run -c Release -- --filter '*Brush*'  one class, see --help for the other options
+public static class Program
+{
+    public static void Main(string[] args)
+    {
+        if (args.Length == 0) args = new[] { "--filter", "*" };
+
+        BenchmarkSwitcher.FromAssembly(typeof(Program).Assembly).Run(args);
+    }
+}
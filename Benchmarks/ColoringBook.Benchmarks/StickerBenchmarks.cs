@@ -0,0 +1,27 @@
+using BenchmarkDotNet.Attributes;
+
+// Sticker stamp, at the size the sticker textures are imported with (128) and at full size.
+[MemoryDiagnoser]
+public class StickerBenchmarks : PageBenchmark
+{
+    [Params(128, 256)]
+    public int StickerSize;
+
+    private int x, y;
+
+    [GlobalSetup]
+    public void Setup()
+    {
+        SetupPage();
+        painter.SetSticker(CreateSticker(StickerSize), StickerSize, StickerSize);
+
+        CellCenter(2, 3, out x, out y);
+    }
+
+    [Benchmark]
+    public TiledCanvas.Change StickerStamp()
+    {
+        painter.DrawSticker(x, y);
+        return canvas.CommitChange();
+    }
+}
@@ -0,0 +1,193 @@
+// times every kernel on every backend this CPU has, after checking each backend against the scalar one.
+// usage: coloringcore_bench [iterations]
+
+#include "coloringcore.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <vector>
+
+static const int TileSize = 64;
+static const int PageWidth = 576; // free paint page
+static const int PageHeight = 1024;
+static const uint32_t Red = 0xFF0000FFu;
+
+struct Buffers
+{
+    std::vector<uint8_t> page; // RGBA, PageWidth x PageHeight
+    std::vector<uint8_t> tile; // RGBA tile
+    std::vector<uint8_t> indexTile;
+    std::vector<uint8_t> sticker;
+    std::vector<uint8_t> mask; // page sized lock mask
+    std::vector<uint8_t> region;
+};
+
+static uint32_t Random(uint32_t& state)
+{
+    state = state * 1664525u + 1013904223u;
+    return state >> 8;
+}
+
+static void Reset(Buffers& b)
+{
+    uint32_t state = 12345;
+
+    b.tile.assign(TileSize * TileSize * 4, 0);
+    b.indexTile.assign(TileSize * TileSize, 0);
+    b.sticker.assign(TileSize * TileSize * 4, 0);
+    b.mask.assign(PageWidth * PageHeight, 0);
+    b.region.assign(PageWidth * PageHeight, 0);
+    b.page.assign(PageWidth * PageHeight * 4, 255);
+
+    for (size_t i = 0; i < b.tile.size(); i++) b.tile[i] = (uint8_t)Random(state);
+    for (size_t i = 0; i < b.sticker.size(); i++) b.sticker[i] = (uint8_t)Random(state);
+    for (size_t i = 3; i < b.sticker.size(); i += 16) b.sticker[i] = 0; // every 4th sticker pixel transparent
+
+    // lock mask: a disc, like an area picked on a mask page
+    for (int y = 0; y < PageHeight; y++)
+    {
+        for (int x = 0; x < PageWidth; x++)
+        {
+            int dx = x - PageWidth / 2;
+            int dy = y - PageHeight / 2;
+            b.mask[y * PageWidth + x] = dx * dx + dy * dy < 200 * 200 ? 1 : 0;
+        }
+    }
+
+    // page outlines: a grid of dark lines splitting it into regions, with a bit of antialiasing noise
+    for (int y = 0; y < PageHeight; y++)
+    {
+        for (int x = 0; x < PageWidth; x++)
+        {
+            uint8_t* p = &b.page[(y * PageWidth + x) * 4];
+            if (x % 96 < 3 || y % 128 < 3)
+            {
+                p[0] = p[1] = p[2] = 0;
+            }
+            else
+            {
+                p[0] = p[1] = p[2] = (uint8_t)(200 + Random(state) % 56);
+            }
+        }
+    }
+}
+
+// runs the kernel pass over fresh buffers and returns a copy of what it wrote
+typedef std::function<void(Buffers&)> Pass;
+
+static std::vector<uint8_t> Output(Buffers& b)
+{
+    std::vector<uint8_t> out(b.tile);
+    out.insert(out.end(), b.indexTile.begin(), b.indexTile.end());
+    out.insert(out.end(), b.region.begin(), b.region.end());
+    return out;
+}
+
+struct Case
+{
+    std::string name;
+    Pass pass;
+};
+
+static std::vector<Case> Cases()
+{
+    std::vector<Case> cases;
+
+    cases.push_back({ "fill span rgba", [](Buffers& b) {
+        for (int y = 0; y < TileSize; y++) cc_fill_span_rgba(&b.tile[y * TileSize * 4], TileSize, Red, 0);
+    } });
+
+    cases.push_back({ "fill span rgba locked", [](Buffers& b) {
+        for (int y = 0; y < TileSize; y++) cc_fill_span_rgba(&b.tile[y * TileSize * 4], TileSize, Red, &b.mask[(PageHeight / 2 - 200 + y) * PageWidth + PageWidth / 2 - 32]);
+    } });
+
+    cases.push_back({ "fill span index locked", [](Buffers& b) {
+        for (int y = 0; y < TileSize; y++) cc_fill_span_index(&b.indexTile[y * TileSize], TileSize, 7, &b.mask[(PageHeight / 2 - 200 + y) * PageWidth + PageWidth / 2 - 32]);
+    } });
+
+    cases.push_back({ "marker blend", [](Buffers& b) {
+        for (int y = 0; y < TileSize; y++) cc_blend_span_rgba(&b.tile[y * TileSize * 4], TileSize, Red, 0.1f, 0.1f, 0);
+    } });
+
+    cases.push_back({ "marker blend locked", [](Buffers& b) {
+        for (int y = 0; y < TileSize; y++) cc_blend_span_rgba(&b.tile[y * TileSize * 4], TileSize, 0x80FF8000u, 128 / 255.0f * 0.1f, 0.0f, &b.mask[(PageHeight / 2 - 200 + y) * PageWidth + PageWidth / 2 - 32]);
+    } });
+
+    cases.push_back({ "sticker blit", [](Buffers& b) {
+        for (int y = 0; y < TileSize; y++) cc_blit_span_rgba(&b.tile[y * TileSize * 4], &b.sticker[y * TileSize * 4], TileSize);
+    } });
+
+    for (int radius = 8; radius <= 24; radius += 8)
+    {
+        cases.push_back({ "brush stamp r" + std::to_string(radius), [radius](Buffers& b) {
+            cc_stamp_circle(&b.tile[0], TileSize, 4, Red, 0, 0, 30, 33, radius, 0, PageWidth, PageHeight);
+        } });
+    }
+
+    cases.push_back({ "brush stamp r24 locked index", [](Buffers& b) {
+        int ox = PageWidth / 2 - 192;
+        int oy = PageHeight / 2 - 64;
+        cc_stamp_circle(&b.indexTile[0], TileSize, 1, 3, ox, oy, ox + 20, oy + 40, 24, &b.mask[0], PageWidth, PageHeight);
+    } });
+
+    cases.push_back({ "region label", [](Buffers& b) {
+        int bounds[4];
+        cc_label_region(&b.page[0], PageWidth, PageHeight, 150, 200, 128, &b.region[0], bounds);
+    } });
+
+    return cases;
+}
+
+int main(int argc, char** argv)
+{
+    int iterations = argc > 1 ? atoi(argv[1]) : 200;
+    if (iterations < 1) iterations = 1;
+
+    const char* backends[] = { "scalar", "sse2", "avx2", "neon" };
+    std::vector<Case> cases = Cases();
+    Buffers buffers;
+    bool mismatch = false;
+
+    printf("coloringcore %d, default backend %s\n", cc_version(), cc_backend());
+
+    // reference output of every case
+    std::vector<std::vector<uint8_t> > reference;
+    cc_select_backend("scalar");
+    for (size_t c = 0; c < cases.size(); c++)
+    {
+        Reset(buffers);
+        cases[c].pass(buffers);
+        reference.push_back(Output(buffers));
+    }
+
+    for (const char* backend : backends)
+    {
+        if (!cc_select_backend(backend)) continue;
+
+        printf("\n%s\n", backend);
+
+        for (size_t c = 0; c < cases.size(); c++)
+        {
+            Reset(buffers);
+            cases[c].pass(buffers);
+            bool same = Output(buffers) == reference[c];
+            mismatch |= !same;
+
+            Reset(buffers);
+            std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+            for (int i = 0; i < iterations; i++)
+            {
+                cases[c].pass(buffers);
+            }
+            double us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / iterations;
+
+            printf("  %-30s %10.2f us%s\n", cases[c].name.c_str(), us, same ? "" : "  MISMATCH with scalar");
+        }
+    }
+
+    return mismatch ? 1 : 0;
+}
@@ -0,0 +1,62 @@
+// coloringcore: painting kernels of the coloring book canvas.
+//
+// Plain C ABI so it can be called through DllImport (see PaintKernels.cs) and from C++ benchmarks.
+// Colors are packed little endian RGBA32: r | g << 8 | b << 16 | a << 24.
+// Lock masks hold one byte per page pixel, only pixels set to 1 are painted.
+
+#ifndef COLORINGCORE_H
+#define COLORINGCORE_H
+
+#include <stdint.h>
+
+#if defined(_WIN32)
+#define CC_API __declspec(dllexport)
+#else
+#define CC_API __attribute__((visibility("default")))
+#endif
+
+#define CC_VERSION 1
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// CC_VERSION of the loaded library, callers refuse a library with another version
+CC_API int cc_version(void);
+
+// name of the kernel backend in use: "avx2", "sse2", "neon" or "scalar"
+CC_API const char* cc_backend(void);
+
+// switches to the named backend, returns 0 (and keeps the current one) if this CPU or build lacks it
+CC_API int cc_select_backend(const char* name);
+
+// writes count pixels of color, mask (can be null) is read at the same pixel index
+CC_API void cc_fill_span_rgba(uint8_t* dst, int count, uint32_t rgba, const uint8_t* mask);
+
+// one palette index byte per pixel
+CC_API void cc_fill_span_index(uint8_t* dst, int count, uint8_t index, const uint8_t* mask);
+
+// marker blend towards color: c += (color - c) * t, truncated, alpha uses tAlpha
+CC_API void cc_blend_span_rgba(uint8_t* dst, int count, uint32_t rgba, float t, float tAlpha, const uint8_t* mask);
+
+// copies count pixels, source pixels with alpha 0 are skipped
+CC_API void cc_blit_span_rgba(uint8_t* dst, const uint8_t* src, int count);
+
+// brush stamp into one canvas tile: every pixel with (x - cx)^2 + (y - cy)^2 < radius^2.
+// tile is tileSize x tileSize pixels of bpp bytes (4: rgba, 1: palette index in value) at page pixel (originX, originY),
+// page pixels outside width x height are not touched, mask is a page sized lock mask (can be null).
+// returns the number of pixels painted, with tile null nothing is written and only the count is returned
+CC_API int cc_stamp_circle(uint8_t* tile, int tileSize, int bpp, uint32_t value, int originX, int originY,
+                           int cx, int cy, int radius, const uint8_t* mask, int width, int height);
+
+// 4-connected region of pixels around (x, y) whose channels all differ from the seed pixel by at most threshold.
+// region (width * height bytes) is set to 1 inside and 0 outside, a seed with no matching neighbour stays 0.
+// bounds (can be null) gets the region rect x0, y0, x1, y1 (exclusive), returns the region pixel count
+CC_API int cc_label_region(const uint8_t* rgba, int width, int height, int x, int y, int threshold,
+                           uint8_t* region, int* bounds);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,273 @@
+#include "coloringcore.h"
+#include "kernels.h"
+
+#include <string.h>
+#include <vector>
+
+#if defined(CC_HAVE_AVX2) && defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+// backend
+
+#if defined(CC_HAVE_AVX2)
+static bool CpuHasAvx2()
+{
+#if defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 1);
+    bool osxsave = (info[2] & (1 << 27)) != 0;
+    bool avx = (info[2] & (1 << 28)) != 0;
+    if (!osxsave || !avx || (_xgetbv(0) & 6) != 6) return false;
+
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#else
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+#endif
+}
+#endif
+
+static const Kernels* BestKernels()
+{
+#if defined(CC_HAVE_AVX2)
+    if (CpuHasAvx2()) return &Avx2Kernels;
+#endif
+#if defined(CC_HAVE_SSE2)
+    return &Sse2Kernels;
+#elif defined(CC_HAVE_NEON)
+    return &NeonKernels;
+#else
+    return &ScalarKernels;
+#endif
+}
+
+static const Kernels* kernels = BestKernels();
+
+int cc_version(void)
+{
+    return CC_VERSION;
+}
+
+const char* cc_backend(void)
+{
+    return kernels->name;
+}
+
+int cc_select_backend(const char* name)
+{
+    const Kernels* available[] = {
+        &ScalarKernels,
+#if defined(CC_HAVE_SSE2)
+        &Sse2Kernels,
+#endif
+#if defined(CC_HAVE_AVX2)
+        CpuHasAvx2() ? &Avx2Kernels : 0,
+#endif
+#if defined(CC_HAVE_NEON)
+        &NeonKernels,
+#endif
+    };
+
+    for (const Kernels* candidate : available)
+    {
+        if (candidate && strcmp(candidate->name, name) == 0)
+        {
+            kernels = candidate;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+
+// spans
+
+void cc_fill_span_rgba(uint8_t* dst, int count, uint32_t rgba, const uint8_t* mask)
+{
+    if (count > 0) kernels->fillRgba(dst, count, rgba, mask);
+}
+
+void cc_fill_span_index(uint8_t* dst, int count, uint8_t index, const uint8_t* mask)
+{
+    if (count > 0) kernels->fillIndex(dst, count, index, mask);
+}
+
+void cc_blend_span_rgba(uint8_t* dst, int count, uint32_t rgba, float t, float tAlpha, const uint8_t* mask)
+{
+    if (count > 0) kernels->blendRgba(dst, count, rgba, t, tAlpha, mask);
+}
+
+void cc_blit_span_rgba(uint8_t* dst, const uint8_t* src, int count)
+{
+    if (count > 0) kernels->blitRgba(dst, src, count);
+}
+
+
+// brush
+
+// largest d with d * d < limit
+static int HalfWidth(int limit)
+{
+    int d = 0;
+    while ((d + 1) * (d + 1) < limit) d++;
+    return d;
+}
+
+static int CountLocked(const uint8_t* mask, int count)
+{
+    int locked = 0;
+    for (int i = 0; i < count; i++)
+    {
+        locked += mask[i] == 1;
+    }
+    return locked;
+}
+
+int cc_stamp_circle(uint8_t* tile, int tileSize, int bpp, uint32_t value, int originX, int originY,
+                    int cx, int cy, int radius, const uint8_t* mask, int width, int height)
+{
+    if (radius <= 0) return 0;
+
+    int r2 = radius * radius;
+
+    int y0 = cy - radius + 1;
+    int y1 = cy + radius;
+    if (y0 < originY) y0 = originY;
+    if (y0 < 0) y0 = 0;
+    if (y1 > originY + tileSize) y1 = originY + tileSize;
+    if (y1 > height) y1 = height;
+
+    // the half width only shrinks away from the center row, so the search restarts from the widest row
+    int half = HalfWidth(r2);
+    int painted = 0;
+
+    for (int y = y0; y < y1; y++)
+    {
+        int dy = y - cy;
+        int limit = r2 - dy * dy;
+
+        while (half > 0 && half * half >= limit) half--;
+        while ((half + 1) * (half + 1) < limit) half++;
+
+        int x0 = cx - half;
+        int x1 = cx + half + 1;
+        if (x0 < originX) x0 = originX;
+        if (x0 < 0) x0 = 0;
+        if (x1 > originX + tileSize) x1 = originX + tileSize;
+        if (x1 > width) x1 = width;
+        if (x0 >= x1) continue;
+
+        const uint8_t* rowMask = mask ? mask + (size_t)y * width + x0 : 0;
+        int count = rowMask ? CountLocked(rowMask, x1 - x0) : x1 - x0;
+
+        painted += count;
+        if (!tile || count == 0) continue;
+
+        uint8_t* row = tile + ((size_t)(y - originY) * tileSize + (x0 - originX)) * bpp;
+
+        if (bpp == 4)
+        {
+            kernels->fillRgba(row, x1 - x0, value, rowMask);
+        }
+        else
+        {
+            kernels->fillIndex(row, x1 - x0, (uint8_t)value, rowMask);
+        }
+    }
+
+    return painted;
+}
+
+
+// regions
+
+static const uint8_t Candidate = 2; // matches the seed color, not reached yet
+
+int cc_label_region(const uint8_t* rgba, int width, int height, int x, int y, int threshold,
+                    uint8_t* region, int* bounds)
+{
+    size_t pixels = (size_t)width * height;
+
+    if (bounds) bounds[0] = bounds[1] = bounds[2] = bounds[3] = 0;
+
+    if (x < 0 || y < 0 || x >= width || y >= height)
+    {
+        memset(region, 0, pixels);
+        return 0;
+    }
+
+    // one vector pass marks every pixel close to the seed color, the fill below only walks those marks
+    uint32_t seed;
+    memcpy(&seed, rgba + ((size_t)y * width + x) * 4, 4);
+    kernels->matchRgba(rgba, (int)pixels, seed, threshold, Candidate, region);
+
+    int minX = x, minY = y, maxX = x, maxY = y;
+    int count = 0;
+
+    std::vector<int> stack;
+    stack.push_back(y * width + x);
+
+    while (!stack.empty())
+    {
+        int pixel = stack.back();
+        stack.pop_back();
+
+        if (region[pixel] != Candidate) continue;
+
+        int py = pixel / width;
+        uint8_t* row = region + (size_t)py * width;
+
+        int left = pixel - py * width;
+        int right = left;
+        while (left > 0 && row[left - 1] == Candidate) left--;
+        while (right + 1 < width && row[right + 1] == Candidate) right++;
+
+        memset(row + left, 1, right - left + 1);
+        count += right - left + 1;
+
+        if (left < minX) minX = left;
+        if (right > maxX) maxX = right;
+        if (py < minY) minY = py;
+        if (py > maxY) maxY = py;
+
+        for (int ny = py - 1; ny <= py + 1; ny += 2)
+        {
+            if (ny < 0 || ny >= height) continue;
+
+            const uint8_t* next = region + (size_t)ny * width;
+            for (int nx = left; nx <= right; nx++)
+            {
+                // one seed per run of candidates
+                if (next[nx] == Candidate && (nx == left || next[nx - 1] != Candidate))
+                {
+                    stack.push_back(ny * width + nx);
+                }
+            }
+        }
+    }
+
+    // candidates the fill did not reach are outside the region
+    for (size_t i = 0; i < pixels; i++)
+    {
+        region[i] &= 1;
+    }
+
+    // the seed only counts when a neighbour matches it (same as the managed fill)
+    if (count == 1)
+    {
+        region[(size_t)y * width + x] = 0;
+        return 0;
+    }
+
+    if (bounds)
+    {
+        bounds[0] = minX;
+        bounds[1] = minY;
+        bounds[2] = maxX + 1;
+        bounds[3] = maxY + 1;
+    }
+
+    return count;
+}
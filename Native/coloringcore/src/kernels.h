@@ -0,0 +1,42 @@
+// span kernels, one table per instruction set; the scalar table is the reference every other one must match
+
+#ifndef COLORINGCORE_KERNELS_H
+#define COLORINGCORE_KERNELS_H
+
+#include <stdint.h>
+
+struct Kernels
+{
+    const char* name;
+
+    void (*fillRgba)(uint8_t* dst, int count, uint32_t rgba, const uint8_t* mask);
+    void (*fillIndex)(uint8_t* dst, int count, uint8_t index, const uint8_t* mask);
+    void (*blendRgba)(uint8_t* dst, int count, uint32_t rgba, float t, float tAlpha, const uint8_t* mask);
+    void (*blitRgba)(uint8_t* dst, const uint8_t* src, int count);
+
+    // out[i] = value when all channels of pixel i are within threshold of seed, else 0
+    void (*matchRgba)(const uint8_t* src, int count, uint32_t seed, int threshold, uint8_t value, uint8_t* out);
+};
+
+extern const Kernels ScalarKernels;
+
+#if defined(CC_HAVE_SSE2)
+extern const Kernels Sse2Kernels;
+#endif
+
+#if defined(CC_HAVE_AVX2)
+extern const Kernels Avx2Kernels;
+#endif
+
+#if defined(CC_HAVE_NEON)
+extern const Kernels NeonKernels;
+#endif
+
+// scalar tails, shared by the vector tables
+void ScalarFillRgba(uint8_t* dst, int count, uint32_t rgba, const uint8_t* mask);
+void ScalarFillIndex(uint8_t* dst, int count, uint8_t index, const uint8_t* mask);
+void ScalarBlendRgba(uint8_t* dst, int count, uint32_t rgba, float t, float tAlpha, const uint8_t* mask);
+void ScalarBlitRgba(uint8_t* dst, const uint8_t* src, int count);
+void ScalarMatchRgba(const uint8_t* src, int count, uint32_t seed, int threshold, uint8_t value, uint8_t* out);
+
+#endif
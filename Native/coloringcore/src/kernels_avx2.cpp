@@ -0,0 +1,185 @@
+#include "kernels.h"
+
+#if defined(CC_HAVE_AVX2)
+
+#include <immintrin.h>
+#include <string.h>
+
+// built with -mavx2 (/arch:AVX2), only reached after the runtime CPU check in coloringcore.cpp
+
+// 8 mask bytes to 8 pixel lanes, all ones where the mask byte is 1
+static inline __m256i ExpandMask8(const uint8_t* mask)
+{
+    long long bytes;
+    memcpy(&bytes, mask, 8);
+
+    __m256i m = _mm256_cvtepu8_epi32(_mm_cvtsi64_si128(bytes));
+    return _mm256_cmpeq_epi32(m, _mm256_set1_epi32(1));
+}
+
+static inline __m256i Select(__m256i mask, __m256i a, __m256i b)
+{
+    return _mm256_blendv_epi8(b, a, mask);
+}
+
+static void FillRgba(uint8_t* dst, int count, uint32_t rgba, const uint8_t* mask)
+{
+    __m256i color = _mm256_set1_epi32((int)rgba);
+    int i = 0;
+
+    if (!mask)
+    {
+        for (; i + 8 <= count; i += 8)
+        {
+            _mm256_storeu_si256((__m256i*)(dst + i * 4), color);
+        }
+    }
+    else
+    {
+        for (; i + 8 <= count; i += 8)
+        {
+            __m256i m = ExpandMask8(mask + i);
+            if (_mm256_testz_si256(m, m)) continue;
+
+            _mm256_maskstore_epi32((int*)(dst + i * 4), m, color);
+        }
+    }
+
+    Sse2Kernels.fillRgba(dst + i * 4, count - i, rgba, mask ? mask + i : 0);
+}
+
+static void FillIndex(uint8_t* dst, int count, uint8_t index, const uint8_t* mask)
+{
+    if (!mask)
+    {
+        ScalarFillIndex(dst, count, index, 0);
+        return;
+    }
+
+    __m256i value = _mm256_set1_epi8((char)index);
+    __m256i one = _mm256_set1_epi8(1);
+    int i = 0;
+
+    for (; i + 32 <= count; i += 32)
+    {
+        __m256i m = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*)(mask + i)), one);
+        __m256i d = _mm256_loadu_si256((const __m256i*)(dst + i));
+        _mm256_storeu_si256((__m256i*)(dst + i), Select(m, value, d));
+    }
+
+    Sse2Kernels.fillIndex(dst + i, count - i, index, mask + i);
+}
+
+// two pixels (8 int lanes) blended in float, same operation order as the scalar kernel
+static inline __m256i BlendPixels(__m256i d, __m256i color, __m256 t)
+{
+    __m256 diff = _mm256_cvtepi32_ps(_mm256_sub_epi32(color, d));
+    return _mm256_cvttps_epi32(_mm256_add_ps(_mm256_cvtepi32_ps(d), _mm256_mul_ps(diff, t)));
+}
+
+static void BlendRgba(uint8_t* dst, int count, uint32_t rgba, float t, float tAlpha, const uint8_t* mask)
+{
+    __m256i color = _mm256_setr_epi32(rgba & 0xFF, (rgba >> 8) & 0xFF, (rgba >> 16) & 0xFF, rgba >> 24,
+                                      rgba & 0xFF, (rgba >> 8) & 0xFF, (rgba >> 16) & 0xFF, rgba >> 24);
+    __m256 tv = _mm256_setr_ps(t, t, t, tAlpha, t, t, t, tAlpha);
+    int i = 0;
+
+    for (; i + 4 <= count; i += 4)
+    {
+        __m128i m = _mm_setzero_si128();
+        if (mask)
+        {
+            int bytes;
+            memcpy(&bytes, mask + i, 4);
+            m = _mm_cmpeq_epi8(_mm_cvtsi32_si128(bytes), _mm_set1_epi8(1));
+            m = _mm_unpacklo_epi8(m, m);
+            m = _mm_unpacklo_epi16(m, m);
+            if (_mm_movemask_epi8(m) == 0) continue;
+        }
+        else
+        {
+            m = _mm_set1_epi32(-1);
+        }
+
+        __m128i d = _mm_loadu_si128((const __m128i*)(dst + i * 4));
+
+        __m256i p01 = BlendPixels(_mm256_cvtepu8_epi32(d), color, tv);
+        __m256i p23 = BlendPixels(_mm256_cvtepu8_epi32(_mm_srli_si128(d, 8)), color, tv);
+
+        // packs work per 128 bit lane, put the pixels back in order before narrowing to bytes
+        __m256i words = _mm256_permute4x64_epi64(_mm256_packs_epi32(p01, p23), 0xD8);
+        __m128i result = _mm_packus_epi16(_mm256_castsi256_si128(words), _mm256_extracti128_si256(words, 1));
+
+        _mm_storeu_si128((__m128i*)(dst + i * 4), _mm_blendv_epi8(d, result, m));
+    }
+
+    ScalarBlendRgba(dst + i * 4, count - i, rgba, t, tAlpha, mask ? mask + i : 0);
+}
+
+static void BlitRgba(uint8_t* dst, const uint8_t* src, int count)
+{
+    __m256i alpha = _mm256_set1_epi32((int)0xFF000000);
+    int i = 0;
+
+    for (; i + 8 <= count; i += 8)
+    {
+        __m256i s = _mm256_loadu_si256((const __m256i*)(src + i * 4));
+        __m256i opaque = _mm256_xor_si256(_mm256_cmpeq_epi32(_mm256_and_si256(s, alpha), _mm256_setzero_si256()), _mm256_set1_epi32(-1));
+        if (_mm256_testz_si256(opaque, opaque)) continue;
+
+        _mm256_maskstore_epi32((int*)(dst + i * 4), opaque, s);
+    }
+
+    Sse2Kernels.blitRgba(dst + i * 4, src + i * 4, count - i);
+}
+
+// 8 pixels to 8 lanes, all ones where every channel is within threshold
+static inline __m256i Match8(const uint8_t* src, __m256i seed, __m256i threshold)
+{
+    __m256i s = _mm256_loadu_si256((const __m256i*)src);
+    __m256i diff = _mm256_or_si256(_mm256_subs_epu8(s, seed), _mm256_subs_epu8(seed, s));
+    __m256i within = _mm256_cmpeq_epi8(_mm256_subs_epu8(diff, threshold), _mm256_setzero_si256());
+    return _mm256_cmpeq_epi32(within, _mm256_set1_epi32(-1));
+}
+
+static void MatchRgba(const uint8_t* src, int count, uint32_t seed, int threshold, uint8_t value, uint8_t* out)
+{
+    if (threshold < 0 || threshold > 255)
+    {
+        ScalarMatchRgba(src, count, seed, threshold, value, out);
+        return;
+    }
+
+    __m256i seedv = _mm256_set1_epi32((int)seed);
+    __m256i thresholdv = _mm256_set1_epi8((char)threshold);
+    __m256i valuev = _mm256_set1_epi8((char)value);
+    __m256i order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+    int i = 0;
+
+    for (; i + 32 <= count; i += 32)
+    {
+        __m256i m0 = Match8(src + i * 4, seedv, thresholdv);
+        __m256i m1 = Match8(src + i * 4 + 32, seedv, thresholdv);
+        __m256i m2 = Match8(src + i * 4 + 64, seedv, thresholdv);
+        __m256i m3 = Match8(src + i * 4 + 96, seedv, thresholdv);
+
+        // per lane packing leaves 4 pixel groups interleaved across the halves, the permute restores pixel order
+        __m256i m = _mm256_packs_epi16(_mm256_packs_epi32(m0, m1), _mm256_packs_epi32(m2, m3));
+        m = _mm256_permutevar8x32_epi32(m, order);
+
+        _mm256_storeu_si256((__m256i*)(out + i), _mm256_and_si256(m, valuev));
+    }
+
+    Sse2Kernels.matchRgba(src + i * 4, count - i, seed, threshold, value, out + i);
+}
+
+const Kernels Avx2Kernels = {
+    "avx2",
+    FillRgba,
+    FillIndex,
+    BlendRgba,
+    BlitRgba,
+    MatchRgba
+};
+
+#endif
@@ -0,0 +1,172 @@
+#include "kernels.h"
+
+#if defined(CC_HAVE_NEON)
+
+#include <arm_neon.h>
+#include <string.h>
+
+// 4 mask bytes to 16 bytes, each mask byte repeated over its pixel, all ones where it is 1
+static inline uint8x16_t ExpandMask4(const uint8_t* mask)
+{
+    uint32_t bytes;
+    memcpy(&bytes, mask, 4);
+
+    uint8x8_t m = vceq_u8(vcreate_u8(bytes), vdup_n_u8(1));
+    uint8x8x2_t twice = vzip_u8(m, m);
+    uint8x8x2_t four = vzip_u8(twice.val[0], twice.val[0]);
+    return vcombine_u8(four.val[0], four.val[1]);
+}
+
+static inline bool Any(uint8x16_t m)
+{
+    uint64x2_t wide = vreinterpretq_u64_u8(m);
+    return (vgetq_lane_u64(wide, 0) | vgetq_lane_u64(wide, 1)) != 0;
+}
+
+static void FillRgba(uint8_t* dst, int count, uint32_t rgba, const uint8_t* mask)
+{
+    uint8x16_t color = vreinterpretq_u8_u32(vdupq_n_u32(rgba));
+    int i = 0;
+
+    if (!mask)
+    {
+        for (; i + 4 <= count; i += 4)
+        {
+            vst1q_u8(dst + i * 4, color);
+        }
+    }
+    else
+    {
+        for (; i + 4 <= count; i += 4)
+        {
+            uint8x16_t m = ExpandMask4(mask + i);
+            if (!Any(m)) continue;
+
+            uint8x16_t d = vld1q_u8(dst + i * 4);
+            vst1q_u8(dst + i * 4, vbslq_u8(m, color, d));
+        }
+    }
+
+    ScalarFillRgba(dst + i * 4, count - i, rgba, mask ? mask + i : 0);
+}
+
+static void FillIndex(uint8_t* dst, int count, uint8_t index, const uint8_t* mask)
+{
+    if (!mask)
+    {
+        ScalarFillIndex(dst, count, index, 0);
+        return;
+    }
+
+    uint8x16_t value = vdupq_n_u8(index);
+    uint8x16_t one = vdupq_n_u8(1);
+    int i = 0;
+
+    for (; i + 16 <= count; i += 16)
+    {
+        uint8x16_t m = vceqq_u8(vld1q_u8(mask + i), one);
+        vst1q_u8(dst + i, vbslq_u8(m, value, vld1q_u8(dst + i)));
+    }
+
+    ScalarFillIndex(dst + i, count - i, index, mask + i);
+}
+
+// one pixel (4 lanes) blended in float, same operation order as the scalar kernel (no fused multiply add)
+static inline uint32x4_t BlendPixel(uint32x4_t d, int32x4_t color, float32x4_t t)
+{
+    float32x4_t diff = vcvtq_f32_s32(vsubq_s32(color, vreinterpretq_s32_u32(d)));
+    return vcvtq_u32_f32(vaddq_f32(vcvtq_f32_u32(d), vmulq_f32(diff, t)));
+}
+
+static void BlendRgba(uint8_t* dst, int count, uint32_t rgba, float t, float tAlpha, const uint8_t* mask)
+{
+    int32_t channels[4] = { (int32_t)(rgba & 0xFF), (int32_t)((rgba >> 8) & 0xFF), (int32_t)((rgba >> 16) & 0xFF), (int32_t)(rgba >> 24) };
+    float ts[4] = { t, t, t, tAlpha };
+
+    int32x4_t color = vld1q_s32(channels);
+    float32x4_t tv = vld1q_f32(ts);
+    int i = 0;
+
+    for (; i + 4 <= count; i += 4)
+    {
+        uint8x16_t m = mask ? ExpandMask4(mask + i) : vdupq_n_u8(0xFF);
+        if (!Any(m)) continue;
+
+        uint8x16_t d = vld1q_u8(dst + i * 4);
+        uint16x8_t lo = vmovl_u8(vget_low_u8(d));
+        uint16x8_t hi = vmovl_u8(vget_high_u8(d));
+
+        uint32x4_t p0 = BlendPixel(vmovl_u16(vget_low_u16(lo)), color, tv);
+        uint32x4_t p1 = BlendPixel(vmovl_u16(vget_high_u16(lo)), color, tv);
+        uint32x4_t p2 = BlendPixel(vmovl_u16(vget_low_u16(hi)), color, tv);
+        uint32x4_t p3 = BlendPixel(vmovl_u16(vget_high_u16(hi)), color, tv);
+
+        uint16x8_t words01 = vcombine_u16(vmovn_u32(p0), vmovn_u32(p1));
+        uint16x8_t words23 = vcombine_u16(vmovn_u32(p2), vmovn_u32(p3));
+        uint8x16_t result = vcombine_u8(vmovn_u16(words01), vmovn_u16(words23));
+
+        vst1q_u8(dst + i * 4, vbslq_u8(m, result, d));
+    }
+
+    ScalarBlendRgba(dst + i * 4, count - i, rgba, t, tAlpha, mask ? mask + i : 0);
+}
+
+static void BlitRgba(uint8_t* dst, const uint8_t* src, int count)
+{
+    uint32x4_t alpha = vdupq_n_u32(0xFF000000u);
+    int i = 0;
+
+    for (; i + 4 <= count; i += 4)
+    {
+        uint32x4_t s = vld1q_u32((const uint32_t*)(src + i * 4));
+        uint32x4_t transparent = vceqq_u32(vandq_u32(s, alpha), vdupq_n_u32(0));
+
+        uint32x4_t d = vld1q_u32((const uint32_t*)(dst + i * 4));
+        vst1q_u32((uint32_t*)(dst + i * 4), vbslq_u32(transparent, d, s));
+    }
+
+    ScalarBlitRgba(dst + i * 4, src + i * 4, count - i);
+}
+
+// 4 pixels to 4 halfwords, all ones where every channel is within threshold
+static inline uint16x4_t Match4(const uint8_t* src, uint8x16_t seed, uint8x16_t threshold)
+{
+    uint8x16_t within = vcleq_u8(vabdq_u8(vld1q_u8(src), seed), threshold);
+    return vmovn_u32(vceqq_u32(vreinterpretq_u32_u8(within), vdupq_n_u32(0xFFFFFFFFu)));
+}
+
+static void MatchRgba(const uint8_t* src, int count, uint32_t seed, int threshold, uint8_t value, uint8_t* out)
+{
+    if (threshold < 0 || threshold > 255)
+    {
+        ScalarMatchRgba(src, count, seed, threshold, value, out);
+        return;
+    }
+
+    uint8x16_t seedv = vreinterpretq_u8_u32(vdupq_n_u32(seed));
+    uint8x16_t thresholdv = vdupq_n_u8((uint8_t)threshold);
+    uint8x16_t valuev = vdupq_n_u8(value);
+    int i = 0;
+
+    for (; i + 16 <= count; i += 16)
+    {
+        uint16x8_t m01 = vcombine_u16(Match4(src + i * 4, seedv, thresholdv), Match4(src + i * 4 + 16, seedv, thresholdv));
+        uint16x8_t m23 = vcombine_u16(Match4(src + i * 4 + 32, seedv, thresholdv), Match4(src + i * 4 + 48, seedv, thresholdv));
+        uint8x16_t m = vcombine_u8(vmovn_u16(m01), vmovn_u16(m23));
+
+        vst1q_u8(out + i, vandq_u8(m, valuev));
+    }
+
+    ScalarMatchRgba(src + i * 4, count - i, seed, threshold, value, out + i);
+}
+
+const Kernels NeonKernels = {
+    "neon",
+    FillRgba,
+    FillIndex,
+    BlendRgba,
+    BlitRgba,
+    MatchRgba
+};
+
+#endif
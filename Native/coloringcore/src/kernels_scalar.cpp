@@ -0,0 +1,91 @@
+#include "kernels.h"
+
+#include <string.h>
+
+// same arithmetic as the managed kernels (PaintKernels.cs), built with fp contraction off so results match bit for bit
+
+void ScalarFillRgba(uint8_t* dst, int count, uint32_t rgba, const uint8_t* mask)
+{
+    uint8_t color[4] = { (uint8_t)rgba, (uint8_t)(rgba >> 8), (uint8_t)(rgba >> 16), (uint8_t)(rgba >> 24) };
+
+    for (int i = 0; i < count; i++, dst += 4)
+    {
+        if (mask && mask[i] != 1) continue;
+
+        memcpy(dst, color, 4);
+    }
+}
+
+void ScalarFillIndex(uint8_t* dst, int count, uint8_t index, const uint8_t* mask)
+{
+    if (!mask)
+    {
+        memset(dst, index, count);
+        return;
+    }
+
+    for (int i = 0; i < count; i++)
+    {
+        if (mask[i] == 1) dst[i] = index;
+    }
+}
+
+void ScalarBlendRgba(uint8_t* dst, int count, uint32_t rgba, float t, float tAlpha, const uint8_t* mask)
+{
+    int r = rgba & 0xFF;
+    int g = (rgba >> 8) & 0xFF;
+    int b = (rgba >> 16) & 0xFF;
+    int a = rgba >> 24;
+
+    for (int i = 0; i < count; i++, dst += 4)
+    {
+        if (mask && mask[i] != 1) continue;
+
+        dst[0] = (uint8_t)(int)((float)dst[0] + (float)(r - dst[0]) * t);
+        dst[1] = (uint8_t)(int)((float)dst[1] + (float)(g - dst[1]) * t);
+        dst[2] = (uint8_t)(int)((float)dst[2] + (float)(b - dst[2]) * t);
+        dst[3] = (uint8_t)(int)((float)dst[3] + (float)(a - dst[3]) * tAlpha);
+    }
+}
+
+void ScalarBlitRgba(uint8_t* dst, const uint8_t* src, int count)
+{
+    for (int i = 0; i < count; i++, dst += 4, src += 4)
+    {
+        if (src[3] == 0) continue;
+
+        memcpy(dst, src, 4);
+    }
+}
+
+void ScalarMatchRgba(const uint8_t* src, int count, uint32_t seed, int threshold, uint8_t value, uint8_t* out)
+{
+    int r = seed & 0xFF;
+    int g = (seed >> 8) & 0xFF;
+    int b = (seed >> 16) & 0xFF;
+    int a = seed >> 24;
+
+    for (int i = 0; i < count; i++, src += 4)
+    {
+        int dr = src[0] - r;
+        int dg = src[1] - g;
+        int db = src[2] - b;
+        int da = src[3] - a;
+
+        bool match = (dr < 0 ? -dr : dr) <= threshold
+            && (dg < 0 ? -dg : dg) <= threshold
+            && (db < 0 ? -db : db) <= threshold
+            && (da < 0 ? -da : da) <= threshold;
+
+        out[i] = match ? value : 0;
+    }
+}
+
+const Kernels ScalarKernels = {
+    "scalar",
+    ScalarFillRgba,
+    ScalarFillIndex,
+    ScalarBlendRgba,
+    ScalarBlitRgba,
+    ScalarMatchRgba
+};
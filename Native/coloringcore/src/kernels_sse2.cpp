@@ -0,0 +1,172 @@
+#include "kernels.h"
+
+#if defined(CC_HAVE_SSE2)
+
+#include <emmintrin.h>
+#include <string.h>
+
+// 4 mask bytes to 4 pixel lanes, all ones where the mask byte is 1
+static inline __m128i ExpandMask4(const uint8_t* mask)
+{
+    int bytes;
+    memcpy(&bytes, mask, 4);
+
+    __m128i m = _mm_cmpeq_epi8(_mm_cvtsi32_si128(bytes), _mm_set1_epi8(1));
+    m = _mm_unpacklo_epi8(m, m);
+    return _mm_unpacklo_epi16(m, m);
+}
+
+static inline __m128i Select(__m128i mask, __m128i a, __m128i b)
+{
+    return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+}
+
+static void FillRgba(uint8_t* dst, int count, uint32_t rgba, const uint8_t* mask)
+{
+    __m128i color = _mm_set1_epi32((int)rgba);
+    int i = 0;
+
+    if (!mask)
+    {
+        for (; i + 4 <= count; i += 4)
+        {
+            _mm_storeu_si128((__m128i*)(dst + i * 4), color);
+        }
+    }
+    else
+    {
+        for (; i + 4 <= count; i += 4)
+        {
+            __m128i m = ExpandMask4(mask + i);
+            if (_mm_movemask_epi8(m) == 0) continue;
+
+            __m128i d = _mm_loadu_si128((const __m128i*)(dst + i * 4));
+            _mm_storeu_si128((__m128i*)(dst + i * 4), Select(m, color, d));
+        }
+    }
+
+    ScalarFillRgba(dst + i * 4, count - i, rgba, mask ? mask + i : 0);
+}
+
+static void FillIndex(uint8_t* dst, int count, uint8_t index, const uint8_t* mask)
+{
+    if (!mask)
+    {
+        ScalarFillIndex(dst, count, index, 0);
+        return;
+    }
+
+    __m128i value = _mm_set1_epi8((char)index);
+    __m128i one = _mm_set1_epi8(1);
+    int i = 0;
+
+    for (; i + 16 <= count; i += 16)
+    {
+        __m128i m = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(mask + i)), one);
+        __m128i d = _mm_loadu_si128((const __m128i*)(dst + i));
+        _mm_storeu_si128((__m128i*)(dst + i), Select(m, value, d));
+    }
+
+    ScalarFillIndex(dst + i, count - i, index, mask + i);
+}
+
+// one pixel (4 int lanes) blended in float, same operation order as the scalar kernel
+static inline __m128i BlendPixel(__m128i d, __m128i color, __m128 t)
+{
+    __m128 diff = _mm_cvtepi32_ps(_mm_sub_epi32(color, d));
+    return _mm_cvttps_epi32(_mm_add_ps(_mm_cvtepi32_ps(d), _mm_mul_ps(diff, t)));
+}
+
+static void BlendRgba(uint8_t* dst, int count, uint32_t rgba, float t, float tAlpha, const uint8_t* mask)
+{
+    __m128i color = _mm_setr_epi32(rgba & 0xFF, (rgba >> 8) & 0xFF, (rgba >> 16) & 0xFF, rgba >> 24);
+    __m128 tv = _mm_setr_ps(t, t, t, tAlpha);
+    __m128i zero = _mm_setzero_si128();
+    int i = 0;
+
+    for (; i + 4 <= count; i += 4)
+    {
+        __m128i m = mask ? ExpandMask4(mask + i) : _mm_set1_epi32(-1);
+        if (_mm_movemask_epi8(m) == 0) continue;
+
+        __m128i d = _mm_loadu_si128((const __m128i*)(dst + i * 4));
+        __m128i lo = _mm_unpacklo_epi8(d, zero);
+        __m128i hi = _mm_unpackhi_epi8(d, zero);
+
+        __m128i p0 = BlendPixel(_mm_unpacklo_epi16(lo, zero), color, tv);
+        __m128i p1 = BlendPixel(_mm_unpackhi_epi16(lo, zero), color, tv);
+        __m128i p2 = BlendPixel(_mm_unpacklo_epi16(hi, zero), color, tv);
+        __m128i p3 = BlendPixel(_mm_unpackhi_epi16(hi, zero), color, tv);
+
+        __m128i result = _mm_packus_epi16(_mm_packs_epi32(p0, p1), _mm_packs_epi32(p2, p3));
+        _mm_storeu_si128((__m128i*)(dst + i * 4), Select(m, result, d));
+    }
+
+    ScalarBlendRgba(dst + i * 4, count - i, rgba, t, tAlpha, mask ? mask + i : 0);
+}
+
+static void BlitRgba(uint8_t* dst, const uint8_t* src, int count)
+{
+    __m128i alpha = _mm_set1_epi32((int)0xFF000000);
+    __m128i zero = _mm_setzero_si128();
+    int i = 0;
+
+    for (; i + 4 <= count; i += 4)
+    {
+        __m128i s = _mm_loadu_si128((const __m128i*)(src + i * 4));
+        __m128i transparent = _mm_cmpeq_epi32(_mm_and_si128(s, alpha), zero);
+        if (_mm_movemask_epi8(transparent) == 0xFFFF) continue;
+
+        __m128i d = _mm_loadu_si128((const __m128i*)(dst + i * 4));
+        _mm_storeu_si128((__m128i*)(dst + i * 4), Select(transparent, d, s));
+    }
+
+    ScalarBlitRgba(dst + i * 4, src + i * 4, count - i);
+}
+
+// 4 pixels to 4 lanes, all ones where every channel is within threshold
+static inline __m128i Match4(const uint8_t* src, __m128i seed, __m128i threshold)
+{
+    __m128i s = _mm_loadu_si128((const __m128i*)src);
+    __m128i diff = _mm_or_si128(_mm_subs_epu8(s, seed), _mm_subs_epu8(seed, s));
+    __m128i within = _mm_cmpeq_epi8(_mm_subs_epu8(diff, threshold), _mm_setzero_si128());
+    return _mm_cmpeq_epi32(within, _mm_set1_epi32(-1));
+}
+
+static void MatchRgba(const uint8_t* src, int count, uint32_t seed, int threshold, uint8_t value, uint8_t* out)
+{
+    if (threshold < 0 || threshold > 255)
+    {
+        ScalarMatchRgba(src, count, seed, threshold, value, out);
+        return;
+    }
+
+    __m128i seedv = _mm_set1_epi32((int)seed);
+    __m128i thresholdv = _mm_set1_epi8((char)threshold);
+    __m128i valuev = _mm_set1_epi8((char)value);
+    int i = 0;
+
+    for (; i + 16 <= count; i += 16)
+    {
+        __m128i m0 = Match4(src + i * 4, seedv, thresholdv);
+        __m128i m1 = Match4(src + i * 4 + 16, seedv, thresholdv);
+        __m128i m2 = Match4(src + i * 4 + 32, seedv, thresholdv);
+        __m128i m3 = Match4(src + i * 4 + 48, seedv, thresholdv);
+
+        __m128i m = _mm_packs_epi16(_mm_packs_epi32(m0, m1), _mm_packs_epi32(m2, m3));
+        _mm_storeu_si128((__m128i*)(out + i), _mm_and_si128(m, valuev));
+    }
+
+    ScalarMatchRgba(src + i * 4, count - i, seed, threshold, value, out + i);
+}
+
+const Kernels Sse2Kernels = {
+    "sse2",
+    FillRgba,
+    FillIndex,
+    BlendRgba,
+    BlitRgba,
+    MatchRgba
+};
+
+#endif
@@ -0,0 +1,455 @@
+// kernel tests for one backend: golden values worked out by hand, spans of every length around the vector widths
+// (so the SSE2, AVX2 and NEON tails run) at unaligned addresses, and stamps and labels on odd tile and page sizes
+// checked against brute force loops written here, not against the scalar backend.
+// usage: coloringcore_test <scalar|sse2|avx2|neon>, exits with 77 (skipped) when this CPU or build lacks the backend
+
+#include "coloringcore.h"
+
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+static const int Skipped = 77;
+static const uint8_t Guard = 0xA5; // written around every buffer, a kernel must not touch it
+
+static int failures = 0;
+
+#define CHECK(condition) Check((condition), #condition, __FILE__, __LINE__)
+#define CHECK_EQ(expected, actual) CheckEqual((long)(expected), (long)(actual), #actual, __FILE__, __LINE__)
+
+static void Check(bool condition, const char* text, const char* file, int line)
+{
+    if (condition) return;
+
+    printf("%s:%d: failed: %s\n", file, line, text);
+    failures++;
+}
+
+static void CheckEqual(long expected, long actual, const char* text, const char* file, int line)
+{
+    if (expected == actual) return;
+
+    printf("%s:%d: %s is %ld, expected %ld\n", file, line, text, actual, expected);
+    failures++;
+}
+
+static uint32_t Random(uint32_t& state)
+{
+    state = state * 1664525u + 1013904223u;
+    return state >> 8;
+}
+
+static uint32_t Rgba(int r, int g, int b, int a)
+{
+    return (uint32_t)r | (uint32_t)g << 8 | (uint32_t)b << 16 | (uint32_t)a << 24;
+}
+
+static const int Counts[] = { 1, 3, 5, 7, 15, 17, 31, 33 };
+
+
+// golden
+
+static void GoldenFill()
+{
+    uint8_t dst[3 * 4];
+    uint8_t mask[3] = { 1, 0, 2 }; // only 1 is unlocked
+    memset(dst, 9, sizeof(dst));
+
+    cc_fill_span_rgba(dst, 3, Rgba(10, 20, 30, 40), mask);
+    const uint8_t rgba[] = { 10, 20, 30, 40, 9, 9, 9, 9, 9, 9, 9, 9 };
+    CHECK(memcmp(dst, rgba, sizeof(dst)) == 0);
+
+    uint8_t index[3] = { 0, 0, 0 };
+    cc_fill_span_index(index, 3, 5, mask);
+    CHECK_EQ(5, index[0]);
+    CHECK_EQ(0, index[1]);
+    CHECK_EQ(0, index[2]);
+
+    cc_fill_span_index(index, 3, 6, 0);
+    CHECK_EQ(6, index[2]);
+}
+
+static void GoldenBlend()
+{
+    // c + (color - c) * t, truncated towards zero
+    uint8_t dst[2 * 4] = { 10, 200, 100, 0, 201, 0, 255, 255 };
+
+    cc_blend_span_rgba(dst, 2, Rgba(255, 0, 100, 255), 0.5f, 0.25f, 0);
+    const uint8_t half[] = { 132, 100, 100, 63, 228, 0, 177, 255 }; // 132.5, 100, 100, 63.75 | 228, 0, 177.5, 255
+    CHECK(memcmp(dst, half, sizeof(dst)) == 0);
+
+    uint8_t down[4] = { 201, 201, 201, 201 };
+    cc_blend_span_rgba(down, 1, Rgba(0, 0, 0, 0), 0.25f, 0.0f, 0);
+    CHECK_EQ(150, down[0]); // 150.75
+    CHECK_EQ(201, down[3]); // tAlpha 0 keeps alpha
+
+    uint8_t locked[4] = { 1, 2, 3, 4 };
+    uint8_t mask = 0;
+    cc_blend_span_rgba(locked, 1, Rgba(255, 255, 255, 255), 1.0f, 1.0f, &mask);
+    CHECK_EQ(1, locked[0]);
+}
+
+static void GoldenBlit()
+{
+    uint8_t dst[2 * 4] = { 1, 1, 1, 1, 2, 2, 2, 2 };
+    uint8_t src[2 * 4] = { 7, 8, 9, 0, 7, 8, 9, 1 }; // alpha 0 is skipped, alpha 1 is copied
+
+    cc_blit_span_rgba(dst, src, 2);
+    const uint8_t expected[] = { 1, 1, 1, 1, 7, 8, 9, 1 };
+    CHECK(memcmp(dst, expected, sizeof(dst)) == 0);
+}
+
+static void GoldenStamp()
+{
+    // pixels with dx^2 + dy^2 < r^2: 3x3 for r 2, 5x5 for r 3, 7 + 7 + 7 + 7 + 7 + 5 + 5 for r 4
+    CHECK_EQ(0, cc_stamp_circle(0, 16, 4, 0, 0, 0, 8, 8, 0, 0, 16, 16));
+    CHECK_EQ(1, cc_stamp_circle(0, 16, 4, 0, 0, 0, 8, 8, 1, 0, 16, 16));
+    CHECK_EQ(9, cc_stamp_circle(0, 16, 4, 0, 0, 0, 8, 8, 2, 0, 16, 16));
+    CHECK_EQ(25, cc_stamp_circle(0, 16, 4, 0, 0, 0, 8, 8, 3, 0, 16, 16));
+    CHECK_EQ(45, cc_stamp_circle(0, 16, 4, 0, 0, 0, 8, 8, 4, 0, 16, 16));
+
+    // a quarter of the r 3 disc is in the tile at the page corner: rows and columns 0..2
+    CHECK_EQ(9, cc_stamp_circle(0, 16, 4, 0, 0, 0, 0, 0, 3, 0, 16, 16));
+
+    // r 2 on a palette tile: the 3x3 block around (5, 6), tile at page pixel (4, 4)
+    uint8_t tile[8 * 8];
+    memset(tile, 0, sizeof(tile));
+    CHECK_EQ(9, cc_stamp_circle(tile, 8, 1, 3, 4, 4, 5, 6, 2, 0, 32, 32));
+    for (int y = 0; y < 8; y++)
+    {
+        for (int x = 0; x < 8; x++)
+        {
+            bool inside = x >= 0 && x <= 2 && y >= 1 && y <= 3;
+            CHECK_EQ(inside ? 3 : 0, tile[y * 8 + x]);
+        }
+    }
+}
+
+static void GoldenLabel()
+{
+    // 6 x 4, a black wall in column 2 splits white left and right; the right half has one grey pixel within 10
+    const int w = 6, h = 4;
+    std::vector<uint8_t> image(w * h * 4, 255);
+    for (int y = 0; y < h; y++)
+    {
+        memset(&image[(y * w + 2) * 4], 0, 3);
+    }
+    memset(&image[(1 * w + 4) * 4], 250, 3);
+
+    std::vector<uint8_t> region(w * h);
+    int bounds[4];
+
+    CHECK_EQ(8, cc_label_region(&image[0], w, h, 0, 0, 10, &region[0], bounds));
+    CHECK_EQ(0, bounds[0]);
+    CHECK_EQ(0, bounds[1]);
+    CHECK_EQ(2, bounds[2]);
+    CHECK_EQ(4, bounds[3]);
+    CHECK_EQ(1, region[1 * w + 1]);
+    CHECK_EQ(0, region[1 * w + 2]);
+    CHECK_EQ(0, region[1 * w + 3]);
+
+    // threshold 4 leaves the grey pixel out, threshold 5 takes it in
+    CHECK_EQ(11, cc_label_region(&image[0], w, h, 5, 3, 4, &region[0], bounds));
+    CHECK_EQ(0, region[1 * w + 4]);
+    CHECK_EQ(12, cc_label_region(&image[0], w, h, 5, 3, 5, &region[0], bounds));
+    CHECK_EQ(3, bounds[0]);
+    CHECK_EQ(6, bounds[2]);
+
+    // a seed with no matching neighbour is no region, outside the page neither
+    CHECK_EQ(0, cc_label_region(&image[0], w, h, 4, 1, 0, &region[0], bounds));
+    CHECK_EQ(0, region[1 * w + 4]);
+    CHECK_EQ(0, cc_label_region(&image[0], w, h, w, 0, 10, &region[0], bounds));
+}
+
+
+// spans
+
+// count pixels of bpp bytes at an odd offset into a guarded buffer
+struct Span
+{
+    std::vector<uint8_t> bytes;
+    int bpp;
+    int count;
+
+    Span(int count, int bpp, uint32_t& state) : bytes((count + 2) * bpp + 1, Guard), bpp(bpp), count(count)
+    {
+        for (int i = 0; i < count * bpp; i++) Data()[i] = (uint8_t)Random(state);
+    }
+
+    uint8_t* Data()
+    {
+        return &bytes[bpp + 1];
+    }
+
+    bool Guarded()
+    {
+        for (int i = 0; i < bpp + 1; i++)
+        {
+            if (bytes[i] != Guard) return false;
+        }
+        for (size_t i = (count + 1) * bpp + 1; i < bytes.size(); i++)
+        {
+            if (bytes[i] != Guard) return false;
+        }
+        return true;
+    }
+};
+
+static std::vector<uint8_t> RandomMask(int count, uint32_t& state)
+{
+    std::vector<uint8_t> mask(count);
+    for (int i = 0; i < count; i++) mask[i] = (uint8_t)(Random(state) % 3); // 2 is locked as well
+    return mask;
+}
+
+static void SpanTails()
+{
+    uint32_t state = 7;
+    const uint32_t color = Rgba(200, 30, 90, 180);
+
+    for (int count : Counts)
+    {
+        for (int masked = 0; masked < 2; masked++)
+        {
+            std::vector<uint8_t> mask = RandomMask(count, state);
+            const uint8_t* m = masked ? &mask[0] : 0;
+
+            // fill rgba
+            Span rgba(count, 4, state);
+            std::vector<uint8_t> expected(rgba.Data(), rgba.Data() + count * 4);
+            for (int i = 0; i < count; i++)
+            {
+                if (m && m[i] != 1) continue;
+                expected[i * 4 + 0] = 200;
+                expected[i * 4 + 1] = 30;
+                expected[i * 4 + 2] = 90;
+                expected[i * 4 + 3] = 180;
+            }
+            cc_fill_span_rgba(rgba.Data(), count, color, m);
+            CHECK(memcmp(rgba.Data(), &expected[0], count * 4) == 0);
+            CHECK(rgba.Guarded());
+
+            // fill index
+            Span index(count, 1, state);
+            expected.assign(index.Data(), index.Data() + count);
+            for (int i = 0; i < count; i++)
+            {
+                if (!m || m[i] == 1) expected[i] = 11;
+            }
+            cc_fill_span_index(index.Data(), count, 11, m);
+            CHECK(memcmp(index.Data(), &expected[0], count) == 0);
+            CHECK(index.Guarded());
+
+            // blend, the same float expression as the managed marker
+            Span blend(count, 4, state);
+            expected.assign(blend.Data(), blend.Data() + count * 4);
+            const float t = 0.1f;
+            const float tAlpha = 0.35f;
+            const int channel[4] = { 200, 30, 90, 180 };
+            for (int i = 0; i < count; i++)
+            {
+                if (m && m[i] != 1) continue;
+                for (int c = 0; c < 4; c++)
+                {
+                    uint8_t& v = expected[i * 4 + c];
+                    v = (uint8_t)(int)((float)v + (float)(channel[c] - v) * (c == 3 ? tAlpha : t));
+                }
+            }
+            cc_blend_span_rgba(blend.Data(), count, color, t, tAlpha, m);
+            CHECK(memcmp(blend.Data(), &expected[0], count * 4) == 0);
+            CHECK(blend.Guarded());
+        }
+
+        // blit, a third of the source transparent
+        Span dst(count, 4, state);
+        Span src(count, 4, state);
+        for (int i = 0; i < count; i++)
+        {
+            if (i % 3 == 1) src.Data()[i * 4 + 3] = 0;
+        }
+        std::vector<uint8_t> expected(dst.Data(), dst.Data() + count * 4);
+        for (int i = 0; i < count; i++)
+        {
+            if (src.Data()[i * 4 + 3] != 0) memcpy(&expected[i * 4], src.Data() + i * 4, 4);
+        }
+        cc_blit_span_rgba(dst.Data(), src.Data(), count);
+        CHECK(memcmp(dst.Data(), &expected[0], count * 4) == 0);
+        CHECK(dst.Guarded());
+        CHECK(src.Guarded());
+    }
+}
+
+
+// tiles
+
+// stamp on tiles that are not 64 wide, anywhere on a page that is not a multiple of them, against a per pixel loop
+static void StampTiles()
+{
+    const int width = 77, height = 53;
+    uint32_t state = 3;
+
+    std::vector<uint8_t> mask(width * height);
+    for (size_t i = 0; i < mask.size(); i++) mask[i] = (uint8_t)(Random(state) % 4 != 0);
+
+    const int tileSizes[] = { 16, 24, 40 };
+    const int radii[] = { 1, 3, 7, 12, 30 };
+
+    for (int tileSize : tileSizes)
+    {
+        for (int bpp = 1; bpp <= 4; bpp += 3)
+        {
+            for (int masked = 0; masked < 2; masked++)
+            {
+                for (int radius : radii)
+                {
+                    const uint8_t* m = masked ? &mask[0] : 0;
+                    uint32_t value = bpp == 4 ? Rgba(1, 2, 3, 4) : 9;
+
+                    int cx = (int)(Random(state) % (width + 20)) - 10;
+                    int cy = (int)(Random(state) % (height + 20)) - 10;
+
+                    for (int originY = 0; originY < height; originY += tileSize)
+                    {
+                        for (int originX = 0; originX < width; originX += tileSize)
+                        {
+                            int bytes = tileSize * tileSize * bpp;
+                            std::vector<uint8_t> tile(bytes + 2, Guard);
+                            for (int i = 1; i <= bytes; i++) tile[i] = (uint8_t)Random(state);
+
+                            std::vector<uint8_t> expected(tile);
+                            int count = 0;
+                            for (int y = originY; y < originY + tileSize && y < height; y++)
+                            {
+                                for (int x = originX; x < originX + tileSize && x < width; x++)
+                                {
+                                    int dx = x - cx;
+                                    int dy = y - cy;
+                                    if (dx * dx + dy * dy >= radius * radius) continue;
+                                    if (m && m[y * width + x] != 1) continue;
+
+                                    count++;
+                                    memcpy(&expected[1 + ((y - originY) * tileSize + (x - originX)) * bpp], &value, bpp);
+                                }
+                            }
+
+                            int painted = cc_stamp_circle(&tile[1], tileSize, bpp, value, originX, originY, cx, cy, radius, m, width, height);
+                            CHECK_EQ(count, painted);
+                            CHECK(tile == expected);
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+// regions on pages whose pixel count is not a multiple of any vector width, against a flood fill one pixel at a time
+static void LabelPages()
+{
+    const int sizes[][2] = { { 13, 7 }, { 37, 29 }, { 70, 33 }, { 1, 17 } };
+    uint32_t state = 5;
+
+    for (const int* size : sizes)
+    {
+        int width = size[0], height = size[1];
+
+        // blobs of a few grey levels, so thresholds split and join them
+        std::vector<uint8_t> image(width * height * 4);
+        for (int y = 0; y < height; y++)
+        {
+            for (int x = 0; x < width; x++)
+            {
+                uint8_t level = (uint8_t)(((x / 5 + y / 4) % 3) * 40 + Random(state) % 6);
+                uint8_t* p = &image[(y * width + x) * 4];
+                p[0] = p[1] = p[2] = level;
+                p[3] = 255;
+            }
+        }
+
+        for (int threshold = 0; threshold <= 60; threshold += 20)
+        {
+            int x = (int)(Random(state) % width);
+            int y = (int)(Random(state) % height);
+
+            const uint8_t* seed = &image[(y * width + x) * 4];
+            std::vector<uint8_t> expected(width * height, 0);
+            std::vector<int> stack(1, y * width + x);
+            int count = 0;
+            int x0 = width, y0 = height, x1 = 0, y1 = 0;
+
+            while (!stack.empty())
+            {
+                int pixel = stack.back();
+                stack.pop_back();
+                if (expected[pixel]) continue;
+
+                const uint8_t* p = &image[pixel * 4];
+                bool match = true;
+                for (int c = 0; c < 4; c++)
+                {
+                    int d = p[c] - seed[c];
+                    match &= (d < 0 ? -d : d) <= threshold;
+                }
+                if (!match) continue;
+
+                expected[pixel] = 1;
+                count++;
+
+                int px = pixel % width, py = pixel / width;
+                if (px < x0) x0 = px;
+                if (py < y0) y0 = py;
+                if (px + 1 > x1) x1 = px + 1;
+                if (py + 1 > y1) y1 = py + 1;
+
+                if (px > 0) stack.push_back(pixel - 1);
+                if (px + 1 < width) stack.push_back(pixel + 1);
+                if (py > 0) stack.push_back(pixel - width);
+                if (py + 1 < height) stack.push_back(pixel + width);
+            }
+
+            if (count == 1)
+            {
+                expected[y * width + x] = 0;
+                count = 0;
+            }
+
+            std::vector<uint8_t> region(width * height + 1, Guard);
+            int bounds[4];
+            CHECK_EQ(count, cc_label_region(&image[0], width, height, x, y, threshold, &region[0], bounds));
+            CHECK(memcmp(&region[0], &expected[0], width * height) == 0);
+            CHECK_EQ(Guard, region[width * height]);
+
+            if (count > 0)
+            {
+                CHECK_EQ(x0, bounds[0]);
+                CHECK_EQ(y0, bounds[1]);
+                CHECK_EQ(x1, bounds[2]);
+                CHECK_EQ(y1, bounds[3]);
+            }
+        }
+    }
+}
+
+
+int main(int argc, char** argv)
+{
+    const char* backend = argc > 1 ? argv[1] : "scalar";
+
+    if (!cc_select_backend(backend))
+    {
+        printf("backend %s is not in this build or CPU, skipped\n", backend);
+        return Skipped;
+    }
+
+    GoldenFill();
+    GoldenBlend();
+    GoldenBlit();
+    GoldenStamp();
+    GoldenLabel();
+    SpanTails();
+    StampTiles();
+    LabelPages();
+
+    printf("%s: %s\n", backend, failures ? "FAILED" : "passed");
+    return failures ? 1 : 0;
+}